@@ -0,0 +1,243 @@
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "debugger.hpp"
+#include "debugserver.hpp"
+#include "engine.hpp"
+#include "pack.hpp"
+#include "profiler.hpp"
+
+/* Headless batch runner: runs each ROM for a number of frames without any
+ * I/O, optionally profiling where the ROM spends its instructions.
+ */
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-e ENGINE] [-f FRAMES] [-i STEPS] [-p FILE [-r PERIOD] [-S SYMBOLS]] [-g SOCKET] [-V] [-P PACK] [-H FILE] ROM...\n"
+		<< "  -e ENGINE   engine to run with (default reference)\n"
+		<< "  -f FRAMES   frames to run each ROM for (default 3600)\n"
+		<< "  -i STEPS    steps per frame (default 16)\n"
+		<< "  -p FILE     write a folded stack profile of all ROMs to FILE\n"
+		<< "  -r PERIOD   sample the call stack every PERIOD steps instead of counting\n"
+		<< "              every step, which lets the engine run at full speed\n"
+		<< "  -S SYMBOLS  names for subroutine addresses, as lines of \"ADDRESS NAME\"\n"
+		<< "  -g SOCKET   accept debugger connections on this Unix socket\n"
+		<< "  -V          COSMAC VIP timing: frames last their machine cycles instead of -i\n"
+		<< "              steps, and the cycles used are reported as the ROM's cost\n"
+		<< "  -P PACK     ROMs are names or hashes in this pack (all of it if none are\n"
+		<< "              given), run with their settings from the pack\n"
+		<< "  -H FILE     write the machine's state hash after every frame to FILE, to\n"
+		<< "              compare runs on different hosts or engines\n"
+		<< "engines:";
+	for (const std::string& engine : engine_names()) std::cerr << ' ' << engine;
+	std::cerr << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	std::string engine_name = "reference";
+	uint64_t frames = 3600;
+	uint64_t default_steps = 16;
+	std::string profile_file;
+	uint64_t sample_period = 0;
+	Profiler::symbols_t symbols;
+	std::string debug_socket;
+	bool vip_timing = false;
+	std::string pack_file;
+	std::string hash_file;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "e:f:i:p:r:S:g:VP:H:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'e': engine_name = optarg; break;
+			case 'f': frames = std::strtoull(optarg, nullptr, 10); break;
+			case 'i': default_steps = std::strtoull(optarg, nullptr, 10); break;
+			case 'p': profile_file = optarg; break;
+			case 'r': sample_period = std::strtoull(optarg, nullptr, 10); break;
+			case 'g': debug_socket = optarg; break;
+			case 'V': vip_timing = true; break;
+			case 'P': pack_file = optarg; break;
+			case 'H': hash_file = optarg; break;
+			case 'S':
+				if (!Profiler::read_symbols(optarg, symbols))
+				{
+					std::cerr << optarg << ": could not read symbols" << std::endl;
+					return EXIT_FAILURE;
+				}
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	std::unique_ptr<Engine> engine = make_engine(engine_name);
+	if (!engine || (optind >= argc && pack_file.empty()))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Pack pack;
+	std::vector<std::string> roms(argv + optind, argv + argc);
+	if (!pack_file.empty())
+	{
+		if (!pack.open(pack_file))
+		{
+			std::cerr << pack_file << ": not a ROM pack" << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (roms.empty())
+		{
+			for (size_t i = 0; i < pack.size(); ++i) roms.push_back(pack.name(pack.entry(i)));
+		}
+	}
+
+	std::ofstream profile;
+	if (!profile_file.empty())
+	{
+		profile.open(profile_file);
+		if (!profile)
+		{
+			std::cerr << profile_file << ": could not open" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::ofstream hashes;
+	if (!hash_file.empty())
+	{
+		hashes.open(hash_file);
+		if (!hashes)
+		{
+			std::cerr << hash_file << ": could not open" << std::endl;
+			return EXIT_FAILURE;
+		}
+		hashes << std::hex << std::setfill('0');
+	}
+
+	Debugger debugger;
+	std::unique_ptr<DebugServer> server;
+	if (!debug_socket.empty())
+	{
+		server = std::make_unique<DebugServer>(debug_socket);
+		if (!server->is_listening())
+		{
+			std::cerr << debug_socket << ": could not listen" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	int status = EXIT_SUCCESS;
+	for (const std::string& rom : roms)
+	{
+		Chip8 chip8(1);
+		PackSettings settings;
+		try
+		{
+			if (pack_file.empty())
+			{
+				chip8.load_rom(rom);
+			}
+			else if (const PackEntry* entry = pack.find(rom))
+			{
+				pack.load(*entry, chip8);
+				settings = pack.settings(*entry);
+			}
+			else
+			{
+				throw std::runtime_error(rom + ": not in " + pack_file);
+			}
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cout << e.what() << std::endl;
+			status = EXIT_FAILURE;
+			continue;
+		}
+		if (vip_timing || settings.profile == profile_vip) chip8.set_timing(Chip8::Timing::vip);
+		uint64_t steps_per_frame = settings.steps_per_frame ? settings.steps_per_frame : default_steps;
+		chip8.set_hash_tracking(hashes.is_open());
+		engine->invalidate();
+
+		Profiler profiler;
+		uint64_t frame = 0;
+		uint64_t steps = 0; // with VIP timing, where frames vary
+		for (; frame < frames && chip8.get_fault() == Chip8::Fault::none; ++frame)
+		{
+			// frames take microseconds here, so without a client only look once per emulated second
+			if (server && (server->is_attached() || frame % 60 == 0))
+			{
+				server->poll(chip8, debugger);
+				while (server->is_halted())
+				{
+					usleep(1000);
+					server->poll(chip8, debugger);
+				}
+			}
+
+			if (chip8.get_timing() == Chip8::Timing::vip && !profile.is_open())
+			{
+				DebugStop stop = debugger.run_until(chip8, *engine, chip8.next_frame_cycles());
+				steps += stop.steps;
+				if (stop.reason != DebugStop::none && server) server->stopped(stop);
+			}
+			else if (chip8.get_timing() == Chip8::Timing::vip)
+			{
+				// instructions until the next display interrupt, one at a time since their cost varies
+				for (uint64_t end = chip8.next_frame_cycles(); chip8.get_cycles() < end && chip8.get_fault() == Chip8::Fault::none; ++steps)
+				{
+					profiler.run(chip8, 1);
+				}
+			}
+			else if (!profile.is_open())
+			{
+				DebugStop stop = debugger.run(chip8, *engine, steps_per_frame);
+				if (stop.reason != DebugStop::none && server) server->stopped(stop);
+			}
+			else if (sample_period == 0)
+			{
+				profiler.run(chip8, steps_per_frame);
+			}
+			else
+			{
+				for (uint64_t done = 0; done < steps_per_frame; done += sample_period)
+				{
+					uint64_t chunk = std::min(sample_period, steps_per_frame - done);
+					if (engine->run(chip8, chunk) != Chip8::Fault::none) break;
+					profiler.sample(chip8, chunk);
+				}
+			}
+
+			if (hashes.is_open()) hashes << rom << ' ' << std::dec << frame << ' ' << std::hex << std::setw(16) << chip8.hash() << '\n';
+		}
+
+		// a fault only ends this ROM, the rest of the batch still runs
+		if (chip8.get_fault() != Chip8::Fault::none)
+		{
+			std::cout << rom << ": fault at frame " << frame - 1 << ": " << Chip8::fault_name(chip8.get_fault())
+				<< " at " << std::hex << chip8.get_fault_address() << std::dec << std::endl;
+			status = EXIT_FAILURE;
+		}
+		else
+		{
+			std::cout << rom << ": ran " << frame << " frames";
+			if (chip8.get_timing() == Chip8::Timing::vip) std::cout << ", " << steps << " instructions in " << chip8.get_cycles() << " cycles";
+			std::cout << std::endl;
+		}
+
+		// the ROM name is the root frame, so one profile can hold a whole batch
+		if (profile.is_open()) profiler.write_folded(profile, rom.substr(rom.find_last_of('/') + 1), symbols);
+	}
+
+	return status;
+}
@@ -1,529 +1,203 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <random>
+#include <stdexcept>
 #include "chip8.hpp"
+#include "hash.hpp"
+#include "trace.hpp"
 
-uint8_t Chip8::rng()
+Chip8::Chip8() : Chip8(std::random_device()())
 {
-	return uniform_distribution(random_generator);
 }
 
-// XOR pixel x,y with set, return true if it was turned off
-bool Chip8::set_pixel(uint8_t x, uint8_t y, bool set)
+void Chip8::record_trace(uint16_t address, uint16_t opcode, uint8_t x)
 {
-	x %= screen_width;
-	y %= screen_height;
-
-	bool prev = get_pixel(x, y);
-	screen.at(x + y * screen_width) = prev ^ set;
-	return prev && !get_pixel(x, y);
+	trace->record(address, opcode, address_register, x, data_registers[x]);
 }
 
-// TODO seed RNG somehow?
-Chip8::Chip8() : random_generator(std::random_device()()), uniform_distribution(0, 0xff)
-{
-	reset();
-}
-
-void Chip8::reset()
+void Chip8::load_rom(const std::string& filename)
 {
-	memory.fill(0);
-	data_registers.fill(0);
-	program_counter = address_register = program_mem_start;
+	std::ifstream romfile(filename, std::ios::binary);
+	if (!romfile) throw std::runtime_error(filename + ": could not read");
 
-	stack.clear();
-	stack.reserve(stack_size);
+	// one byte more than fits, to tell a full ROM from one that is too large
+	std::array<char, max_rom_size + 1> image;
+	romfile.read(image.data(), image.size());
+	if (romfile.bad()) throw std::runtime_error(filename + ": could not read");
+	size_t size = romfile.gcount();
+	if (size > max_rom_size) throw std::runtime_error(filename + ": larger than " + std::to_string(max_rom_size) + " bytes");
 
-	delay_timer = 0;
-	sound_timer = 0;
-
-	screen.fill(false);
-	keys.fill(false);
-
-	waiting_for_input = false;
-	screen_dirty = true;
-
-	// 0
-	memory[0x50] = 0b01100000;
-	memory[0x51] = 0b10010000;
-	memory[0x52] = 0b10010000;
-	memory[0x53] = 0b10010000;
-	memory[0x54] = 0b01100000;
-	// 1
-	memory[0x55] = 0b00100000;
-	memory[0x56] = 0b01100000;
-	memory[0x57] = 0b00100000;
-	memory[0x58] = 0b00100000;
-	memory[0x59] = 0b01110000;
-	// 2
-	memory[0x5a] = 0b11100000;
-	memory[0x5b] = 0b00010000;
-	memory[0x5c] = 0b01100000;
-	memory[0x5d] = 0b10000000;
-	memory[0x5e] = 0b11110000;
-	// 3
-	memory[0x5f] = 0b11100000;
-	memory[0x60] = 0b00010000;
-	memory[0x61] = 0b01100000;
-	memory[0x62] = 0b00010000;
-	memory[0x63] = 0b11100000;
-	// 4
-	memory[0x64] = 0b10100000;
-	memory[0x65] = 0b10100000;
-	memory[0x66] = 0b11110000;
-	memory[0x67] = 0b00100000;
-	memory[0x68] = 0b00100000;
-	// 5
-	memory[0x69] = 0b11110000;
-	memory[0x6a] = 0b10000000;
-	memory[0x6b] = 0b11100000;
-	memory[0x6c] = 0b00010000;
-	memory[0x6d] = 0b11100000;
-	// 6
-	memory[0x6e] = 0b01110000;
-	memory[0x6f] = 0b10000000;
-	memory[0x70] = 0b11100000;
-	memory[0x71] = 0b10010000;
-	memory[0x72] = 0b11100000;
-	// 7
-	memory[0x73] = 0b11110000;
-	memory[0x74] = 0b00010000;
-	memory[0x75] = 0b00100000;
-	memory[0x76] = 0b01000000;
-	memory[0x77] = 0b01000000;
-	// 8
-	memory[0x78] = 0b01100000;
-	memory[0x79] = 0b10010000;
-	memory[0x7a] = 0b01100000;
-	memory[0x7b] = 0b10010000;
-	memory[0x7c] = 0b01100000;
-	// 9
-	memory[0x7d] = 0b01100000;
-	memory[0x7e] = 0b10010000;
-	memory[0x7f] = 0b01110000;
-	memory[0x80] = 0b00010000;
-	memory[0x81] = 0b11100000;
-	// A
-	memory[0x82] = 0b01100000;
-	memory[0x83] = 0b10010000;
-	memory[0x84] = 0b11110000;
-	memory[0x85] = 0b10010000;
-	memory[0x86] = 0b10010000;
-	// B
-	memory[0x87] = 0b11100000;
-	memory[0x88] = 0b10010000;
-	memory[0x89] = 0b11100000;
-	memory[0x8a] = 0b10010000;
-	memory[0x8b] = 0b11100000;
-	// C
-	memory[0x8c] = 0b01110000;
-	memory[0x8d] = 0b10000000;
-	memory[0x8e] = 0b10000000;
-	memory[0x8f] = 0b10000000;
-	memory[0x90] = 0b01110000;
-	// D
-	memory[0x91] = 0b11100000;
-	memory[0x92] = 0b10010000;
-	memory[0x93] = 0b10010000;
-	memory[0x94] = 0b10010000;
-	memory[0x95] = 0b11100000;
-	// E
-	memory[0x96] = 0b11110000;
-	memory[0x97] = 0b10000000;
-	memory[0x98] = 0b11100000;
-	memory[0x99] = 0b10000000;
-	memory[0x9a] = 0b11110000;
-	// F
-	memory[0x9b] = 0b11110000;
-	memory[0x9c] = 0b10000000;
-	memory[0x9d] = 0b11100000;
-	memory[0x9e] = 0b10000000;
-	memory[0x9f] = 0b10000000;
+	load_bytes(reinterpret_cast<const uint8_t*>(image.data()), size);
 }
 
-void Chip8::load_rom(const std::string& filename)
+uint64_t Chip8::hash() const
 {
-	reset();
-	std::ifstream romfile(filename);
-	romfile.read(reinterpret_cast<char*>(memory.data()) + program_mem_start, memory_size - program_mem_start);
-}
+	// the same digests either way, so machines compare equal whether they track them or not
+	uint64_t memory_hash = memory_digest;
+	uint64_t screen_hash = screen_digest;
+	if (!hash_tracking) compute_digests(memory_hash, screen_hash);
 
-uint16_t Chip8::get_program_counter() const
-{
-	return program_counter;
-}
+	uint64_t h = hash_mix(memory_hash) ^ screen_hash;
+	h = hash_bytes(data_registers.data(), data_registers.size(), h);
+	h = hash_bytes(stack.data(), stack_pointer * sizeof(uint16_t), h);
+	h = hash_bytes(audio_pattern.data(), audio_pattern.size(), h);
 
-uint16_t Chip8::get_address_register() const
-{
-	return address_register;
-}
+	// the small fields are packed into words rather than hashed one by one
+	uint64_t registers = address_register
+		| static_cast<uint64_t>(program_counter) << 16
+		| static_cast<uint64_t>(stack_pointer) << 32
+		| static_cast<uint64_t>(delay_timer) << 40
+		| static_cast<uint64_t>(sound_timer) << 48
+		| static_cast<uint64_t>(pitch) << 56;
+	uint64_t input = waiting_for_input | input_register << 1;
+	for (uint8_t key = 0; key < registers_size; ++key) input |= static_cast<uint64_t>(keys[key]) << (key + 8);
+	input |= static_cast<uint64_t>(fault) << 24;
 
-uint8_t Chip8::get_register(uint16_t x) const
-{
-	return data_registers.at(x);
+	// cycles are 0 unless the machine uses VIP timing
+	return hash_mix(hash_mix(h ^ registers) ^ input ^ cycles);
 }
 
-uint8_t Chip8::get_memory(uint16_t n) const
+uint64_t Chip8::screen_hash() const
 {
-	return memory.at(n);
+	return hash_bytes(screen.data(), screen.size());
 }
 
-bool Chip8::get_pixel(uint8_t x, uint8_t y) const
+void Chip8::restore(const Chip8& original)
 {
-	return screen.at(x + y * screen_width);
-}
+	for (uint16_t pages = dirty_pages; pages; pages &= pages - 1)
+	{
+		unsigned int start = __builtin_ctz(pages) * page_size;
+		std::copy(original.memory.begin() + start, original.memory.begin() + start + page_size, memory.begin() + start);
+	}
+	if (screen_touched) screen = original.screen;
+
+	data_registers = original.data_registers;
+	address_register = original.address_register;
+	stack = original.stack;
+	stack_pointer = original.stack_pointer;
+	program_counter = original.program_counter;
+	delay_timer = original.delay_timer;
+	sound_timer = original.sound_timer;
+	audio_pattern = original.audio_pattern;
+	pitch = original.pitch;
+	keys = original.keys;
+	waiting_for_input = original.waiting_for_input;
+	input_register = original.input_register;
+	cycles = original.cycles;
+	fault = original.fault;
+	fault_address = original.fault_address;
+	random_state = original.random_state;
+	hash_tracking = original.hash_tracking;
+	memory_digest = original.memory_digest;
+	screen_digest = original.screen_digest;
 
-bool Chip8::beep() const
-{
-	// TODO does this beep continuously when it's positive, or only once when it hits 0?
-	return sound_timer > 0;
+	screen_dirty = true;
+	dirty_pages = 0;
+	screen_touched = false;
 }
 
-void Chip8::press(uint8_t key)
+const char* Chip8::fault_name(Fault fault)
 {
-	if (!keys.at(key) && waiting_for_input)
+	switch (fault)
 	{
-		waiting_for_input = false;
-		data_registers.at(input_register) = key;
+		case Fault::none: return "none";
+		case Fault::invalid_opcode: return "invalid opcode";
+		case Fault::stack_underflow: return "stack underflow";
+		case Fault::stack_overflow: return "stack overflow";
+		case Fault::address_out_of_range: return "address out of range";
 	}
-	keys.at(key) = true;
+	return "unknown";
 }
 
-void Chip8::release(uint8_t key)
+void Chip8::set_trace(Trace* _trace)
 {
-	keys.at(key) = false;
+	trace = _trace;
 }
 
-bool Chip8::should_draw()
-{
-	bool tmp = screen_dirty;
-	screen_dirty = false;
-	return tmp;
-}
+#define OP_PTR(NAME) (&Chip8::op_ ## NAME )
 
-void Chip8::step()
+std::string Chip8::disassemble(uint16_t opcode)
 {
-	if (waiting_for_input) return;
-
-	if (delay_timer > 0) --delay_timer;
-	if (sound_timer > 0) --sound_timer;
-
-	uint16_t opcode = get_opcode(memory, program_counter);
-	program_counter += 2; // each opcode is 2 bytes
+	struct Mnemonic
+	{
+		opfn_t op;
+		const char* format; // x, y, n, nn and nnn are replaced with the arguments
+	};
+
+	static const Mnemonic mnemonics[] = {
+		{OP_PTR(clear), "CLS"},
+		{OP_PTR(ret), "RET"},
+		{OP_PTR(goto), "JP nnn"},
+		{OP_PTR(call), "CALL nnn"},
+		{OP_PTR(if_eq), "SE Vx, nn"},
+		{OP_PTR(if_ne), "SNE Vx, nn"},
+		{OP_PTR(if_cmp), "SE Vx, Vy"},
+		{OP_PTR(store), "LD Vx, nn"},
+		{OP_PTR(add), "ADD Vx, nn"},
+		{OP_PTR(set), "LD Vx, Vy"},
+		{OP_PTR(or), "OR Vx, Vy"},
+		{OP_PTR(and), "AND Vx, Vy"},
+		{OP_PTR(xor), "XOR Vx, Vy"},
+		{OP_PTR(madd), "ADD Vx, Vy"},
+		{OP_PTR(sub), "SUB Vx, Vy"},
+		{OP_PTR(shiftr), "SHR Vx"},
+		{OP_PTR(rsub), "SUBN Vx, Vy"},
+		{OP_PTR(shiftl), "SHL Vx"},
+		{OP_PTR(if_ncmp), "SNE Vx, Vy"},
+		{OP_PTR(save), "LD I, nnn"},
+		{OP_PTR(jmp), "JP V0, nnn"},
+		{OP_PTR(rand), "RND Vx, nn"},
+		{OP_PTR(disp), "DRW Vx, Vy, n"},
+		{OP_PTR(press), "SKP Vx"},
+		{OP_PTR(release), "SKNP Vx"},
+		{OP_PTR(getdel), "LD Vx, DT"},
+		{OP_PTR(wait), "LD Vx, K"},
+		{OP_PTR(setdel), "LD DT, Vx"},
+		{OP_PTR(setsnd), "LD ST, Vx"},
+		{OP_PTR(inc), "ADD I, Vx"},
+		{OP_PTR(font), "LD F, Vx"},
+		{OP_PTR(deci), "LD B, Vx"},
+		{OP_PTR(dump), "LD [I], Vx"},
+		{OP_PTR(load), "LD Vx, [I]"},
+		{OP_PTR(pattern), "LD AUDIO, [I]"},
+		{OP_PTR(pitch), "LD PITCH, Vx"},
+	};
 
 	auto [op, n, x, y] = decode_opcode(opcode);
-	(this->*op)(n, x, y);
-}
 
-uint16_t Chip8::get_opcode(std::array<uint8_t, memory_size>& _memory, uint16_t _counter)
-{
-	return (_memory.at(_counter) << 8) | _memory.at(_counter + 1);
-}
-
-#define OP_PTR(NAME) (&Chip8::op_ ## NAME )
-
-std::tuple<Chip8::opfn_t, uint16_t, uint8_t, uint8_t> Chip8::decode_opcode(uint16_t opcode)
-{
-	switch (opcode >> 12)
+	char buffer[8];
+	for (const Mnemonic& mnemonic : mnemonics)
 	{
-		case 0x0:
-			if (opcode == 0x00e0) return {OP_PTR(clear), 0, 0, 0};
-			if (opcode == 0x00ee) return {OP_PTR(ret), 0, 0, 0};
-			break;
-		case 0x1:
-			return {OP_PTR(goto), opcode & 0x0fff, 0, 0};
-		case 0x2:
-			return {OP_PTR(call), opcode & 0x0fff, 0, 0};
-		case 0x3:
-			return {OP_PTR(if_eq), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
-		case 0x4:
-			return {OP_PTR(if_ne), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
-		case 0x5:
-			if ((opcode & 0xf) != 0x0) break;
-			return {OP_PTR(if_cmp), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-		case 0x6:
-			return {OP_PTR(store), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
-		case 0x7:
-			return {OP_PTR(add), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
-		case 0x8:
-			switch (opcode & 0xf)
+		if (mnemonic.op != op) continue;
+
+		std::string text;
+		for (const char* c = mnemonic.format; *c; ++c)
+		{
+			if (*c == 'x') std::snprintf(buffer, sizeof(buffer), "%X", x);
+			else if (*c == 'y') std::snprintf(buffer, sizeof(buffer), "%X", y);
+			else if (std::strncmp(c, "nnn", 3) == 0)
 			{
-				case 0x0:
-					return {OP_PTR(set), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x1:
-					return {OP_PTR(or), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x2:
-					return {OP_PTR(and), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x3:
-					return {OP_PTR(xor), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x4:
-					return {OP_PTR(madd), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x5:
-					return {OP_PTR(sub), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x6:
-					// Y passed, but unused
-					return {OP_PTR(shiftr), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0x7:
-					return {OP_PTR(rsub), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-				case 0xe:
-					// Y passed, but unused
-					return {OP_PTR(shiftl), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				std::snprintf(buffer, sizeof(buffer), "#%03X", n);
+				c += 2;
 			}
-			break;
-		case 0x9:
-			if ((opcode & 0xf) != 0x0) break;
-			return {OP_PTR(if_ncmp), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-		case 0xa:
-			return {OP_PTR(save), opcode & 0x0fff, 0, 0};
-		case 0xb:
-			return {OP_PTR(jmp), opcode & 0x0fff, 0, 0};
-		case 0xc:
-			return {OP_PTR(rand), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
-		case 0xd:
-			return {OP_PTR(disp), opcode & 0x000f, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
-		case 0xe:
-			if ((opcode & 0xff) == 0x9e) return {OP_PTR(press), 0, (opcode >> 8) & 0xf, 0};
-			if ((opcode & 0xff) == 0xa1) return {OP_PTR(release), 0, (opcode >> 8) & 0xf, 0};
-			break;
-		case 0xf:
-			switch (opcode & 0xff)
+			else if (std::strncmp(c, "nn", 2) == 0)
 			{
-				case 0x07:
-					return {OP_PTR(getdel), 0, (opcode >> 8) & 0xf, 0};
-				case 0x0a:
-					return {OP_PTR(wait), 0, (opcode >> 8) & 0xf, 0};
-				case 0x15:
-					return {OP_PTR(setdel), 0, (opcode >> 8) & 0xf, 0};
-				case 0x18:
-					return {OP_PTR(setsnd), 0, (opcode >> 8) & 0xf, 0};
-				case 0x1e:
-					return {OP_PTR(inc), 0, (opcode >> 8) & 0xf, 0};
-				case 0x29:
-					return {OP_PTR(font), 0, (opcode >> 8) & 0xf, 0};
-				case 0x33:
-					return {OP_PTR(deci), 0, (opcode >> 8) & 0xf, 0};
-				case 0x55:
-					return {OP_PTR(dump), 0, (opcode >> 8) & 0xf, 0};
-				case 0x65:
-					return {OP_PTR(load), 0, (opcode >> 8) & 0xf, 0};
+				std::snprintf(buffer, sizeof(buffer), "#%02X", n);
+				c += 1;
 			}
-			break;
-	}
-
-	// TODO log a fault or something?
-	return {nullptr, 0, 0, 0};
-}
-
-// macros for defining op implementations. since all ops accept all arguments, just omit names of unused ones
-#define CHIP8_OP(NAME) void Chip8::op_ ## NAME (uint16_t, uint8_t, uint8_t)
-#define CHIP8_OP_X(NAME) void Chip8::op_ ## NAME (uint16_t, uint8_t x, uint8_t)
-#define CHIP8_OP_N(NAME) void Chip8::op_ ## NAME (uint16_t n, uint8_t, uint8_t)
-#define CHIP8_OP_XY(NAME) void Chip8::op_ ## NAME (uint16_t, uint8_t x, uint8_t y)
-#define CHIP8_OP_XN(NAME) void Chip8::op_ ## NAME (uint16_t n, uint8_t x, uint8_t)
-#define CHIP8_OP_XYN(NAME) void Chip8::op_ ## NAME (uint16_t n, uint8_t x, uint8_t y)
-
-// opcode implementations
-
-CHIP8_OP(clear)
-{
-	screen.fill(0);
-	screen_dirty = true;
-}
-
-CHIP8_OP(ret)
-{
-	// TODO log a fault or something?
-	if (stack.empty()) return;
-
-	program_counter = stack.back();
-	stack.pop_back();
-}
-
-CHIP8_OP_N(goto)
-{
-	program_counter = n;
-}
-
-CHIP8_OP_N(call)
-{
-	stack.push_back(program_counter);
-	program_counter = n;
-}
-
-CHIP8_OP_XN(if_eq)
-{
-	if (data_registers.at(x) == n) program_counter += 2;
-}
-
-CHIP8_OP_XN(if_ne)
-{
-	if (data_registers.at(x) != n) program_counter += 2;
-}
-
-CHIP8_OP_XY(if_cmp)
-{
-	if (data_registers.at(x) == data_registers.at(y)) program_counter += 2;
-}
-
-CHIP8_OP_XN(store)
-{
-	data_registers.at(x) = n;
-}
-
-CHIP8_OP_XN(add)
-{
-	data_registers.at(x) += n;
-}
-
-CHIP8_OP_XY(set)
-{
-	data_registers.at(x) = data_registers.at(y);
-}
-
-CHIP8_OP_XY(or)
-{
-	data_registers.at(x) |= data_registers.at(y);
-}
-
-CHIP8_OP_XY(and)
-{
-	data_registers.at(x) &= data_registers.at(y);
-}
-
-CHIP8_OP_XY(xor)
-{
-	data_registers.at(x) ^= data_registers.at(y);
-}
-
-CHIP8_OP_XY(madd)
-{
-	bool carry = data_registers.at(y) >= (0x100 - data_registers.at(x));
-	data_registers.at(x) += data_registers.at(y);
-	data_registers[0xf] = carry;
-}
-
-CHIP8_OP_XY(sub)
-{
-	bool carry = data_registers.at(y) > data_registers.at(x);
-	data_registers.at(x) -= data_registers.at(y);
-	data_registers[0xf] = carry;
-}
-
-CHIP8_OP_X(shiftr)
-{
-	data_registers[0xf] = data_registers.at(x) & 1;
-	data_registers.at(x) >>= 1;
-}
-
-CHIP8_OP_XY(rsub)
-{
-	bool carry = data_registers.at(y) >= data_registers.at(x);
-	data_registers.at(x) = data_registers.at(y) - data_registers.at(x);
-	data_registers[0xf] = carry;
-}
-
-CHIP8_OP_X(shiftl)
-{
-	data_registers[0xf] = (data_registers.at(x) & 0x80) != 0;
-	data_registers.at(x) <<= 1;
-}
-
-CHIP8_OP_XY(if_ncmp)
-{
-	if (data_registers.at(x) != data_registers.at(y)) program_counter += 2;
-}
-
-CHIP8_OP_N(save)
-{
-	address_register = n;
-}
-
-CHIP8_OP_N(jmp)
-{
-	program_counter = data_registers.at(0) + n;
-}
-
-CHIP8_OP_XN(rand)
-{
-	data_registers.at(x) = rng() & n;
-}
-
-CHIP8_OP_XYN(disp)
-{
-	// address register can be over 0x1000???
-	uint16_t sprite_address = address_register;
-	data_registers[0xf] = 0;
-
-	for (uint8_t line = 0; line < n; ++line)
-	{
-		uint8_t row = data_registers.at(y) + line;
-		uint8_t sprite_data = memory.at(sprite_address++);
-
-		for (uint8_t bit = 8; bit --> 0;)
-		{
-			data_registers[0xf] |= set_pixel(data_registers.at(x) + bit, row, sprite_data & 1);
-			sprite_data >>= 1;
+			else if (*c == 'n') std::snprintf(buffer, sizeof(buffer), "%X", n);
+			else
+			{
+				text += *c;
+				continue;
+			}
+			text += buffer;
 		}
+		return text;
 	}
-	screen_dirty = n > 0;
-}
 
-CHIP8_OP_X(press)
-{
-	if (keys.at(data_registers.at(x))) program_counter += 2;
-}
-
-CHIP8_OP_X(release)
-{
-	if (!keys.at(data_registers.at(x))) program_counter += 2;
-}
-
-CHIP8_OP_X(getdel)
-{
-	data_registers.at(x) = delay_timer;
-}
-
-CHIP8_OP_X(wait)
-{
-	waiting_for_input = true;
-	input_register = x;
-}
-
-CHIP8_OP_X(setdel)
-{
-	delay_timer = data_registers.at(x);
-}
-
-CHIP8_OP_X(setsnd)
-{
-	sound_timer = data_registers.at(x);
-}
-
-CHIP8_OP_X(inc)
-{
-	data_registers[0xf] = address_register >= memory_size - data_registers.at(x);
-	address_register = (address_register + data_registers.at(x)) % memory_size;
-}
-
-CHIP8_OP_X(font)
-{
-	// TODO can only find this documented for x=0x0-0xf. what about others?
-	address_register = 0x50 + data_registers.at(x) * 5;
-}
-
-CHIP8_OP_X(deci)
-{
-	uint8_t num = data_registers.at(x);
-
-	memory.at(address_register + 0) = num / 100;
-	memory.at(address_register + 1) = (num % 100) / 10;
-	memory.at(address_register + 2) = num % 10;
-}
-
-CHIP8_OP_X(dump)
-{
-	for (uint8_t i = 0; i <= x; ++i) memory.at(address_register++) = data_registers.at(i);
-}
-
-CHIP8_OP_X(load)
-{
-	for (uint8_t i = 0; i <= x; ++i) data_registers.at(i) = memory.at(address_register++);
+	std::snprintf(buffer, sizeof(buffer), "#%04X", opcode);
+	return std::string("DW ") + buffer;
 }
@@ -1,37 +1,221 @@
+#pragma once
 #include <array>
 #include <cstdint>
-#include <random>
+#include <stdexcept>
 #include <string>
 #include <tuple>
-#include <vector>
+#include "hash.hpp"
 
-#define CHIP8_OP(NAME) void op_ ## NAME (uint16_t, uint8_t, uint8_t);
+class Trace;
 
+#define CHIP8_OP(NAME) constexpr void op_ ## NAME (uint16_t, uint8_t, uint8_t);
+
+// Zobrist keys for the pixels, for Chip8's hash tracking. a table, since DXYN changes many pixels at a time
+constexpr std::array<uint64_t, 64 * 32> make_pixel_keys()
+{
+	std::array<uint64_t, 64 * 32> keys {};
+	for (unsigned int i = 0; i < keys.size(); ++i) keys[i] = hash_mix(0x5eed0000u + i);
+	return keys;
+}
+constexpr std::array<uint64_t, 64 * 32> pixel_keys = make_pixel_keys();
+
+/* The core is constexpr apart from the RNG seeding of the default
+ * constructor, file I/O and tracing, so short programs can run at compile
+ * time: in static_assert tests, or to bake a ROM's boot sequence into a
+ * constant machine that instances are copied from (see boot()).
+ */
 class Chip8
 {
+	// engines execute instructions directly on the machine state
+	friend class FusedEngine;
+
 public:
 	constexpr static unsigned int memory_size = 0x1000;
 	constexpr static unsigned int registers_size = 0x10; // must be nibble-addressable
-	constexpr static unsigned int stack_size = 48; // just initial size, can grow unbounded
+	constexpr static unsigned int stack_size = 48; // historically 24 frames, but allow some headroom
 
 	constexpr static uint16_t program_mem_start = 0x200;
+	constexpr static unsigned int max_rom_size = memory_size - program_mem_start;
+	constexpr static uint16_t font_address = 0x50;
+
+	// memory writes are tracked in pages, so copies of a machine can be restored cheaply
+	constexpr static unsigned int page_size = 0x100;
+	constexpr static uint16_t all_pages = 0xffff; // one bit per page
 
 	constexpr static unsigned int screen_width = 64;
 	constexpr static unsigned int screen_height = 32;
 
+	/* XO-CHIP sound: while the sound timer runs, a 128 bit pattern loaded by
+	 * F002 loops, first byte's top bit first, at 4000 * 2^((pitch - 64) / 48)
+	 * bits per second. FX3A sets the pitch. Until a ROM loads its own, the
+	 * pattern is a square wave of 500 Hz at the default pitch
+	 */
+	constexpr static unsigned int audio_pattern_size = 16;
+	constexpr static uint8_t default_pitch = 64;
+
 	typedef void (Chip8::*opfn_t)(uint16_t, uint8_t, uint8_t);
 
+	// how emulated time passes, see set_timing()
+	enum class Timing : uint8_t
+	{
+		steps, // every instruction costs the same and ticks the timers
+		vip, // instructions cost COSMAC VIP machine cycles, the timers tick at 60 Hz
+	};
+	/* why a machine stopped. a faulted machine stays at the faulting
+	 * instruction, and step() does nothing until it is reset or restored
+	 */
+	enum class Fault : uint8_t
+	{
+		none,
+		invalid_opcode,
+		stack_underflow, // 00EE with nothing to return to
+		stack_overflow,
+		address_out_of_range, // I or PC pointing past memory, or a key past F
+	};
+
+	// 1.7609 MHz at 8 clocks per machine cycle, one display frame at 60 Hz
+	constexpr static uint64_t vip_frame_cycles = 3668;
+	// taken from each frame by the display DMA (128 lines of 8 bytes) and the interrupt routine
+	constexpr static uint64_t vip_interrupt_cycles = 1024 + 48;
+
+	/* everything needed to resume emulation later. keys are left out since
+	 * they belong to the host. this is plain data, so copying is cheap enough
+	 * to do several times per frame
+	 */
+	struct Snapshot
+	{
+		std::array<uint8_t, memory_size> memory;
+		std::array<uint8_t, registers_size> data_registers;
+		uint16_t address_register;
+		std::array<uint16_t, stack_size> stack;
+		uint8_t stack_pointer;
+		uint16_t program_counter;
+		uint8_t delay_timer;
+		uint8_t sound_timer;
+		std::array<uint8_t, audio_pattern_size> audio_pattern;
+		uint8_t pitch;
+		std::array<bool, screen_width * screen_height> screen;
+		bool waiting_for_input;
+		uint8_t input_register;
+		uint32_t random_state;
+		uint64_t cycles;
+	};
+
 private:
+	// hex digit sprites, 5 bytes each, stored from font_address
+	constexpr static std::array<uint8_t, 0x10 * 5> font = {
+		// 0
+		0b01100000,
+		0b10010000,
+		0b10010000,
+		0b10010000,
+		0b01100000,
+		// 1
+		0b00100000,
+		0b01100000,
+		0b00100000,
+		0b00100000,
+		0b01110000,
+		// 2
+		0b11100000,
+		0b00010000,
+		0b01100000,
+		0b10000000,
+		0b11110000,
+		// 3
+		0b11100000,
+		0b00010000,
+		0b01100000,
+		0b00010000,
+		0b11100000,
+		// 4
+		0b10100000,
+		0b10100000,
+		0b11110000,
+		0b00100000,
+		0b00100000,
+		// 5
+		0b11110000,
+		0b10000000,
+		0b11100000,
+		0b00010000,
+		0b11100000,
+		// 6
+		0b01110000,
+		0b10000000,
+		0b11100000,
+		0b10010000,
+		0b11100000,
+		// 7
+		0b11110000,
+		0b00010000,
+		0b00100000,
+		0b01000000,
+		0b01000000,
+		// 8
+		0b01100000,
+		0b10010000,
+		0b01100000,
+		0b10010000,
+		0b01100000,
+		// 9
+		0b01100000,
+		0b10010000,
+		0b01110000,
+		0b00010000,
+		0b11100000,
+		// A
+		0b01100000,
+		0b10010000,
+		0b11110000,
+		0b10010000,
+		0b10010000,
+		// B
+		0b11100000,
+		0b10010000,
+		0b11100000,
+		0b10010000,
+		0b11100000,
+		// C
+		0b01110000,
+		0b10000000,
+		0b10000000,
+		0b10000000,
+		0b01110000,
+		// D
+		0b11100000,
+		0b10010000,
+		0b10010000,
+		0b10010000,
+		0b11100000,
+		// E
+		0b11110000,
+		0b10000000,
+		0b11100000,
+		0b10000000,
+		0b11110000,
+		// F
+		0b11110000,
+		0b10000000,
+		0b11100000,
+		0b10000000,
+		0b10000000,
+	};
+
 	std::array<uint8_t, memory_size> memory {}; // RAM
 	std::array<uint8_t, registers_size> data_registers {}; // V0-VF
 	uint16_t address_register = 0; // I
 
-	std::vector<uint16_t> stack; // historically 24 frames, but how about infinite?
+	std::array<uint16_t, stack_size> stack {};
+	uint8_t stack_pointer = 0; // number of frames on the stack
 	uint16_t program_counter = program_mem_start;
 
 	uint8_t delay_timer = 0;
 	uint8_t sound_timer = 0;
 
+	std::array<uint8_t, audio_pattern_size> audio_pattern {};
+	uint8_t pitch = default_pitch;
+
 	// I/O
 	std::array<bool, screen_width * screen_height> screen {};
 	std::array<bool, registers_size> keys {};
@@ -39,52 +223,183 @@ private:
 	bool waiting_for_input = false;
 	uint8_t input_register = 0;
 
+	Fault fault = Fault::none;
+	uint16_t fault_address = 0;
+
+	// stop the machine at the instruction at address. kept out of line, faults are rare
+	[[gnu::cold, gnu::noinline]] constexpr void raise_fault(Fault code, uint16_t address)
+	{
+		fault = code;
+		fault_address = address;
+		program_counter = address;
+	}
+
+	// VIP timing: machine cycles since reset. display interrupts are due at multiples of vip_frame_cycles
+	Timing timing = Timing::steps;
+	uint64_t cycles = 0;
+
 	bool screen_dirty = true;
 
+	// what changed since the last restore()
+	uint16_t dirty_pages = all_pages;
+	bool screen_touched = true;
+
+	constexpr void mark_dirty(uint16_t address)
+	{
+		dirty_pages |= 1 << (address / page_size);
+	}
+
+	/* with hash tracking on, memory and screen have Zobrist-style digests,
+	 * updated on every write instead of hashing 6 KB whenever hash() is
+	 * called: the XOR of a key for each memory byte and its value, and of a
+	 * key from pixel_keys for each lit pixel
+	 */
+	bool hash_tracking = false;
+	uint64_t memory_digest = 0;
+	uint64_t screen_digest = 0;
+
+	// computed rather than looked up, a table would need 8 MB
+	constexpr static uint64_t memory_key(uint16_t address, uint8_t value)
+	{
+		return hash_mix((static_cast<uint64_t>(address) << 8 | value) * 0x9e3779b97f4a7c15ull);
+	}
+
+	// all interpreter writes to memory go through here
+	constexpr void write_memory(uint16_t address, uint8_t value)
+	{
+		uint8_t& byte = memory.at(address);
+		if (hash_tracking) memory_digest ^= memory_key(address, byte) ^ memory_key(address, value);
+		byte = value;
+		mark_dirty(address);
+	}
+	// the digests from scratch, after bulk changes to memory or screen
+	constexpr void compute_digests(uint64_t&, uint64_t&) const;
+	constexpr void rehash();
+
+	// optional record of executed instructions
+	Trace* trace = nullptr;
+
+	void record_trace(uint16_t, uint16_t, uint8_t);
+
 	// randomness
-	std::default_random_engine random_generator;
-	std::uniform_int_distribution<uint8_t> uniform_distribution;
+	uint32_t random_state = 1;
 
-	uint8_t rng();
+	constexpr uint8_t rng();
 
-	bool set_pixel(uint8_t, uint8_t, bool);
+	constexpr bool set_pixel(uint8_t, uint8_t, bool);
 
-	void reset();
+	// VIP cycles of an instruction about to run, apart from waits and skips
+	constexpr uint64_t vip_cost(uint16_t) const;
+	// let cycles pass, taking any display interrupts (and timer ticks) on the way
+	constexpr void vip_advance(uint64_t);
+	// idle until the next display interrupt has been taken
+	constexpr void vip_wait_interrupt();
+
+	constexpr void reset();
 public:
 	// setup
 	Chip8();
+	constexpr explicit Chip8(unsigned int); // seed the RNG for reproducible runs
+	constexpr void seed(unsigned int);
+	/* with Timing::vip the timers tick on the cycle counter instead of every
+	 * step, DXYN waits for the display interrupt like the original
+	 * interpreter, and FX0A lets frames pass. frontends then run each frame
+	 * until get_cycles() reaches the next multiple of vip_frame_cycles. the
+	 * engines fall back to step() in this mode
+	 */
+	constexpr void set_timing(Timing);
+	// throws std::runtime_error if the file can't be read or is larger than max_rom_size
 	void load_rom(const std::string&);
+	// throws std::length_error if the program is larger than max_rom_size
+	constexpr void load_bytes(const uint8_t*, size_t);
 	template<size_t SIZE>
-	void load_bytes(const std::array<uint8_t, SIZE>& bytes)
+	constexpr void load_bytes(const std::array<uint8_t, SIZE>& bytes)
 	{
 		reset();
 		for (uint16_t i = 0, m = program_mem_start; i < bytes.size() && m < memory_size; ++i, ++m)
 		{
 			memory[m] = bytes[i];
 		}
+		rehash();
+	}
+
+	/* a machine that loaded the ROM and ran steps instructions of it. declared
+	 * constexpr, a ROM's boot code (font setup, title screen) runs while
+	 * compiling and starting an instance only copies the result
+	 */
+	template<size_t SIZE>
+	constexpr static Chip8 boot(const std::array<uint8_t, SIZE>& rom, uint64_t steps, unsigned int seed = 1)
+	{
+		Chip8 chip8(seed);
+		chip8.load_bytes(rom);
+		for (uint64_t i = 0; i < steps; ++i) chip8.step();
+		return chip8;
 	}
 
 	// read state
-	uint16_t get_program_counter() const;
-	uint16_t get_address_register() const;
-	uint8_t get_register(uint16_t) const;
-	uint8_t get_memory(uint16_t) const;
-	bool get_pixel(uint8_t, uint8_t) const;
-	bool beep() const;
+	constexpr uint16_t get_program_counter() const;
+	constexpr uint16_t get_address_register() const;
+	constexpr uint8_t get_register(uint16_t) const;
+	constexpr uint8_t get_memory(uint16_t) const;
+	constexpr unsigned int get_stack_depth() const;
+	constexpr uint16_t get_stack_frame(unsigned int) const; // return address, 0 is the outermost
+	constexpr bool is_waiting() const; // for a key press (FX0A)
+	constexpr Fault get_fault() const;
+	constexpr uint16_t get_fault_address() const; // of the faulting instruction
+	static const char* fault_name(Fault);
+	constexpr bool get_pixel(uint8_t, uint8_t) const;
+	// the whole framebuffer, row-major, for code that converts it in bulk
+	constexpr const std::array<bool, screen_width * screen_height>& get_screen() const { return screen; }
+	constexpr bool beep() const;
+	constexpr const std::array<uint8_t, audio_pattern_size>& get_audio_pattern() const { return audio_pattern; }
+	constexpr uint8_t get_pitch() const { return pitch; }
+	constexpr Timing get_timing() const;
+	// machine cycles since reset, only counted with Timing::vip
+	constexpr uint64_t get_cycles() const;
+	// where the current frame ends with Timing::vip: the cycle count of the next display interrupt
+	constexpr uint64_t next_frame_cycles() const;
+	// hash of the complete machine state except the RNG
+	uint64_t hash() const;
+	/* keep the memory and screen parts of hash() up to date as they are
+	 * written, for callers that hash every frame or more: hash() then only
+	 * has the registers and stack left to mix in. costs a little on every
+	 * memory write and pixel change, off by default. copies keep the setting
+	 */
+	constexpr void set_hash_tracking(bool);
+	constexpr bool get_hash_tracking() const;
+	// hash of the framebuffer alone, for comparing what a ROM shows
+	uint64_t screen_hash() const;
+
+	// save states
+	constexpr void save_state(Snapshot&) const;
+	constexpr void load_state(const Snapshot&);
+	/* become identical to the given machine, which this must be a copy of.
+	 * only memory pages written since the copy (or the last restore) are
+	 * copied back, which makes this much cheaper than reset() or assignment
+	 */
+	void restore(const Chip8&);
+
+	// write to memory from outside the interpreter, e.g. to patch a program
+	constexpr void set_memory(uint16_t, uint8_t);
 
 	// I/O
-	void press(uint8_t);
-	void release(uint8_t);
+	constexpr void press(uint8_t);
+	constexpr void release(uint8_t);
 
-	bool should_draw();
+	constexpr bool should_draw();
 
 	// emulate
-	void step();
+	constexpr void step();
+
+	// record every executed instruction into the given buffer, or stop with nullptr
+	void set_trace(Trace*);
 
 	// get an opcode from a position in memory
-	static uint16_t get_opcode(std::array<uint8_t, memory_size>&, uint16_t);
+	constexpr static uint16_t get_opcode(std::array<uint8_t, memory_size>&, uint16_t);
 	// turn an opcode into a method pointer and arguments for that method
-	static std::tuple<opfn_t, uint16_t, uint8_t, uint8_t> decode_opcode(uint16_t);
+	constexpr static std::tuple<opfn_t, uint16_t, uint8_t, uint8_t> decode_opcode(uint16_t);
+	// turn an opcode into assembly, using the mnemonics from the spec
+	static std::string disassemble(uint16_t);
 
 	/* opcode implementations, all are prefixed with op_ to indicate that.
 	 * The names don't need to be readable because normally these are called
@@ -125,6 +440,726 @@ public:
 	CHIP8_OP(deci); // FX33
 	CHIP8_OP(dump); // FX55
 	CHIP8_OP(load); // FX65
+	CHIP8_OP(pattern); // F002, XO-CHIP
+	CHIP8_OP(pitch); // FX3A, XO-CHIP
 };
 
 #undef CHIP8_OP
+
+// implementations of everything constexpr, which has to be visible to callers
+
+#define OP_PTR(NAME) (&Chip8::op_ ## NAME )
+
+// xorshift32, small enough to run in constant evaluation
+constexpr uint8_t Chip8::rng()
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state >> 24;
+}
+
+constexpr void Chip8::seed(unsigned int value)
+{
+	// spread small seeds over all bits, and keep away from the stuck state 0
+	random_state = (value * 0x9e3779b9u) ^ 0x6d2b79f5u;
+	if (!random_state) random_state = 1;
+}
+
+// XOR pixel x,y with set, return true if it was turned off
+constexpr bool Chip8::set_pixel(uint8_t x, uint8_t y, bool set)
+{
+	x %= screen_width;
+	y %= screen_height;
+
+	unsigned int index = x + y * screen_width;
+	bool prev = screen.at(index);
+	screen[index] = prev ^ set;
+	// sprite bits are as good as random, so no branch on set
+	if (hash_tracking) screen_digest ^= pixel_keys[index] & -static_cast<uint64_t>(set);
+	return prev && set;
+}
+
+constexpr uint64_t Chip8::vip_cost(uint16_t opcode) const
+{
+	/* approximate costs of the original interpreter's routines, each
+	 * including about 40 cycles to fetch and dispatch the instruction
+	 */
+	constexpr uint64_t fetch = 40;
+	uint8_t x = (opcode >> 8) & 0xf;
+	switch (opcode >> 12)
+	{
+		case 0x0: return fetch + (opcode == 0x00e0 ? 24 + 256 * 12 : 10);
+		case 0x1: return fetch + 12;
+		case 0x2: return fetch + 26;
+		case 0x3: case 0x4: return fetch + 10;
+		case 0x5: case 0x9: return fetch + 14;
+		case 0x6: return fetch + 6;
+		case 0x7: return fetch + 10;
+		case 0x8: return fetch + 44;
+		case 0xa: return fetch + 12;
+		case 0xb: return fetch + 22;
+		case 0xc: return fetch + 36;
+		case 0xd:
+		{
+			// every row is shifted into place bit by bit, so unaligned sprites cost more
+			uint8_t shift = data_registers[x] % 8;
+			return fetch + 26 + (opcode & 0xf) * (24 + 4 * shift);
+		}
+		case 0xe: return fetch + 14;
+		case 0xf:
+			switch (opcode & 0xff)
+			{
+				// BCD by repeated subtraction, one round per unit of each digit
+				case 0x33: return fetch + 84 + 16 * (data_registers[x] / 100 + data_registers[x] / 10 % 10 + data_registers[x] % 10);
+				case 0x55: case 0x65: return fetch + 14 + 14 * (x + 1);
+				case 0x1e: case 0x29: return fetch + 16;
+			}
+			return fetch + 10;
+	}
+	return fetch;
+}
+
+constexpr void Chip8::vip_advance(uint64_t count)
+{
+	uint64_t next_interrupt = (cycles / vip_frame_cycles + 1) * vip_frame_cycles;
+	cycles += count;
+	while (cycles >= next_interrupt)
+	{
+		if (delay_timer > 0) --delay_timer;
+		if (sound_timer > 0) --sound_timer;
+		cycles += vip_interrupt_cycles;
+		next_interrupt += vip_frame_cycles;
+	}
+}
+
+constexpr void Chip8::vip_wait_interrupt()
+{
+	vip_advance(vip_frame_cycles - cycles % vip_frame_cycles);
+}
+
+constexpr Chip8::Chip8(unsigned int value)
+{
+	seed(value);
+	reset();
+}
+
+constexpr void Chip8::reset()
+{
+	// plain loops, std::fill and std::copy are only constexpr from C++20
+	for (uint8_t& byte : memory) byte = 0;
+	for (uint8_t& v : data_registers) v = 0;
+	program_counter = address_register = program_mem_start;
+
+	for (uint16_t& frame : stack) frame = 0;
+	stack_pointer = 0;
+
+	delay_timer = 0;
+	sound_timer = 0;
+
+	for (uint8_t& byte : audio_pattern) byte = 0xf0;
+	pitch = default_pitch;
+
+	for (bool& pixel : screen) pixel = false;
+	for (bool& key : keys) key = false;
+
+	waiting_for_input = false;
+	screen_dirty = true;
+	fault = Fault::none;
+
+	cycles = 0;
+
+	for (unsigned int i = 0; i < font.size(); ++i) memory[font_address + i] = font[i];
+
+	dirty_pages = all_pages;
+	screen_touched = true;
+	rehash();
+}
+
+constexpr void Chip8::compute_digests(uint64_t& memory_hash, uint64_t& screen_hash) const
+{
+	memory_hash = 0;
+	for (unsigned int address = 0; address < memory_size; ++address) memory_hash ^= memory_key(address, memory[address]);
+	screen_hash = 0;
+	for (unsigned int index = 0; index < screen.size(); ++index)
+	{
+		if (screen[index]) screen_hash ^= pixel_keys[index];
+	}
+}
+
+constexpr void Chip8::rehash()
+{
+	if (hash_tracking) compute_digests(memory_digest, screen_digest);
+}
+
+constexpr void Chip8::set_hash_tracking(bool on)
+{
+	hash_tracking = on;
+	rehash();
+}
+
+constexpr bool Chip8::get_hash_tracking() const
+{
+	return hash_tracking;
+}
+
+constexpr void Chip8::set_timing(Timing mode)
+{
+	timing = mode;
+}
+
+constexpr Chip8::Timing Chip8::get_timing() const
+{
+	return timing;
+}
+
+constexpr uint64_t Chip8::get_cycles() const
+{
+	return cycles;
+}
+
+constexpr uint64_t Chip8::next_frame_cycles() const
+{
+	return (cycles / vip_frame_cycles + 1) * vip_frame_cycles;
+}
+
+constexpr void Chip8::load_bytes(const uint8_t* bytes, size_t size)
+{
+	if (size > max_rom_size) throw std::length_error("program too large");
+	reset();
+	for (size_t i = 0; i < size; ++i) memory[program_mem_start + i] = bytes[i];
+	rehash();
+}
+
+constexpr uint16_t Chip8::get_program_counter() const
+{
+	return program_counter;
+}
+
+constexpr uint16_t Chip8::get_address_register() const
+{
+	return address_register;
+}
+
+constexpr uint8_t Chip8::get_register(uint16_t x) const
+{
+	return data_registers.at(x);
+}
+
+constexpr uint8_t Chip8::get_memory(uint16_t n) const
+{
+	return memory.at(n);
+}
+
+constexpr unsigned int Chip8::get_stack_depth() const
+{
+	return stack_pointer;
+}
+
+constexpr uint16_t Chip8::get_stack_frame(unsigned int frame) const
+{
+	if (frame >= stack_pointer) throw std::out_of_range("no such stack frame");
+	return stack[frame];
+}
+
+constexpr bool Chip8::is_waiting() const
+{
+	return waiting_for_input;
+}
+
+constexpr Chip8::Fault Chip8::get_fault() const
+{
+	return fault;
+}
+
+constexpr uint16_t Chip8::get_fault_address() const
+{
+	return fault_address;
+}
+
+constexpr bool Chip8::get_pixel(uint8_t x, uint8_t y) const
+{
+	return screen.at(x + y * screen_width);
+}
+
+constexpr bool Chip8::beep() const
+{
+	// TODO does this beep continuously when it's positive, or only once when it hits 0?
+	return sound_timer > 0;
+}
+
+constexpr void Chip8::save_state(Snapshot& snapshot) const
+{
+	snapshot.memory = memory;
+	snapshot.data_registers = data_registers;
+	snapshot.address_register = address_register;
+	snapshot.stack = stack;
+	snapshot.stack_pointer = stack_pointer;
+	snapshot.program_counter = program_counter;
+	snapshot.delay_timer = delay_timer;
+	snapshot.sound_timer = sound_timer;
+	snapshot.audio_pattern = audio_pattern;
+	snapshot.pitch = pitch;
+	snapshot.screen = screen;
+	snapshot.waiting_for_input = waiting_for_input;
+	snapshot.input_register = input_register;
+	snapshot.random_state = random_state;
+	snapshot.cycles = cycles;
+}
+
+constexpr void Chip8::load_state(const Snapshot& snapshot)
+{
+	memory = snapshot.memory;
+	data_registers = snapshot.data_registers;
+	address_register = snapshot.address_register;
+	stack = snapshot.stack;
+	stack_pointer = snapshot.stack_pointer;
+	program_counter = snapshot.program_counter;
+	delay_timer = snapshot.delay_timer;
+	sound_timer = snapshot.sound_timer;
+	audio_pattern = snapshot.audio_pattern;
+	pitch = snapshot.pitch;
+	screen = snapshot.screen;
+	waiting_for_input = snapshot.waiting_for_input;
+	input_register = snapshot.input_register;
+	random_state = snapshot.random_state;
+	cycles = snapshot.cycles;
+	fault = Fault::none; // snapshots are taken from running machines
+
+	screen_dirty = true;
+	dirty_pages = all_pages;
+	screen_touched = true;
+	rehash();
+}
+
+constexpr void Chip8::set_memory(uint16_t address, uint8_t value)
+{
+	write_memory(address, value);
+}
+
+constexpr void Chip8::press(uint8_t key)
+{
+	if (!keys.at(key) && waiting_for_input)
+	{
+		waiting_for_input = false;
+		data_registers.at(input_register) = key;
+	}
+	keys.at(key) = true;
+}
+
+constexpr void Chip8::release(uint8_t key)
+{
+	keys.at(key) = false;
+}
+
+constexpr bool Chip8::should_draw()
+{
+	bool tmp = screen_dirty;
+	screen_dirty = false;
+	return tmp;
+}
+
+constexpr void Chip8::step()
+{
+	if (waiting_for_input || fault != Fault::none)
+	{
+		// the VIP keeps taking display interrupts while it waits for a key
+		if (waiting_for_input && timing == Timing::vip) vip_wait_interrupt();
+		return;
+	}
+
+	// faulting fetches are traced too, as the last record before the machine stops
+	uint16_t address = program_counter;
+	if (address >= memory_size - 1)
+	{
+		if (trace) record_trace(address, 0, 0); // there is no whole opcode to show
+		return raise_fault(Fault::address_out_of_range, address);
+	}
+	uint16_t opcode = memory[address] << 8 | memory[address + 1];
+
+	auto [op, n, x, y] = decode_opcode(opcode);
+	if (!op)
+	{
+		if (trace) record_trace(address, opcode, opcode >> 8 & 0xf);
+		return raise_fault(Fault::invalid_opcode, address);
+	}
+
+	if (timing == Timing::steps)
+	{
+		if (delay_timer > 0) --delay_timer;
+		if (sound_timer > 0) --sound_timer;
+	}
+	program_counter += 2; // each opcode is 2 bytes
+
+	if (timing == Timing::vip)
+	{
+		uint64_t cost = vip_cost(opcode);
+		// sprites are only drawn right after the display interrupt, which avoids tearing
+		if (opcode >> 12 == 0xd) vip_wait_interrupt();
+		(this->*op)(n, x, y);
+
+		// taken skips cost a little more, the other instructions never move on by 4
+		uint8_t group = opcode >> 12;
+		bool skips = group == 0x3 || group == 0x4 || group == 0x5 || group == 0x9 || group == 0xe;
+		if (skips && program_counter == address + 4) cost += 4;
+		vip_advance(cost);
+	}
+	else
+	{
+		(this->*op)(n, x, y);
+	}
+
+	if (trace) record_trace(address, opcode, x);
+}
+
+constexpr uint16_t Chip8::get_opcode(std::array<uint8_t, memory_size>& _memory, uint16_t _counter)
+{
+	return (_memory.at(_counter) << 8) | _memory.at(_counter + 1);
+}
+
+constexpr std::tuple<Chip8::opfn_t, uint16_t, uint8_t, uint8_t> Chip8::decode_opcode(uint16_t opcode)
+{
+	switch (opcode >> 12)
+	{
+		case 0x0:
+			if (opcode == 0x00e0) return {OP_PTR(clear), 0, 0, 0};
+			if (opcode == 0x00ee) return {OP_PTR(ret), 0, 0, 0};
+			break;
+		case 0x1:
+			return {OP_PTR(goto), opcode & 0x0fff, 0, 0};
+		case 0x2:
+			return {OP_PTR(call), opcode & 0x0fff, 0, 0};
+		case 0x3:
+			return {OP_PTR(if_eq), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
+		case 0x4:
+			return {OP_PTR(if_ne), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
+		case 0x5:
+			if ((opcode & 0xf) != 0x0) break;
+			return {OP_PTR(if_cmp), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+		case 0x6:
+			return {OP_PTR(store), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
+		case 0x7:
+			return {OP_PTR(add), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
+		case 0x8:
+			switch (opcode & 0xf)
+			{
+				case 0x0:
+					return {OP_PTR(set), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x1:
+					return {OP_PTR(or), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x2:
+					return {OP_PTR(and), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x3:
+					return {OP_PTR(xor), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x4:
+					return {OP_PTR(madd), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x5:
+					return {OP_PTR(sub), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x6:
+					// Y passed, but unused
+					return {OP_PTR(shiftr), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0x7:
+					return {OP_PTR(rsub), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+				case 0xe:
+					// Y passed, but unused
+					return {OP_PTR(shiftl), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+			}
+			break;
+		case 0x9:
+			if ((opcode & 0xf) != 0x0) break;
+			return {OP_PTR(if_ncmp), 0, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+		case 0xa:
+			return {OP_PTR(save), opcode & 0x0fff, 0, 0};
+		case 0xb:
+			return {OP_PTR(jmp), opcode & 0x0fff, 0, 0};
+		case 0xc:
+			return {OP_PTR(rand), opcode & 0x00ff, (opcode >> 8) & 0xf, 0};
+		case 0xd:
+			return {OP_PTR(disp), opcode & 0x000f, (opcode >> 8) & 0xf, (opcode >> 4) & 0xf};
+		case 0xe:
+			if ((opcode & 0xff) == 0x9e) return {OP_PTR(press), 0, (opcode >> 8) & 0xf, 0};
+			if ((opcode & 0xff) == 0xa1) return {OP_PTR(release), 0, (opcode >> 8) & 0xf, 0};
+			break;
+		case 0xf:
+			switch (opcode & 0xff)
+			{
+				case 0x02:
+					if (opcode != 0xf002) break;
+					return {OP_PTR(pattern), 0, 0, 0};
+				case 0x07:
+					return {OP_PTR(getdel), 0, (opcode >> 8) & 0xf, 0};
+				case 0x0a:
+					return {OP_PTR(wait), 0, (opcode >> 8) & 0xf, 0};
+				case 0x15:
+					return {OP_PTR(setdel), 0, (opcode >> 8) & 0xf, 0};
+				case 0x18:
+					return {OP_PTR(setsnd), 0, (opcode >> 8) & 0xf, 0};
+				case 0x1e:
+					return {OP_PTR(inc), 0, (opcode >> 8) & 0xf, 0};
+				case 0x29:
+					return {OP_PTR(font), 0, (opcode >> 8) & 0xf, 0};
+				case 0x3a:
+					return {OP_PTR(pitch), 0, (opcode >> 8) & 0xf, 0};
+				case 0x33:
+					return {OP_PTR(deci), 0, (opcode >> 8) & 0xf, 0};
+				case 0x55:
+					return {OP_PTR(dump), 0, (opcode >> 8) & 0xf, 0};
+				case 0x65:
+					return {OP_PTR(load), 0, (opcode >> 8) & 0xf, 0};
+			}
+			break;
+	}
+
+	// step() turns this into Fault::invalid_opcode
+	return {nullptr, 0, 0, 0};
+}
+
+#undef OP_PTR
+
+// macros for defining op implementations. since all ops accept all arguments, just omit names of unused ones
+#define CHIP8_OP(NAME) constexpr void Chip8::op_ ## NAME (uint16_t, uint8_t, uint8_t)
+#define CHIP8_OP_X(NAME) constexpr void Chip8::op_ ## NAME (uint16_t, uint8_t x, uint8_t)
+#define CHIP8_OP_N(NAME) constexpr void Chip8::op_ ## NAME (uint16_t n, uint8_t, uint8_t)
+#define CHIP8_OP_XY(NAME) constexpr void Chip8::op_ ## NAME (uint16_t, uint8_t x, uint8_t y)
+#define CHIP8_OP_XN(NAME) constexpr void Chip8::op_ ## NAME (uint16_t n, uint8_t x, uint8_t)
+#define CHIP8_OP_XYN(NAME) constexpr void Chip8::op_ ## NAME (uint16_t n, uint8_t x, uint8_t y)
+
+// opcode implementations
+
+CHIP8_OP(clear)
+{
+	for (bool& pixel : screen) pixel = false;
+	screen_dirty = true;
+	screen_touched = true;
+	screen_digest = 0;
+}
+
+/* ops run with PC already past them, so a faulting op stops the machine at
+ * PC - 2. they check before changing anything
+ */
+
+CHIP8_OP(ret)
+{
+	if (stack_pointer == 0) return raise_fault(Fault::stack_underflow, program_counter - 2);
+
+	program_counter = stack[--stack_pointer];
+}
+
+CHIP8_OP_N(goto)
+{
+	program_counter = n;
+}
+
+CHIP8_OP_N(call)
+{
+	if (stack_pointer == stack_size) return raise_fault(Fault::stack_overflow, program_counter - 2);
+
+	stack[stack_pointer] = program_counter;
+	++stack_pointer;
+	program_counter = n;
+}
+
+CHIP8_OP_XN(if_eq)
+{
+	if (data_registers.at(x) == n) program_counter += 2;
+}
+
+CHIP8_OP_XN(if_ne)
+{
+	if (data_registers.at(x) != n) program_counter += 2;
+}
+
+CHIP8_OP_XY(if_cmp)
+{
+	if (data_registers.at(x) == data_registers.at(y)) program_counter += 2;
+}
+
+CHIP8_OP_XN(store)
+{
+	data_registers.at(x) = n;
+}
+
+CHIP8_OP_XN(add)
+{
+	data_registers.at(x) += n;
+}
+
+CHIP8_OP_XY(set)
+{
+	data_registers.at(x) = data_registers.at(y);
+}
+
+CHIP8_OP_XY(or)
+{
+	data_registers.at(x) |= data_registers.at(y);
+}
+
+CHIP8_OP_XY(and)
+{
+	data_registers.at(x) &= data_registers.at(y);
+}
+
+CHIP8_OP_XY(xor)
+{
+	data_registers.at(x) ^= data_registers.at(y);
+}
+
+CHIP8_OP_XY(madd)
+{
+	bool carry = data_registers.at(y) >= (0x100 - data_registers.at(x));
+	data_registers.at(x) += data_registers.at(y);
+	data_registers[0xf] = carry;
+}
+
+CHIP8_OP_XY(sub)
+{
+	bool carry = data_registers.at(y) > data_registers.at(x);
+	data_registers.at(x) -= data_registers.at(y);
+	data_registers[0xf] = carry;
+}
+
+CHIP8_OP_X(shiftr)
+{
+	data_registers[0xf] = data_registers.at(x) & 1;
+	data_registers.at(x) >>= 1;
+}
+
+CHIP8_OP_XY(rsub)
+{
+	bool carry = data_registers.at(y) >= data_registers.at(x);
+	data_registers.at(x) = data_registers.at(y) - data_registers.at(x);
+	data_registers[0xf] = carry;
+}
+
+CHIP8_OP_X(shiftl)
+{
+	data_registers[0xf] = (data_registers.at(x) & 0x80) != 0;
+	data_registers.at(x) <<= 1;
+}
+
+CHIP8_OP_XY(if_ncmp)
+{
+	if (data_registers.at(x) != data_registers.at(y)) program_counter += 2;
+}
+
+CHIP8_OP_N(save)
+{
+	address_register = n;
+}
+
+CHIP8_OP_N(jmp)
+{
+	program_counter = data_registers.at(0) + n;
+}
+
+CHIP8_OP_XN(rand)
+{
+	data_registers.at(x) = rng() & n;
+}
+
+CHIP8_OP_XYN(disp)
+{
+	if (address_register + n > memory_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+
+	uint16_t sprite_address = address_register;
+	data_registers[0xf] = 0;
+	screen_touched = true;
+
+	for (uint8_t line = 0; line < n; ++line)
+	{
+		uint8_t row = data_registers.at(y) + line;
+		uint8_t sprite_data = memory[sprite_address++];
+
+		for (uint8_t bit = 8; bit --> 0;)
+		{
+			data_registers[0xf] |= set_pixel(data_registers.at(x) + bit, row, sprite_data & 1);
+			sprite_data >>= 1;
+		}
+	}
+	screen_dirty = n > 0;
+}
+
+CHIP8_OP_X(press)
+{
+	if (data_registers.at(x) >= registers_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+	if (keys[data_registers[x]]) program_counter += 2;
+}
+
+CHIP8_OP_X(release)
+{
+	if (data_registers.at(x) >= registers_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+	if (!keys[data_registers[x]]) program_counter += 2;
+}
+
+CHIP8_OP_X(getdel)
+{
+	data_registers.at(x) = delay_timer;
+}
+
+CHIP8_OP_X(wait)
+{
+	waiting_for_input = true;
+	input_register = x;
+}
+
+CHIP8_OP_X(setdel)
+{
+	delay_timer = data_registers.at(x);
+}
+
+CHIP8_OP_X(setsnd)
+{
+	sound_timer = data_registers.at(x);
+}
+
+CHIP8_OP_X(inc)
+{
+	data_registers[0xf] = address_register >= memory_size - data_registers.at(x);
+	address_register = (address_register + data_registers.at(x)) % memory_size;
+}
+
+CHIP8_OP_X(font)
+{
+	// TODO can only find this documented for x=0x0-0xf. what about others?
+	address_register = font_address + data_registers.at(x) * 5;
+}
+
+CHIP8_OP_X(deci)
+{
+	if (address_register + 2u >= memory_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+	uint8_t num = data_registers.at(x);
+
+	write_memory(address_register + 0, num / 100);
+	write_memory(address_register + 1, (num % 100) / 10);
+	write_memory(address_register + 2, num % 10);
+}
+
+CHIP8_OP_X(dump)
+{
+	if (address_register + x >= memory_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+	for (uint8_t i = 0; i <= x; ++i) write_memory(address_register++, data_registers.at(i));
+}
+
+CHIP8_OP_X(load)
+{
+	if (address_register + x >= memory_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+	for (uint8_t i = 0; i <= x; ++i) data_registers.at(i) = memory[address_register++];
+}
+
+CHIP8_OP(pattern)
+{
+	if (address_register + audio_pattern_size > memory_size) return raise_fault(Fault::address_out_of_range, program_counter - 2);
+	for (unsigned int i = 0; i < audio_pattern_size; ++i) audio_pattern[i] = memory[address_register + i];
+}
+
+CHIP8_OP_X(pitch)
+{
+	pitch = data_registers.at(x);
+}
+
+#undef CHIP8_OP
+#undef CHIP8_OP_X
+#undef CHIP8_OP_N
+#undef CHIP8_OP_XY
+#undef CHIP8_OP_XN
+#undef CHIP8_OP_XYN
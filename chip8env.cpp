@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "chip8.hpp"
+#include "chip8env.h"
+#include "fused.hpp"
+#include "workerpool.hpp"
+
+static_assert(CHIP8_ENV_SCREEN_SIZE == Chip8::screen_width * Chip8::screen_height, "screen size mismatch");
+static_assert(CHIP8_ENV_RAM_SIZE == Chip8::memory_size, "memory size mismatch");
+
+struct chip8_env
+{
+	unsigned int count;
+	unsigned int seed;
+	unsigned int observe;
+
+	unsigned int steps_per_frame = 16;
+	int reward_address = -1;
+	int terminal_address = -1;
+	uint8_t terminal_value = 0;
+	uint64_t max_frames = 0;
+	bool auto_reset = true;
+
+	std::vector<Chip8> golden; // each instance's first state, restored cheaply on reset
+	std::vector<Chip8> machines;
+	std::vector<uint64_t> episode_frames;
+	std::vector<uint64_t> episodes;
+
+	// observations, one row per instance
+	std::vector<uint8_t> screens;
+	std::vector<uint8_t> ram;
+	std::vector<float> rewards;
+	std::vector<uint8_t> done;
+	std::vector<uint8_t> faulted;
+
+	// the current batch, read by every thread
+	const uint16_t* actions = nullptr;
+	unsigned int frames = 0;
+	// an engine per thread, last so it stops before anything it uses goes away
+	WorkerPool<FusedEngine> pool;
+
+	chip8_env(unsigned int count, unsigned int threads, unsigned int seed, unsigned int observe) :
+		count(count), seed(seed), observe(observe),
+		episode_frames(count), episodes(count),
+		screens(observe & CHIP8_ENV_OBSERVE_SCREEN ? count * CHIP8_ENV_SCREEN_SIZE : 0),
+		ram(observe & CHIP8_ENV_OBSERVE_RAM ? count * CHIP8_ENV_RAM_SIZE : 0),
+		rewards(count), done(count), faulted(count),
+		pool(count, threads, [this](size_t begin, size_t end, FusedEngine& engine)
+		{
+			for (size_t i = begin; i < end; ++i) step(i, engine);
+		})
+	{
+	}
+
+	bool terminal(unsigned int i) const
+	{
+		if (max_frames && episode_frames[i] >= max_frames) return true;
+		return terminal_address >= 0 && machines[i].get_memory(terminal_address) == terminal_value;
+	}
+
+	void reset(unsigned int i)
+	{
+		machines[i].restore(golden[i]);
+		// restoring brings the RNG back too, so give each episode its own sequence
+		machines[i].seed(seed + i + ++episodes[i] * count);
+		episode_frames[i] = 0;
+	}
+
+	void step(unsigned int i, Engine& runner)
+	{
+		Chip8& chip8 = machines[i];
+		rewards[i] = 0;
+		if (done[i] && !auto_reset) return; // waits for chip8_env_reset
+		done[i] = 0;
+		faulted[i] = 0;
+
+		for (uint8_t key = 0; key < Chip8::registers_size; ++key)
+		{
+			if (actions[i] & (1 << key)) chip8.press(key);
+			else chip8.release(key);
+		}
+
+		uint8_t before = reward_address >= 0 ? chip8.get_memory(reward_address) : 0;
+		bool ended = false;
+		for (unsigned int frame = 0; frame < frames && !ended; ++frame)
+		{
+			if (runner.run(chip8, steps_per_frame) != Chip8::Fault::none)
+			{
+				ended = true;
+				faulted[i] = 1;
+				break;
+			}
+			++episode_frames[i];
+			ended = terminal(i);
+		}
+		if (reward_address >= 0) rewards[i] = static_cast<int8_t>(chip8.get_memory(reward_address) - before);
+
+		if (ended)
+		{
+			done[i] = 1;
+			if (auto_reset) reset(i);
+		}
+		observe_instance(i);
+	}
+
+	void observe_instance(unsigned int i)
+	{
+		Chip8& chip8 = machines[i];
+		if (observe & CHIP8_ENV_OBSERVE_SCREEN)
+		{
+			// the framebuffer already is one 0 or 1 byte per pixel, row-major
+			std::memcpy(screens.data() + static_cast<size_t>(i) * CHIP8_ENV_SCREEN_SIZE, chip8.get_screen().data(), CHIP8_ENV_SCREEN_SIZE);
+		}
+		if (observe & CHIP8_ENV_OBSERVE_RAM)
+		{
+			uint8_t* memory = ram.data() + static_cast<size_t>(i) * CHIP8_ENV_RAM_SIZE;
+			for (uint16_t address = 0; address < Chip8::memory_size; ++address) memory[address] = chip8.get_memory(address);
+		}
+	}
+};
+
+extern "C" {
+
+chip8_env* chip8_env_create(const uint8_t* rom, size_t rom_size, unsigned int count, unsigned int threads, unsigned int seed, unsigned int observe)
+{
+	if (count == 0 || rom_size > Chip8::memory_size - Chip8::program_mem_start) return nullptr;
+
+	chip8_env* env = new chip8_env(count, threads, seed, observe);
+	env->golden.reserve(count);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		env->golden.emplace_back(seed + i);
+		for (size_t b = 0; b < rom_size; ++b) env->golden.back().set_memory(Chip8::program_mem_start + b, rom[b]);
+	}
+	env->machines = env->golden;
+	for (unsigned int i = 0; i < count; ++i) env->observe_instance(i);
+	return env;
+}
+
+void chip8_env_destroy(chip8_env* env)
+{
+	delete env;
+}
+
+unsigned int chip8_env_count(const chip8_env* env)
+{
+	return env->count;
+}
+
+void chip8_env_set_steps_per_frame(chip8_env* env, unsigned int steps)
+{
+	env->steps_per_frame = steps;
+}
+
+void chip8_env_set_reward_address(chip8_env* env, int address)
+{
+	env->reward_address = address < static_cast<int>(Chip8::memory_size) ? address : -1;
+}
+
+void chip8_env_set_terminal(chip8_env* env, int address, uint8_t value)
+{
+	env->terminal_address = address < static_cast<int>(Chip8::memory_size) ? address : -1;
+	env->terminal_value = value;
+}
+
+void chip8_env_set_max_frames(chip8_env* env, uint64_t frames)
+{
+	env->max_frames = frames;
+}
+
+void chip8_env_set_auto_reset(chip8_env* env, int auto_reset)
+{
+	env->auto_reset = auto_reset;
+}
+
+void chip8_env_step_batch(chip8_env* env, const uint16_t* actions, unsigned int frames)
+{
+	// the pool's lock hands these to the workers
+	env->actions = actions;
+	env->frames = frames;
+	env->pool.run();
+}
+
+void chip8_env_reset(chip8_env* env, int index)
+{
+	for (unsigned int i = 0; i < env->count; ++i)
+	{
+		if (index >= 0 && i != static_cast<unsigned int>(index)) continue;
+		env->reset(i);
+		env->done[i] = 0;
+		env->faulted[i] = 0;
+		env->rewards[i] = 0;
+		env->observe_instance(i);
+	}
+}
+
+const uint8_t* chip8_env_screens(const chip8_env* env)
+{
+	return env->screens.empty() ? nullptr : env->screens.data();
+}
+
+const uint8_t* chip8_env_ram(const chip8_env* env)
+{
+	return env->ram.empty() ? nullptr : env->ram.data();
+}
+
+const float* chip8_env_rewards(const chip8_env* env)
+{
+	return env->rewards.data();
+}
+
+const uint8_t* chip8_env_done(const chip8_env* env)
+{
+	return env->done.data();
+}
+
+const uint8_t* chip8_env_faulted(const chip8_env* env)
+{
+	return env->faulted.data();
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef CHIP8ENV_H
+#define CHIP8ENV_H
+
+/* C interface for driving a batch of Chip8 machines from other languages,
+ * e.g. as a vectorised reinforcement learning environment. Built as
+ * libchip8env.so.
+ *
+ * All instances run the same ROM. chip8_env_step_batch() advances all of
+ * them in parallel and then writes observations into contiguous arrays,
+ * one row per instance, which stay at the same address for the lifetime of
+ * the batch. Callers can wrap them once (e.g. as numpy arrays) and read
+ * them after every step without copying.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_ENV_SCREEN_SIZE (64 * 32)
+#define CHIP8_ENV_RAM_SIZE 0x1000
+
+/* observations to keep up to date, for chip8_env_create */
+#define CHIP8_ENV_OBSERVE_SCREEN 1 /* one byte per pixel, 0 or 1 */
+#define CHIP8_ENV_OBSERVE_RAM 2
+
+typedef struct chip8_env chip8_env;
+
+/* count instances of the ROM, each seeded with seed + its index. threads 0
+ * uses all cores. returns NULL if the ROM doesn't fit or count is 0
+ */
+chip8_env* chip8_env_create(const uint8_t* rom, size_t rom_size, unsigned int count, unsigned int threads, unsigned int seed, unsigned int observe);
+void chip8_env_destroy(chip8_env*);
+
+unsigned int chip8_env_count(const chip8_env*);
+
+/* instructions per frame, default 16 */
+void chip8_env_set_steps_per_frame(chip8_env*, unsigned int);
+/* the reward of a step is how much the byte at address grew, e.g. a score.
+ * -1 (the default) gives no reward
+ */
+void chip8_env_set_reward_address(chip8_env*, int address);
+/* an episode ends when the byte at address equals value, -1 to disable */
+void chip8_env_set_terminal(chip8_env*, int address, uint8_t value);
+/* an episode also ends after this many frames, 0 (the default) for never */
+void chip8_env_set_max_frames(chip8_env*, uint64_t);
+/* start a new episode as soon as one ends, on by default. the observations
+ * after such a step are those of the new episode's first state
+ */
+void chip8_env_set_auto_reset(chip8_env*, int);
+
+/* hold the keys in actions[i] (bit k for key k) on instance i and run each
+ * instance for frames frames. instances that are done and not reset
+ * automatically don't move
+ */
+void chip8_env_step_batch(chip8_env*, const uint16_t* actions, unsigned int frames);
+/* start a new episode on one instance, or all with a negative index */
+void chip8_env_reset(chip8_env*, int index);
+
+/* count * CHIP8_ENV_SCREEN_SIZE bytes, row-major 64x32 per instance */
+const uint8_t* chip8_env_screens(const chip8_env*);
+/* count * CHIP8_ENV_RAM_SIZE bytes */
+const uint8_t* chip8_env_ram(const chip8_env*);
+/* count rewards of the last step */
+const float* chip8_env_rewards(const chip8_env*);
+/* count flags, nonzero where the last step ended an episode */
+const uint8_t* chip8_env_done(const chip8_env*);
+/* count flags, nonzero where the episode ended because the ROM faulted */
+const uint8_t* chip8_env_faulted(const chip8_env*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "conformance.hpp"
+#include "engine.hpp"
+
+/* Conformance runner: plays every case of the given manifests on each engine
+ * and compares framebuffer hashes with the golden values.
+ */
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-e ENGINE]... [-i STEPS] [-j THREADS] [-r] MANIFEST...\n"
+		<< "  -e ENGINE   engine to check, may be repeated (default all)\n"
+		<< "  -i STEPS    steps per frame (default 16)\n"
+		<< "  -j THREADS  worker threads (default all cores)\n"
+		<< "  -r          record: write the hashes seen with the first engine into the manifests\n"
+		<< "engines:";
+	for (const std::string& engine : engine_names()) std::cerr << ' ' << engine;
+	std::cerr << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> engines;
+	unsigned int steps_per_frame = 16;
+	unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+	bool record = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "e:i:j:r")) != -1)
+	{
+		switch (opt)
+		{
+			case 'e': engines.push_back(optarg); break;
+			case 'i': steps_per_frame = std::strtoul(optarg, nullptr, 10); break;
+			case 'j': threads = std::max(std::strtoul(optarg, nullptr, 10), 1ul); break;
+			case 'r': record = true; break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (engines.empty()) engines = engine_names();
+	if (record) engines.resize(1);
+	for (const std::string& engine : engines)
+	{
+		if (!make_engine(engine))
+		{
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<std::string> manifests(argv + optind, argv + argc);
+	if (manifests.empty())
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// every case of every manifest, run once per engine
+	std::vector<std::vector<ConformanceCase>> cases(manifests.size());
+	std::vector<std::pair<size_t, size_t>> tests; // manifest, case
+	for (size_t m = 0; m < manifests.size(); ++m)
+	{
+		std::string error;
+		if (!read_manifest(manifests[m], cases[m], error))
+		{
+			std::cerr << error << std::endl;
+			return EXIT_FAILURE;
+		}
+		for (size_t c = 0; c < cases[m].size(); ++c) tests.emplace_back(m, c);
+	}
+
+	std::vector<std::vector<ConformanceResult>> results(manifests.size());
+	for (size_t m = 0; m < manifests.size(); ++m) results[m].resize(cases[m].size());
+
+	size_t jobs = tests.size() * engines.size();
+	std::atomic<size_t> next_job {0};
+	std::atomic<unsigned int> failures {0};
+	std::mutex output;
+
+	auto worker = [&]()
+	{
+		std::vector<std::unique_ptr<Engine>> instances;
+		for (const std::string& engine : engines) instances.push_back(make_engine(engine));
+
+		for (size_t job; (job = next_job++) < jobs;)
+		{
+			size_t e = job % engines.size();
+			size_t m = tests[job / engines.size()].first;
+			size_t c = tests[job / engines.size()].second;
+			const ConformanceCase& test = cases[m][c];
+
+			ConformanceResult result = run_case(test, *instances[e], steps_per_frame);
+			// a recording run only fails when the ROM does
+			if (!result.passed && (!record || result.hashes.size() < test.checks.size()))
+			{
+				++failures;
+				std::lock_guard<std::mutex> lock(output);
+				std::cout << manifests[m] << ": " << test.name << " (" << engines[e] << "): " << result.message << std::endl;
+			}
+			if (record) results[m][c] = result;
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < std::min<size_t>(threads, jobs); ++i) workers.emplace_back(worker);
+	for (std::thread& thread : workers) thread.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	if (record)
+	{
+		for (size_t m = 0; m < manifests.size(); ++m)
+		{
+			if (!record_manifest(manifests[m], cases[m], results[m]))
+			{
+				std::cerr << manifests[m] << ": could not write" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+
+	std::cout << tests.size() << " cases on " << engines.size() << " engines, " << jobs - failures << " of "
+		<< jobs << " passed in " << elapsed.count() << " s" << std::endl;
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "conformance.hpp"
+
+static std::string directory_of(const std::string& path)
+{
+	size_t slash = path.find_last_of('/');
+	return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+static std::string hex(uint64_t value)
+{
+	char text[17];
+	std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+	return text;
+}
+
+static bool read_lines(const std::string& filename, std::vector<std::string>& lines)
+{
+	std::ifstream file(filename);
+	if (!file) return false;
+	std::string line;
+	while (std::getline(file, line)) lines.push_back(line);
+	return true;
+}
+
+bool read_manifest(const std::string& filename, std::vector<ConformanceCase>& cases, std::string& error)
+{
+	std::vector<std::string> lines;
+	if (!read_lines(filename, lines))
+	{
+		error = filename + ": could not read";
+		return false;
+	}
+
+	std::string directory = directory_of(filename);
+	for (size_t number = 0; number < lines.size(); ++number)
+	{
+		std::string line = lines[number].substr(0, lines[number].find('#'));
+		std::istringstream words(line);
+		std::string keyword;
+		if (!(words >> keyword)) continue;
+
+		auto fail = [&](const std::string& message)
+		{
+			error = filename + ":" + std::to_string(number + 1) + ": " + message;
+			return false;
+		};
+
+		if (keyword == "test")
+		{
+			ConformanceCase test;
+			if (!(words >> test.name)) return fail("test needs a ROM");
+			test.rom = test.name[0] == '/' ? test.name : directory + test.name;
+			cases.push_back(test);
+			continue;
+		}
+		if (cases.empty()) return fail(keyword + " before the first test");
+		ConformanceCase& test = cases.back();
+
+		uint64_t frame;
+		if (!(words >> frame)) return fail(keyword + " needs a frame number");
+
+		if (keyword == "frames")
+		{
+			test.frames = frame;
+		}
+		else if (keyword == "press" || keyword == "release")
+		{
+			unsigned int key;
+			if (!(words >> std::hex >> key) || key >= Chip8::registers_size) return fail("bad key");
+			if (!test.inputs.empty() && test.inputs.back().frame > frame) return fail("inputs out of order");
+			test.inputs.push_back({frame, static_cast<uint8_t>(key), keyword == "press"});
+		}
+		else if (keyword == "hash")
+		{
+			std::string value;
+			if (!(words >> value)) return fail("hash needs a value or -");
+			if (!test.checks.empty() && test.checks.back().frame >= frame) return fail("hashes out of order");
+
+			ConformanceCase::Check check = {frame, 0, value != "-", number};
+			if (check.known)
+			{
+				size_t end = 0;
+				try
+				{
+					check.hash = std::stoull(value, &end, 16);
+				}
+				catch (const std::logic_error&)
+				{
+				}
+				if (end != value.size()) return fail("bad hash " + value);
+			}
+			test.checks.push_back(check);
+		}
+		else
+		{
+			return fail("unknown keyword " + keyword);
+		}
+	}
+
+	for (ConformanceCase& test : cases)
+	{
+		if (!test.checks.empty()) test.frames = std::max(test.frames, test.checks.back().frame);
+	}
+	return true;
+}
+
+ConformanceResult run_case(const ConformanceCase& test, Engine& engine, unsigned int steps_per_frame)
+{
+	ConformanceResult result;
+
+	// seeded, so ROMs using random numbers still draw the same every run
+	Chip8 chip8(1);
+	try
+	{
+		chip8.load_rom(test.rom);
+	}
+	catch (const std::runtime_error& e)
+	{
+		result.message = e.what();
+		return result;
+	}
+	engine.invalidate();
+
+	auto input = test.inputs.begin();
+	auto check = test.checks.begin();
+	bool mismatch = false;
+	for (uint64_t frame = 0; frame <= test.frames; ++frame)
+	{
+		// frame counts the frames run so far
+		for (; check != test.checks.end() && check->frame == frame; ++check)
+		{
+			uint64_t hash = chip8.screen_hash();
+			result.hashes.push_back(hash);
+			if (check->known && hash != check->hash && !mismatch)
+			{
+				result.message = "frame " + std::to_string(frame) + ": hash " + hex(hash) + ", expected " + hex(check->hash);
+				mismatch = true;
+			}
+		}
+		for (; input != test.inputs.end() && input->frame == frame; ++input)
+		{
+			if (input->pressed) chip8.press(input->key);
+			else chip8.release(input->key);
+		}
+		if (frame < test.frames && engine.run(chip8, steps_per_frame) != Chip8::Fault::none)
+		{
+			if (!mismatch) result.message = "fault at " + hex(chip8.get_fault_address()).substr(12) + ": " + Chip8::fault_name(chip8.get_fault());
+			return result;
+		}
+	}
+
+	result.passed = !mismatch;
+	return result;
+}
+
+bool record_manifest(const std::string& filename, const std::vector<ConformanceCase>& cases, const std::vector<ConformanceResult>& results)
+{
+	std::vector<std::string> lines;
+	if (!read_lines(filename, lines)) return false;
+
+	for (size_t i = 0; i < cases.size() && i < results.size(); ++i)
+	{
+		const std::vector<ConformanceCase::Check>& checks = cases[i].checks;
+		for (size_t c = 0; c < checks.size() && c < results[i].hashes.size(); ++c)
+		{
+			// keep any comment on the line
+			std::string& line = lines[checks[c].line];
+			size_t comment = line.find('#');
+			std::string rest = comment == std::string::npos ? "" : " " + line.substr(comment);
+			line = "hash " + std::to_string(checks[c].frame) + " " + hex(results[i].hashes[c]) + rest;
+		}
+	}
+
+	std::string temporary = filename + ".tmp";
+	{
+		std::ofstream file(temporary);
+		for (const std::string& line : lines) file << line << '\n';
+		if (!file) return false;
+	}
+	return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "engine.hpp"
+
+/* End to end checks of whole ROMs: run a ROM for a number of frames with
+ * scripted input and compare framebuffer hashes at chosen frames with golden
+ * values. Cases come from a manifest, a text file of blocks like
+ *
+ *   # comment
+ *   test roms/flags.ch8     starts a case, the path is relative to the manifest
+ *   frames 120              frames to run
+ *   press 10 5              after frame 10, press key 5
+ *   release 12 5            after frame 12, release it
+ *   hash 60 0123456789abcdef  framebuffer hash after frame 60, - if not known yet
+ */
+struct ConformanceCase
+{
+	struct Input
+	{
+		uint64_t frame;
+		uint8_t key;
+		bool pressed;
+	};
+
+	struct Check
+	{
+		uint64_t frame;
+		uint64_t hash;
+		bool known; // false for -, which only a recording run fills in
+		size_t line; // in the manifest, to write recorded hashes back
+	};
+
+	std::string name; // the path as written in the manifest
+	std::string rom;
+	uint64_t frames = 0;
+	std::vector<Input> inputs; // in frame order
+	std::vector<Check> checks; // in frame order
+};
+
+struct ConformanceResult
+{
+	bool passed = false;
+	std::string message; // why it failed
+	std::vector<uint64_t> hashes; // seen at each check, for recording
+};
+
+// false with a message naming the line if the manifest can't be used
+bool read_manifest(const std::string&, std::vector<ConformanceCase>&, std::string& error);
+
+ConformanceResult run_case(const ConformanceCase&, Engine&, unsigned int steps_per_frame = 16);
+
+// write the hashes seen back into the manifest, keeping everything else as it was
+bool record_manifest(const std::string&, const std::vector<ConformanceCase>&, const std::vector<ConformanceResult>&);
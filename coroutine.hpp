@@ -0,0 +1,160 @@
+#pragma once
+#include "chip8.hpp"
+#include "engine.hpp"
+
+/* Runs a machine as a C++20 coroutine, for event-driven hosts: instead of
+ * calling step() in a loop and checking should_draw() and beep(), a host
+ * resumes the task and is told why it stopped:
+ *
+ *   frame     a frame is done, resume at the next frame tick
+ *   key_wait  FX0A, resume once a key was pressed. the machine starts a new
+ *             frame then. with VIP timing the frames keep passing while it
+ *             waits, so this never happens and frames end as usual
+ *   budget    the budget ran out in the middle of a frame, resume whenever
+ *             the host has time again
+ *   fault     the machine faulted (see Chip8::get_fault), done for good
+ *
+ * The coroutine frame is allocated once by run_task(). Suspending and
+ * resuming never allocate, so thousands of tasks cost their frames and
+ * nothing more. Only available when compiling as C++20 (make STD=c++20).
+ */
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <algorithm>
+#include <coroutine>
+#include <utility>
+
+class Chip8Task
+{
+public:
+	enum Suspend
+	{
+		frame,
+		key_wait,
+		budget,
+		fault,
+	};
+
+	struct promise_type
+	{
+		Suspend reason = frame;
+		bool draw = false;
+		bool beep = false;
+
+		Chip8Task get_return_object()
+		{
+			return Chip8Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		// nothing runs until the host resumes
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { reason = fault; }
+
+		std::suspend_always yield_value(Suspend why)
+		{
+			reason = why;
+			return {};
+		}
+	};
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	explicit Chip8Task(std::coroutine_handle<promise_type> _handle) : handle(_handle) {}
+public:
+	Chip8Task(Chip8Task&& other) : handle(std::exchange(other.handle, nullptr)) {}
+	Chip8Task& operator=(Chip8Task&& other)
+	{
+		if (handle) handle.destroy();
+		handle = std::exchange(other.handle, nullptr);
+		return *this;
+	}
+	~Chip8Task()
+	{
+		if (handle) handle.destroy();
+	}
+
+	// run until the next suspension, false once the task faulted
+	bool resume()
+	{
+		if (!handle || handle.done()) return false;
+		handle.resume();
+		return !handle.done();
+	}
+	bool done() const { return !handle || handle.done(); }
+
+	// why it stopped last
+	Suspend reason() const { return handle.promise().reason; }
+	// whether the screen changed, or the sound played, during the frame that just ended
+	bool should_draw() const { return handle.promise().draw; }
+	bool beep() const { return handle.promise().beep; }
+};
+
+/* run the machine forever, one frame of steps_per_frame steps (or a frame's
+ * cycles with VIP timing) at a time. with a nonzero budget the task also
+ * suspends after that many steps (cycles with VIP timing) within a frame.
+ * the machine and engine must outlive the task
+ */
+inline Chip8Task run_task(Chip8& chip8, Engine& engine, uint64_t steps_per_frame, uint64_t budget = 0)
+{
+	Chip8Task::promise_type* promise = nullptr;
+	// the promise lives in the coroutine frame, get to it once
+	struct get_promise
+	{
+		Chip8Task::promise_type*& out;
+		bool await_ready() const noexcept { return false; }
+		bool await_suspend(std::coroutine_handle<Chip8Task::promise_type> handle) noexcept
+		{
+			out = &handle.promise();
+			return false; // don't actually suspend
+		}
+		void await_resume() const noexcept {}
+	};
+	co_await get_promise{promise};
+
+	for (;;)
+	{
+		bool vip = chip8.get_timing() == Chip8::Timing::vip;
+		uint64_t end = vip ? chip8.next_frame_cycles() : steps_per_frame;
+		uint64_t done = 0; // steps so far this frame, unused with VIP timing
+		uint64_t since_yield = 0; // steps or cycles
+		bool faulted = false;
+		bool waiting = false;
+		bool draw = false;
+
+		while ((vip ? chip8.get_cycles() : done) < end)
+		{
+			uint64_t before = chip8.get_cycles();
+			uint64_t chunk = end - (vip ? before : done);
+			if (budget) chunk = std::min(chunk, budget - since_yield);
+			if (vip) faulted = engine.run_until(chip8, before + chunk) != Chip8::Fault::none;
+			else faulted = engine.run(chip8, chunk) != Chip8::Fault::none;
+			if (faulted) break;
+			done += chunk;
+			since_yield += vip ? chip8.get_cycles() - before : chunk;
+			draw = chip8.should_draw() || draw;
+
+			// in steps timing a waiting machine does nothing until a key comes
+			if (!vip && chip8.is_waiting())
+			{
+				waiting = true;
+				break;
+			}
+			if (budget && since_yield >= budget && (vip ? chip8.get_cycles() : done) < end)
+			{
+				since_yield = 0;
+				co_yield Chip8Task::budget;
+			}
+		}
+
+		promise->draw = draw;
+		promise->beep = chip8.beep();
+		if (faulted)
+		{
+			promise->reason = Chip8Task::fault;
+			co_return;
+		}
+		co_yield waiting ? Chip8Task::key_wait : Chip8Task::frame;
+	}
+}
+#endif
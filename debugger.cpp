@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <array>
+#include "debugger.hpp"
+
+bool Debugger::armed() const
+{
+	return stepping != Stepping::none || watching || !conditions.empty() || breakpoints.any();
+}
+
+void Debugger::set_breakpoint(uint16_t address)
+{
+	breakpoints.set(address % Chip8::memory_size);
+}
+
+void Debugger::clear_breakpoint(uint16_t address)
+{
+	breakpoints.reset(address % Chip8::memory_size);
+}
+
+bool Debugger::has_breakpoint(uint16_t address) const
+{
+	return breakpoints.test(address % Chip8::memory_size);
+}
+
+void Debugger::watch(uint16_t address, uint16_t length, bool read, bool write)
+{
+	for (unsigned int a = address; a < address + length && a < Chip8::memory_size; ++a)
+	{
+		if (read) read_watches.set(a);
+		if (write) write_watches.set(a);
+	}
+	watching = read_watches.any() || write_watches.any();
+}
+
+void Debugger::unwatch(uint16_t address, uint16_t length)
+{
+	for (unsigned int a = address; a < address + length && a < Chip8::memory_size; ++a)
+	{
+		read_watches.reset(a);
+		write_watches.reset(a);
+	}
+	watching = read_watches.any() || write_watches.any();
+}
+
+void Debugger::watch_register(uint8_t reg, int value)
+{
+	unwatch_register(reg);
+	conditions.push_back({static_cast<uint8_t>(reg % Chip8::registers_size), value});
+}
+
+void Debugger::unwatch_register(uint8_t reg)
+{
+	conditions.erase(std::remove_if(conditions.begin(), conditions.end(), [reg](const Condition& c) { return c.reg == reg; }), conditions.end());
+}
+
+void Debugger::step()
+{
+	stepping = Stepping::step;
+}
+
+void Debugger::step_over(const Chip8& chip8)
+{
+	stepping = Stepping::over;
+	depth = chip8.get_stack_depth();
+}
+
+void Debugger::step_out(const Chip8& chip8)
+{
+	stepping = Stepping::out;
+	depth = chip8.get_stack_depth();
+}
+
+void Debugger::clear()
+{
+	breakpoints.reset();
+	read_watches.reset();
+	write_watches.reset();
+	watching = false;
+	conditions.clear();
+	stepping = Stepping::none;
+	resume_from = -1;
+}
+
+// the memory the next instruction is going to touch, worked out from its opcode
+DebugStop Debugger::check_access(const Chip8& chip8) const
+{
+	DebugStop stop;
+	uint16_t pc = chip8.get_program_counter();
+	if (pc + 1u >= Chip8::memory_size) return stop;
+
+	uint16_t opcode = chip8.get_memory(pc) << 8 | chip8.get_memory(pc + 1);
+	uint8_t x = (opcode >> 8) & 0xf;
+	unsigned int length = 0;
+	const std::bitset<Chip8::memory_size>* watches = nullptr;
+
+	if ((opcode & 0xf000) == 0xd000)
+	{
+		length = opcode & 0xf; // DXYN reads the sprite
+		watches = &read_watches;
+		stop.reason = DebugStop::read;
+	}
+	else if ((opcode & 0xf0ff) == 0xf065)
+	{
+		length = x + 1;
+		watches = &read_watches;
+		stop.reason = DebugStop::read;
+	}
+	else if (opcode == 0xf002)
+	{
+		length = Chip8::audio_pattern_size; // XO-CHIP audio pattern
+		watches = &read_watches;
+		stop.reason = DebugStop::read;
+	}
+	else if ((opcode & 0xf0ff) == 0xf033)
+	{
+		length = 3;
+		watches = &write_watches;
+		stop.reason = DebugStop::write;
+	}
+	else if ((opcode & 0xf0ff) == 0xf055)
+	{
+		length = x + 1;
+		watches = &write_watches;
+		stop.reason = DebugStop::write;
+	}
+
+	uint16_t start = chip8.get_address_register();
+	for (unsigned int a = start; a < start + length && a < Chip8::memory_size; ++a)
+	{
+		if (watches->test(a))
+		{
+			stop.address = a;
+			return stop;
+		}
+	}
+	stop.reason = DebugStop::none;
+	return stop;
+}
+
+bool Debugger::execute(Chip8& chip8, DebugStop& stop)
+{
+	if (chip8.get_fault() != Chip8::Fault::none)
+	{
+		stop.reason = DebugStop::fault;
+		stop.address = chip8.get_fault_address();
+		return true;
+	}
+	// nothing executes while FX0A waits, it only lets VIP frames pass
+	if (chip8.is_waiting())
+	{
+		chip8.step();
+		return false;
+	}
+
+	uint16_t pc = chip8.get_program_counter();
+	if (has_breakpoint(pc) && pc != resume_from)
+	{
+		stop.reason = DebugStop::breakpoint;
+		stop.address = pc;
+		resume_from = pc;
+		return true;
+	}
+
+	DebugStop access;
+	if (watching) access = check_access(chip8);
+	std::array<uint8_t, Chip8::registers_size> before {};
+	for (const Condition& condition : conditions) before[condition.reg] = chip8.get_register(condition.reg);
+
+	chip8.step();
+	++stop.steps;
+	resume_from = -1;
+
+	if (chip8.get_fault() != Chip8::Fault::none)
+	{
+		stop.reason = DebugStop::fault;
+		stop.address = chip8.get_fault_address();
+		return true;
+	}
+	if (access.reason != DebugStop::none)
+	{
+		stop.reason = access.reason;
+		stop.address = access.address;
+		return true;
+	}
+
+	for (const Condition& condition : conditions)
+	{
+		uint8_t value = chip8.get_register(condition.reg);
+		bool changed = value != before[condition.reg];
+		if (changed && (condition.value < 0 || value == condition.value))
+		{
+			stop.reason = DebugStop::register_changed;
+			stop.address = condition.reg;
+			return true;
+		}
+	}
+
+	bool stepped = false;
+	switch (stepping)
+	{
+		case Stepping::none: break;
+		case Stepping::step: stepped = true; break;
+		case Stepping::over: stepped = chip8.get_stack_depth() <= depth; break;
+		case Stepping::out: stepped = chip8.get_stack_depth() < depth; break;
+	}
+	if (stepped)
+	{
+		stepping = Stepping::none;
+		stop.reason = DebugStop::step;
+		return true;
+	}
+	return false;
+}
+
+DebugStop Debugger::run(Chip8& chip8, Engine& engine, uint64_t steps)
+{
+	DebugStop stop;
+	if (!armed())
+	{
+		if (engine.run(chip8, steps, &stop.steps) != Chip8::Fault::none) [[unlikely]]
+		{
+			stop.reason = DebugStop::fault;
+			stop.address = chip8.get_fault_address();
+		}
+		return stop;
+	}
+
+	for (uint64_t i = 0; i < steps; ++i)
+	{
+		if (execute(chip8, stop)) break;
+	}
+	// a later run() starts where this one stopped
+	if (stop.reason != DebugStop::none) resume_from = chip8.get_program_counter();
+	return stop;
+}
+
+DebugStop Debugger::run_until(Chip8& chip8, Engine& engine, uint64_t cycles)
+{
+	DebugStop stop;
+	if (!armed())
+	{
+		if (engine.run_until(chip8, cycles, &stop.steps) != Chip8::Fault::none) [[unlikely]]
+		{
+			stop.reason = DebugStop::fault;
+			stop.address = chip8.get_fault_address();
+		}
+		return stop;
+	}
+
+	while (chip8.get_timing() == Chip8::Timing::vip && chip8.get_cycles() < cycles)
+	{
+		if (execute(chip8, stop)) break;
+	}
+	if (stop.reason != DebugStop::none) resume_from = chip8.get_program_counter();
+	return stop;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+#include "engine.hpp"
+
+// why the debugger stopped the machine
+struct DebugStop
+{
+	enum Reason
+	{
+		none, // ran all the steps asked for
+		breakpoint, // about to execute address
+		read, // the last instruction read memory at address
+		write, // the last instruction wrote memory at address
+		register_changed, // the last instruction changed register address
+		step, // a single step, step over or step out finished
+		fault, // the instruction at address faulted, see Chip8::get_fault
+	};
+
+	Reason reason = none;
+	uint16_t address = 0;
+	uint64_t steps = 0; // instructions executed, the faulting one included, see Engine::run
+};
+
+/* Breakpoints, watchpoints and stepping over a machine run by any engine.
+ *
+ * While nothing is armed, run() hands the whole batch to the engine, so a
+ * debugger that is not in use costs one check per batch. Once something is
+ * armed it steps the interpreter itself and checks each instruction, which
+ * is slow but only happens while debugging.
+ */
+class Debugger
+{
+	enum class Stepping
+	{
+		none,
+		step,
+		over, // until the stack is back to depth
+		out, // until the stack is shallower than depth
+	};
+
+	std::bitset<Chip8::memory_size> breakpoints;
+	std::bitset<Chip8::memory_size> read_watches;
+	std::bitset<Chip8::memory_size> write_watches;
+	bool watching = false;
+
+	struct Condition
+	{
+		uint8_t reg;
+		int value; // stop when the register becomes this, or on any change if negative
+	};
+	std::vector<Condition> conditions;
+
+	Stepping stepping = Stepping::none;
+	unsigned int depth = 0;
+
+	// where the last stop left the machine, so resuming doesn't stop there again. -1 for none
+	int resume_from = -1;
+
+	DebugStop check_access(const Chip8&) const;
+	// one instruction with every check, true if it stopped the machine
+	bool execute(Chip8&, DebugStop&);
+public:
+	bool armed() const;
+
+	// stop before executing the instruction at an address
+	void set_breakpoint(uint16_t);
+	void clear_breakpoint(uint16_t);
+	bool has_breakpoint(uint16_t) const;
+
+	// stop after an instruction reads and/or writes any of length bytes from address
+	void watch(uint16_t address, uint16_t length, bool read, bool write);
+	void unwatch(uint16_t address, uint16_t length);
+
+	// stop after VX changes, or only when it becomes value
+	void watch_register(uint8_t, int value = -1);
+	void unwatch_register(uint8_t);
+
+	// stop after the next instruction
+	void step();
+	// like step, but run a called subroutine to its return
+	void step_over(const Chip8&);
+	// run until the current subroutine returns
+	void step_out(const Chip8&);
+
+	void clear();
+
+	/* run up to steps instructions, stopping early for anything armed. a
+	 * breakpoint where the last stop left the machine is not hit again, so
+	 * calling run() after a stop continues. steps spent waiting for a key
+	 * (FX0A) count towards the batch, but check nothing, finish no step and
+	 * aren't counted in DebugStop::steps
+	 */
+	DebugStop run(Chip8&, Engine&, uint64_t steps);
+	// the same for VIP timing, until the cycle count reaches cycles (see Engine::run_until)
+	DebugStop run_until(Chip8&, Engine&, uint64_t cycles);
+};
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#include "debugserver.hpp"
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static void put_hex(std::string& out, uint8_t byte)
+{
+	out += hex_digits[byte >> 4];
+	out += hex_digits[byte & 0xf];
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// decode pairs of hex digits, false if any is malformed
+static bool get_hex(const std::string& in, size_t pos, size_t count, uint8_t* out)
+{
+	if (pos + count * 2 > in.size()) return false;
+	for (size_t i = 0; i < count; ++i)
+	{
+		int high = hex_value(in[pos + i * 2]);
+		int low = hex_value(in[pos + i * 2 + 1]);
+		if (high < 0 || low < 0) return false;
+		out[i] = high << 4 | low;
+	}
+	return true;
+}
+
+// a hex number ending at a separator, false if there are no digits
+static bool get_number(const std::string& in, size_t& pos, unsigned int& value)
+{
+	size_t start = pos;
+	value = 0;
+	for (int digit; pos < in.size() && (digit = hex_value(in[pos])) >= 0 && value < 0x100000; ++pos)
+	{
+		value = value << 4 | digit;
+	}
+	return pos > start;
+}
+
+DebugServer::DebugServer(const std::string& path) : path(path)
+{
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) return;
+	std::strcpy(address.sun_path, path.c_str());
+
+	listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (listener < 0) return;
+
+	// a socket left behind by an earlier run would make bind fail
+	unlink(path.c_str());
+	if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 1) < 0)
+	{
+		close(listener);
+		listener = -1;
+	}
+}
+
+DebugServer::~DebugServer()
+{
+	if (client >= 0) close(client);
+	if (listener >= 0)
+	{
+		close(listener);
+		unlink(path.c_str());
+	}
+}
+
+bool DebugServer::is_listening() const
+{
+	return listener >= 0;
+}
+
+bool DebugServer::is_attached() const
+{
+	return client >= 0;
+}
+
+bool DebugServer::is_halted() const
+{
+	return halted;
+}
+
+// send as much of the queue as the socket takes, false if the connection is broken
+bool DebugServer::flush()
+{
+	size_t sent = 0;
+	while (sent < unsent.size())
+	{
+		ssize_t n = ::send(client, unsent.data() + sent, unsent.size() - sent, MSG_NOSIGNAL);
+		if (n > 0) sent += n;
+		else if (n < 0 && errno == EINTR) continue;
+		else if (n < 0 && errno == EAGAIN) break;
+		else
+		{
+			unsent.clear();
+			return false;
+		}
+	}
+	unsent.erase(0, sent);
+	return true;
+}
+
+// queued behind anything not sent yet, so replies keep their order
+void DebugServer::write(const std::string& data)
+{
+	if (client < 0) return;
+	unsent += data;
+	// a broken connection shows up as a failed recv on the next poll
+	flush();
+}
+
+void DebugServer::send(const std::string& data)
+{
+	uint8_t checksum = 0;
+	for (char c : data) checksum += c;
+	std::string packet = "$" + data + "#";
+	put_hex(packet, checksum);
+	write(packet);
+}
+
+void DebugServer::detach(Debugger& debugger)
+{
+	debugger.clear();
+	halted = false;
+	received.clear();
+	unsent.clear();
+	if (client >= 0) close(client);
+	client = -1;
+}
+
+void DebugServer::poll(Chip8& chip8, Debugger& debugger)
+{
+	if (listener < 0) return;
+
+	if (client < 0)
+	{
+		client = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (client < 0) return;
+		// a new client finds the machine halted
+		halted = true;
+		received.clear();
+		unsent.clear();
+	}
+
+	if (!flush() || unsent.size() > max_unsent)
+	{
+		detach(debugger);
+		return;
+	}
+
+	char buffer[0x1000];
+	for (;;)
+	{
+		ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+		if (n > 0)
+		{
+			received.append(buffer, n);
+			continue;
+		}
+		if (n < 0 && (errno == EAGAIN || errno == EINTR)) break;
+		// closed or broken, which counts as detaching
+		detach(debugger);
+		return;
+	}
+
+	size_t pos = 0;
+	while (pos < received.size() && client >= 0)
+	{
+		char c = received[pos];
+		if (c == '\x03')
+		{
+			++pos;
+			if (!halted)
+			{
+				halted = true;
+				send("S02"); // SIGINT
+			}
+			continue;
+		}
+		if (c != '$')
+		{
+			++pos; // acknowledgements and noise
+			continue;
+		}
+
+		size_t end = received.find('#', pos);
+		if (end == std::string::npos || end + 2 >= received.size()) break; // not complete yet
+
+		std::string packet = received.substr(pos + 1, end - pos - 1);
+		uint8_t checksum = 0;
+		for (char p : packet) checksum += p;
+		uint8_t expected;
+		bool valid = get_hex(received, end + 1, 1, &expected) && expected == checksum;
+		pos = end + 3;
+
+		write(valid ? "+" : "-");
+		if (valid) handle(packet, chip8, debugger);
+	}
+	if (client >= 0) received.erase(0, pos);
+}
+
+void DebugServer::stopped(const DebugStop& stop)
+{
+	halted = true;
+
+	char reply[32];
+	switch (stop.reason)
+	{
+		case DebugStop::breakpoint: std::snprintf(reply, sizeof(reply), "T05swbreak:;"); break;
+		case DebugStop::write: std::snprintf(reply, sizeof(reply), "T05watch:%x;", stop.address); break;
+		case DebugStop::read: std::snprintf(reply, sizeof(reply), "T05rwatch:%x;", stop.address); break;
+		case DebugStop::fault: std::snprintf(reply, sizeof(reply), "S0b"); break; // SIGSEGV
+		default: std::snprintf(reply, sizeof(reply), "S05"); break;
+	}
+	send(reply);
+}
+
+void DebugServer::handle(const std::string& packet, Chip8& chip8, Debugger& debugger)
+{
+	char command = packet.empty() ? 0 : packet[0];
+	size_t pos = 1;
+	unsigned int address, length;
+
+	switch (command)
+	{
+		case '?':
+			send(halted ? "S05" : "S00");
+			return;
+
+		case 'g':
+		{
+			Chip8::Snapshot state;
+			chip8.save_state(state);
+			std::string out;
+			for (uint8_t v : state.data_registers) put_hex(out, v);
+			put_hex(out, state.address_register & 0xff);
+			put_hex(out, state.address_register >> 8);
+			put_hex(out, state.program_counter & 0xff);
+			put_hex(out, state.program_counter >> 8);
+			put_hex(out, state.stack_pointer);
+			put_hex(out, state.delay_timer);
+			put_hex(out, state.sound_timer);
+			send(out);
+			return;
+		}
+
+		case 'G':
+		{
+			uint8_t bytes[Chip8::registers_size + 7];
+			if (!get_hex(packet, 1, sizeof(bytes), bytes))
+			{
+				send("E01");
+				return;
+			}
+			Chip8::Snapshot state;
+			chip8.save_state(state);
+			std::copy(bytes, bytes + Chip8::registers_size, state.data_registers.begin());
+			const uint8_t* rest = bytes + Chip8::registers_size;
+			state.address_register = rest[0] | rest[1] << 8;
+			state.program_counter = (rest[2] | rest[3] << 8) % Chip8::memory_size;
+			state.stack_pointer = rest[4] < Chip8::stack_size ? rest[4] : Chip8::stack_size;
+			state.delay_timer = rest[5];
+			state.sound_timer = rest[6];
+			chip8.load_state(state);
+			send("OK");
+			return;
+		}
+
+		case 'm':
+		case 'M':
+		{
+			if (!get_number(packet, pos, address) || pos >= packet.size() || packet[pos++] != ','
+				|| !get_number(packet, pos, length) || address + length > Chip8::memory_size)
+			{
+				send("E01");
+				return;
+			}
+			if (command == 'm')
+			{
+				std::string out;
+				for (unsigned int a = address; a < address + length; ++a) put_hex(out, chip8.get_memory(a));
+				send(out);
+				return;
+			}
+
+			std::vector<uint8_t> bytes(length);
+			if (pos >= packet.size() || packet[pos++] != ':' || !get_hex(packet, pos, length, bytes.data()))
+			{
+				send("E01");
+				return;
+			}
+			for (unsigned int i = 0; i < length; ++i) chip8.set_memory(address + i, bytes[i]);
+			send("OK");
+			return;
+		}
+
+		case 'Z':
+		case 'z':
+		{
+			char type = packet.size() > 1 ? packet[1] : 0;
+			pos = 2;
+			if (pos >= packet.size() || packet[pos++] != ',' || !get_number(packet, pos, address)
+				|| pos >= packet.size() || packet[pos++] != ',' || !get_number(packet, pos, length))
+			{
+				send("E01");
+				return;
+			}
+			bool set = command == 'Z';
+			switch (type)
+			{
+				case '0':
+				case '1':
+					if (set) debugger.set_breakpoint(address);
+					else debugger.clear_breakpoint(address);
+					break;
+				case '2':
+				case '3':
+				case '4':
+					// removing one kind of watchpoint removes every kind at those addresses
+					if (set) debugger.watch(address, length, type != '2', type != '3');
+					else debugger.unwatch(address, length);
+					break;
+				default:
+					send("");
+					return;
+			}
+			send("OK");
+			return;
+		}
+
+		case 'c':
+			halted = false;
+			return;
+
+		case 's':
+			debugger.step();
+			halted = false;
+			return;
+
+		case 'D':
+		case 'k':
+			send("OK");
+			detach(debugger);
+			return;
+
+		case 'q':
+			if (packet == "qSnapshot:save")
+			{
+				chip8.save_state(snapshot);
+				has_snapshot = true;
+				send("OK");
+				return;
+			}
+			if (packet == "qSnapshot:load")
+			{
+				if (!has_snapshot)
+				{
+					send("E02");
+					return;
+				}
+				chip8.load_state(snapshot);
+				send("OK");
+				return;
+			}
+			if (packet.compare(0, 10, "qSupported") == 0)
+			{
+				send("PacketSize=4000;swbreak+");
+				return;
+			}
+			break;
+	}
+
+	// anything else is unsupported, which the protocol says with an empty reply
+	send("");
+}
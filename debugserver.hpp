@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include "chip8.hpp"
+#include "debugger.hpp"
+
+/* Remote debugging over a Unix domain socket, with GDB remote serial
+ * protocol framing ($packet#checksum, acknowledged with +).
+ *
+ * Supported packets:
+ *   ?               why the machine is halted
+ *   g / G           read / write registers, as hex bytes in this order:
+ *                   V0-VF, I and PC as 16 bit little endian, then SP, DT, ST
+ *   m / M           read / write memory, "mADDR,LENGTH" and "MADDR,LENGTH:BYTES"
+ *   Z0 / z0         set / clear a breakpoint, "Z0,ADDR,KIND"
+ *   Z2 Z3 Z4 / z    set / clear a write, read or access watchpoint
+ *   c / s           continue / single step
+ *   D / k           detach, leaving the machine running
+ *   qSnapshot:save  keep a snapshot of the machine in the server
+ *   qSnapshot:load  go back to it
+ *   Ctrl-C (0x03)   halt a running machine
+ *
+ * A client can attach to a running instance at any time, which halts the
+ * machine, and detach again, which clears all breakpoints and resumes it.
+ * The socket is only polled, so nothing blocks the emulation loop. Replies
+ * the socket has no room for are queued and sent on later polls, and a
+ * client that stops reading altogether is dropped.
+ */
+class DebugServer
+{
+public:
+	// queued bytes at which a client counts as gone, many times any reply
+	constexpr static size_t max_unsent = 0x100000;
+
+private:
+	std::string path;
+	int listener = -1;
+	int client = -1;
+
+	std::string received; // bytes not yet making up a whole packet
+	std::string unsent; // bytes the socket had no room for yet
+	bool halted = false;
+
+	Chip8::Snapshot snapshot;
+	bool has_snapshot = false;
+
+	void write(const std::string&);
+	bool flush();
+	void send(const std::string&);
+	void detach(Debugger&);
+	void handle(const std::string&, Chip8&, Debugger&);
+public:
+	explicit DebugServer(const std::string& path);
+	~DebugServer();
+	DebugServer(const DebugServer&) = delete;
+	DebugServer& operator=(const DebugServer&) = delete;
+
+	bool is_listening() const;
+	bool is_attached() const;
+	// while halted the frontend must not run the machine
+	bool is_halted() const;
+
+	// accept a client and handle whatever it sent, without blocking
+	void poll(Chip8&, Debugger&);
+	// the debugger stopped the machine: halt and tell the client why
+	void stopped(const DebugStop&);
+};
@@ -0,0 +1,64 @@
+#include "delta.hpp"
+
+static void put_varint(std::vector<uint8_t>& out, size_t value)
+{
+	while (value >= 0x80)
+	{
+		out.push_back((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(value);
+}
+
+static size_t get_varint(const uint8_t* in, size_t in_size, size_t& pos)
+{
+	size_t value = 0;
+	for (unsigned int shift = 0; pos < in_size; shift += 7)
+	{
+		uint8_t byte = in[pos++];
+		value |= static_cast<size_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) break;
+	}
+	return value;
+}
+
+void delta_encode(const uint8_t* base, const uint8_t* current, size_t size, std::vector<uint8_t>& out)
+{
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t zeros = i;
+		while (zeros < size && base[zeros] == current[zeros]) ++zeros;
+
+		// a single matching byte costs less as a literal than as a new pair
+		size_t literals = zeros;
+		while (literals < size && (base[literals] != current[literals]
+			|| (literals + 1 < size && base[literals + 1] != current[literals + 1])))
+		{
+			++literals;
+		}
+
+		put_varint(out, zeros - i);
+		put_varint(out, literals - zeros);
+		for (size_t j = zeros; j < literals; ++j) out.push_back(base[j] ^ current[j]);
+
+		i = literals;
+	}
+}
+
+void delta_apply(const std::vector<uint8_t>& delta, uint8_t* image, size_t size)
+{
+	delta_apply(delta.data(), delta.size(), image, size);
+}
+
+void delta_apply(const uint8_t* delta, size_t delta_size, uint8_t* image, size_t size)
+{
+	size_t pos = 0;
+	size_t i = 0;
+	while (pos < delta_size && i < size)
+	{
+		i += get_varint(delta, delta_size, pos);
+		size_t literals = get_varint(delta, delta_size, pos);
+		for (size_t j = 0; j < literals && i < size && pos < delta_size; ++j) image[i++] ^= delta[pos++];
+	}
+}
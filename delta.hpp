@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* Delta compression for machine images. The current image is XORed against a
+ * base image so unchanged bytes become zero, then the result is run-length
+ * encoded as alternating (zero run, literal run) pairs. Run lengths are stored
+ * as little-endian base 128 varints.
+ */
+
+// append the compressed difference between base and current to out
+void delta_encode(const uint8_t* base, const uint8_t* current, size_t size, std::vector<uint8_t>& out);
+// XOR a compressed difference back into image, turning base into current (and vice versa)
+void delta_apply(const std::vector<uint8_t>& delta, uint8_t* image, size_t size);
+// the same for a difference stored somewhere else, e.g. packed with others in one buffer
+void delta_apply(const uint8_t* delta, size_t delta_size, uint8_t* image, size_t size);
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "engine.hpp"
+#include "lockstep.hpp"
+
+/* Differential testing: runs two engines in lockstep over ROM files and
+ * random programs, and reports the first instruction where they disagree.
+ */
+
+// random but decodable program, with jumps kept inside it so it runs for a while
+static std::array<uint8_t, Chip8::memory_size - Chip8::program_mem_start> random_program(unsigned int seed)
+{
+	std::array<uint8_t, Chip8::memory_size - Chip8::program_mem_start> program {};
+	std::mt19937 generator(seed);
+
+	constexpr uint16_t words = 0x100;
+	for (uint16_t i = 0; i < words; ++i)
+	{
+		uint16_t opcode;
+		do opcode = generator();
+		while (!std::get<0>(Chip8::decode_opcode(opcode)));
+
+		// keep control flow and I in the program
+		uint8_t kind = opcode >> 12;
+		if (kind == 0x1 || kind == 0x2 || kind == 0xa)
+			opcode = (opcode & 0xf000) | (Chip8::program_mem_start + (generator() % words) * 2);
+		else if (kind == 0xb)
+			opcode = 0xb000 | Chip8::program_mem_start;
+
+		program[i * 2] = opcode >> 8;
+		program[i * 2 + 1] = opcode & 0xff;
+	}
+
+	return program;
+}
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-a ENGINE] [-b ENGINE] [-n STEPS] [-c INTERVAL] [-r PROGRAMS] [-s SEED] [-j THREADS] [ROM...]\n"
+		<< "  -a, -b ENGINE  engines to compare (default reference)\n"
+		<< "  -n STEPS       steps to run each program for (default 10000000)\n"
+		<< "  -c INTERVAL    steps between state comparisons (default 4096)\n"
+		<< "  -r PROGRAMS    also run this many random programs (default 0)\n"
+		<< "  -s SEED        seed for random programs and input (default 1)\n"
+		<< "  -j THREADS     worker threads (default all cores)\n"
+		<< "engines:";
+	for (const std::string& engine : engine_names()) std::cerr << ' ' << engine;
+	std::cerr << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	std::string engine_a = "reference";
+	std::string engine_b = "reference";
+	uint64_t steps = 10000000;
+	uint64_t interval = 0x1000;
+	unsigned int programs = 0;
+	unsigned int seed = 1;
+	unsigned int threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+	int opt;
+	while ((opt = getopt(argc, argv, "a:b:n:c:r:s:j:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'a': engine_a = optarg; break;
+			case 'b': engine_b = optarg; break;
+			case 'n': steps = std::strtoull(optarg, nullptr, 10); break;
+			case 'c': interval = std::strtoull(optarg, nullptr, 10); break;
+			case 'r': programs = std::strtoul(optarg, nullptr, 10); break;
+			case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+			case 'j': threads = std::max(std::strtoul(optarg, nullptr, 10), 1ul); break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (!make_engine(engine_a) || !make_engine(engine_b))
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::string> roms(argv + optind, argv + argc);
+	size_t jobs = roms.size() + programs;
+	if (jobs == 0)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::atomic<size_t> next_job {0};
+	std::atomic<uint64_t> total_steps {0};
+	std::atomic<unsigned int> divergences {0};
+	std::atomic<unsigned int> failures {0}; // ROMs that couldn't be loaded
+	std::mutex output;
+
+	auto worker = [&]()
+	{
+		auto a = make_engine(engine_a);
+		auto b = make_engine(engine_b);
+		Lockstep lockstep(*a, *b, interval);
+
+		for (size_t job; (job = next_job++) < jobs;)
+		{
+			unsigned int job_seed = seed + job;
+			Chip8 chip8(job_seed);
+			std::string name;
+			if (job < roms.size())
+			{
+				name = roms[job];
+				try
+				{
+					chip8.load_rom(name);
+				}
+				catch (const std::exception& e)
+				{
+					++failures;
+					std::lock_guard<std::mutex> lock(output);
+					std::cerr << e.what() << std::endl;
+					continue;
+				}
+			}
+			else
+			{
+				name = "random program " + std::to_string(job_seed);
+				chip8.load_bytes(random_program(job_seed));
+			}
+
+			LockstepResult result = lockstep.run(chip8, steps, job_seed);
+			total_steps += result.steps;
+
+			if (result.diverged)
+			{
+				++divergences;
+				std::lock_guard<std::mutex> lock(output);
+				std::cout << name << ": diverged after " << result.steps << " steps at "
+					<< std::hex << result.program_counter << ": " << Chip8::disassemble(result.opcode) << std::dec << std::endl;
+			}
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < std::min<size_t>(threads, jobs); ++i) workers.emplace_back(worker);
+	for (std::thread& thread : workers) thread.join();
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << jobs << " programs, " << total_steps << " steps in each engine, "
+		<< divergences << " divergences, " << failures << " not loaded, "
+		<< total_steps / elapsed.count() / 1e6 << " million steps/s" << std::endl;
+
+	return divergences || failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
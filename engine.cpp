@@ -0,0 +1,50 @@
+#include "engine.hpp"
+#include "fused.hpp"
+
+const char* ReferenceEngine::name() const
+{
+	return "reference";
+}
+
+Chip8::Fault ReferenceEngine::run(Chip8& chip8, uint64_t steps, uint64_t* executed)
+{
+	if (chip8.get_fault() != Chip8::Fault::none) return chip8.get_fault();
+
+	uint64_t count = 0;
+	for (uint64_t i = 0; i < steps; ++i)
+	{
+		count += !chip8.is_waiting();
+		chip8.step();
+		if (chip8.get_fault() != Chip8::Fault::none) [[unlikely]] break;
+	}
+	if (executed) *executed += count;
+	return chip8.get_fault();
+}
+
+Chip8::Fault Engine::run_until(Chip8& chip8, uint64_t cycles, uint64_t* steps)
+{
+	// machines with steps timing never count cycles
+	while (chip8.get_timing() == Chip8::Timing::vip && chip8.get_cycles() < cycles)
+	{
+		if (run(chip8, 1, steps) != Chip8::Fault::none) break;
+	}
+	return chip8.get_fault();
+}
+
+Chip8::Fault Engine::run_frame(Chip8& chip8, uint64_t steps_per_frame)
+{
+	if (chip8.get_timing() == Chip8::Timing::vip) return run_until(chip8, chip8.next_frame_cycles());
+	return run(chip8, steps_per_frame);
+}
+
+std::unique_ptr<Engine> make_engine(const std::string& name)
+{
+	if (name == "reference") return std::make_unique<ReferenceEngine>();
+	if (name == "fused") return std::make_unique<FusedEngine>();
+	return nullptr;
+}
+
+std::vector<std::string> engine_names()
+{
+	return {"reference", "fused"};
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chip8.hpp"
+
+/* A way of executing Chip8 instructions. Every engine must leave the machine
+ * in exactly the state the reference engine (Chip8::step) would, which the
+ * lockstep harness checks.
+ */
+class Engine
+{
+public:
+	virtual ~Engine() = default;
+
+	virtual const char* name() const = 0;
+	/* execute exactly this many steps, or stop early at a fault, which is
+	 * returned (Fault::none otherwise). the machine stays faulted. executed,
+	 * if given, is increased by the instructions executed, the faulting one
+	 * included. steps waiting for a key (FX0A) execute nothing
+	 */
+	virtual Chip8::Fault run(Chip8&, uint64_t steps, uint64_t* executed = nullptr) = 0;
+	/* with VIP timing, run until the cycle count reaches cycles, one
+	 * instruction at a time since their costs vary. stops early at a fault.
+	 * steps, if given, is increased by the instructions executed as for run
+	 */
+	Chip8::Fault run_until(Chip8&, uint64_t cycles, uint64_t* steps = nullptr);
+	// one display frame: steps_per_frame steps, or up to the next display interrupt with VIP timing
+	Chip8::Fault run_frame(Chip8&, uint64_t steps_per_frame);
+	// forget anything cached about the machine, e.g. after its state was replaced
+	virtual void invalidate() {}
+};
+
+class ReferenceEngine : public Engine
+{
+public:
+	const char* name() const override;
+	Chip8::Fault run(Chip8&, uint64_t steps, uint64_t* executed = nullptr) override;
+};
+
+// engines by name, for tools that let the user choose. nullptr for unknown names
+std::unique_ptr<Engine> make_engine(const std::string&);
+std::vector<std::string> engine_names();
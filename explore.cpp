@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "engine.hpp"
+#include "explorer.hpp"
+
+/* Finds the shortest key sequences that make a ROM write a value to a memory
+ * address, e.g. a level counter or a "solved" flag, and prints them one per
+ * line, "-" for a decision with no key held.
+ */
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " -g ADDRESS=VALUE [-e ENGINE] [-i STEPS] [-f FRAMES] [-d DEPTH] [-n STATES] [-b WIDTH] [-s ADDRESS] [-k SOLUTIONS] [-j THREADS] [-V] ROM\n"
+		<< "  -g ADDRESS=VALUE  goal: the byte at ADDRESS holds VALUE (0x for hex)\n"
+		<< "  -e ENGINE         engine to run with (default reference)\n"
+		<< "  -i STEPS          steps per frame (default 16)\n"
+		<< "  -f FRAMES         frames each key is held for (default 1)\n"
+		<< "  -d DEPTH          most decisions to search (default 60)\n"
+		<< "  -n STATES         most states to store (default 1048576)\n"
+		<< "  -b WIDTH          beam search keeping WIDTH states per depth (default all)\n"
+		<< "  -s ADDRESS        score for the beam: the byte at ADDRESS, higher is better\n"
+		<< "  -k SOLUTIONS      solutions to print (default 1)\n"
+		<< "  -j THREADS        worker threads (default all cores)\n"
+		<< "  -V                COSMAC VIP timing\n"
+		<< "engines:";
+	for (const std::string& engine : engine_names()) std::cerr << ' ' << engine;
+	std::cerr << '\n';
+}
+
+// false unless the whole argument is a number below limit
+static bool parse(const std::string& text, unsigned long limit, unsigned long& value)
+{
+	char* end = nullptr;
+	value = std::strtoul(text.c_str(), &end, 0);
+	return !text.empty() && *end == 0 && value < limit;
+}
+
+int main(int argc, char** argv)
+{
+	Explorer::Options options;
+	long goal_address = -1;
+	unsigned long goal_value = 0;
+	long score_address = -1;
+	bool vip_timing = false;
+
+	int opt;
+	unsigned long value;
+	while ((opt = getopt(argc, argv, "g:e:i:f:d:n:b:s:k:j:V")) != -1)
+	{
+		std::string arg = optarg ? optarg : "";
+		bool ok = true;
+		switch (opt)
+		{
+			case 'g':
+			{
+				size_t equals = arg.find('=');
+				ok = equals != std::string::npos && parse(arg.substr(0, equals), Chip8::memory_size, value)
+					&& parse(arg.substr(equals + 1), 0x100, goal_value);
+				goal_address = value;
+				break;
+			}
+			case 'e': options.engine = arg; break;
+			case 'i': options.steps_per_frame = std::strtoull(optarg, nullptr, 10); break;
+			case 'f': options.frames_per_decision = std::max(std::strtoul(optarg, nullptr, 10), 1ul); break;
+			case 'd': options.max_depth = std::strtoul(optarg, nullptr, 10); break;
+			case 'n': options.max_states = std::strtoull(optarg, nullptr, 10); break;
+			case 'b': options.beam_width = std::strtoull(optarg, nullptr, 10); break;
+			case 's':
+				ok = parse(arg, Chip8::memory_size, value);
+				score_address = value;
+				break;
+			case 'k': options.max_solutions = std::max(std::strtoul(optarg, nullptr, 10), 1ul); break;
+			case 'j': options.threads = std::max(std::strtoul(optarg, nullptr, 10), 1ul); break;
+			case 'V': vip_timing = true; break;
+			default: ok = false; break;
+		}
+		if (!ok)
+		{
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (goal_address < 0 || !make_engine(options.engine) || optind + 1 != argc)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Chip8 chip8(1);
+	try
+	{
+		chip8.load_rom(argv[optind]);
+	}
+	catch (const std::runtime_error& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (vip_timing) chip8.set_timing(Chip8::Timing::vip);
+
+	auto goal = [goal_address, goal_value](const Chip8& state) { return state.get_memory(goal_address) == goal_value; };
+	Explorer::score_t score;
+	if (score_address >= 0) score = [score_address](const Chip8& state) { return state.get_memory(score_address); };
+
+	Explorer explorer(chip8, options);
+	auto start = std::chrono::steady_clock::now();
+	Explorer::Result result = explorer.search(goal, score);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	for (const std::vector<uint8_t>& solution : result.solutions)
+	{
+		for (size_t i = 0; i < solution.size(); ++i)
+		{
+			if (i) std::cout << ' ';
+			if (solution[i] == Explorer::no_key) std::cout << '-';
+			else std::cout << std::hex << std::uppercase << +solution[i] << std::dec;
+		}
+		std::cout << std::endl;
+	}
+
+	std::cerr << result.states << " states to depth " << result.depth << " in " << elapsed.count() << " s, "
+		<< result.state_bytes / std::max<size_t>(result.states, 1) << " bytes per state, "
+		<< result.table_bytes / 1024 << " KB table";
+	if (result.solutions.empty())
+	{
+		if (result.exhausted) std::cerr << ", every reachable state searched";
+		else if (result.truncated) std::cerr << ", out of states";
+		else std::cerr << ", out of depth";
+	}
+	std::cerr << std::endl;
+	return result.solutions.empty() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include "delta.hpp"
+#include "explorer.hpp"
+
+StateTable::StateTable(size_t capacity)
+{
+	size_t size = 16;
+	while (size < capacity) size <<= 1;
+	slots = std::make_unique<std::atomic<uint64_t>[]>(size);
+	for (size_t i = 0; i < size; ++i) slots[i].store(0, std::memory_order_relaxed);
+	mask = size - 1;
+}
+
+bool StateTable::insert(uint64_t hash)
+{
+	// 0 marks empty slots
+	if (!hash) hash = 1;
+	for (size_t probe = 0, i = hash & mask; probe <= mask; ++probe, i = (i + 1) & mask)
+	{
+		uint64_t slot = slots[i].load(std::memory_order_relaxed);
+		if (slot == hash) return false;
+		if (slot) continue;
+		if (slots[i].compare_exchange_strong(slot, hash, std::memory_order_relaxed))
+		{
+			++count;
+			return true;
+		}
+		// another thread took the slot first, maybe with the same hash
+		if (slot == hash) return false;
+	}
+	return false;
+}
+
+bool StateTable::contains(uint64_t hash) const
+{
+	if (!hash) hash = 1;
+	for (size_t probe = 0, i = hash & mask; probe <= mask; ++probe, i = (i + 1) & mask)
+	{
+		uint64_t slot = slots[i].load(std::memory_order_relaxed);
+		if (slot == hash) return true;
+		if (!slot) return false;
+	}
+	return false;
+}
+
+Explorer::Explorer(const Chip8& _start, const Options& _options) : options(_options), start(_start)
+{
+	if (!make_engine(options.engine)) throw std::invalid_argument("unknown engine " + options.engine);
+	options.max_states = std::clamp<size_t>(options.max_states, 1, UINT32_MAX);
+
+	// keys are only ever held during a decision
+	for (uint8_t key = 0; key < Chip8::registers_size; ++key) start.release(key);
+	start.set_hash_tracking(true);
+
+	// zeroed first, so the padding is the same in every snapshot and never shows up in deltas
+	std::memset(static_cast<void*>(&root), 0, sizeof(root));
+	start.save_state(root);
+}
+
+void Explorer::advance(Chip8& chip8, Engine& engine, uint8_t key, const Options& options)
+{
+	chip8.seed(static_cast<unsigned int>(chip8.hash() ^ key));
+	if (key < Chip8::registers_size) chip8.press(key);
+
+	for (unsigned int frame = 0; frame < options.frames_per_decision; ++frame)
+	{
+		if (engine.run_frame(chip8, options.steps_per_frame) != Chip8::Fault::none) break;
+	}
+
+	if (key < Chip8::registers_size) chip8.release(key);
+}
+
+void Explorer::rebuild(uint32_t index, Chip8::Snapshot& out) const
+{
+	std::memcpy(static_cast<void*>(&out), &root, sizeof(out));
+	uint8_t* image = reinterpret_cast<uint8_t*>(&out);
+	// XORs commute, so the deltas can be applied walking up from the node
+	for (; index; index = nodes[index].parent)
+	{
+		delta_apply(deltas.data() + nodes[index].delta, nodes[index].delta_size, image, sizeof(out));
+	}
+}
+
+std::vector<uint8_t> Explorer::path(uint32_t index) const
+{
+	std::vector<uint8_t> keys;
+	for (; index; index = nodes[index].parent) keys.push_back(nodes[index].key);
+	std::reverse(keys.begin(), keys.end());
+	return keys;
+}
+
+Explorer::Result Explorer::search(const goal_t& goal, const score_t& score)
+{
+	Result result;
+	nodes.assign(1, Node {0, 0, 0, no_key});
+	deltas.clear();
+
+	// at most half full, so probes stay short
+	StateTable table(options.max_states * 2);
+	table.insert(start.hash());
+	if (goal(start))
+	{
+		result.solutions.emplace_back();
+		result.states = 1;
+		return result;
+	}
+
+	unsigned int threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<uint32_t> frontier {0};
+
+	while (result.depth < options.max_depth && !frontier.empty() && result.solutions.empty() && !result.truncated)
+	{
+		std::atomic<size_t> next {0};
+		std::atomic<size_t> stored {nodes.size()};
+		std::atomic<bool> truncated {false};
+		std::vector<std::vector<Child>> children(threads);
+		std::vector<std::vector<uint8_t>> child_deltas(threads);
+
+		auto worker = [&](unsigned int thread)
+		{
+			std::unique_ptr<Engine> engine = make_engine(options.engine);
+			std::vector<Child>& found = children[thread];
+			std::vector<uint8_t>& encoded = child_deltas[thread];
+
+			Chip8::Snapshot parent_state;
+			Chip8::Snapshot child_state;
+			std::memset(static_cast<void*>(&child_state), 0, sizeof(child_state));
+			const uint8_t* parent_image = reinterpret_cast<const uint8_t*>(&parent_state);
+			const uint8_t* child_image = reinterpret_cast<const uint8_t*>(&child_state);
+			Chip8 parent = start;
+			Chip8 child = start;
+
+			// a few parents at a time, they vary a lot in cost
+			constexpr size_t batch = 8;
+			for (size_t first; (first = next.fetch_add(batch)) < frontier.size();)
+			{
+				for (size_t i = first; i < std::min(first + batch, frontier.size()); ++i)
+				{
+					uint32_t index = frontier[i];
+					rebuild(index, parent_state);
+					parent.load_state(parent_state);
+					child = parent;
+
+					for (uint8_t key = 0; key < choices; ++key)
+					{
+						// each child only copies back the pages the previous one wrote
+						if (key) child.restore(parent);
+						advance(child, *engine, key, options);
+						if (child.get_fault() != Chip8::Fault::none) continue;
+						if (!table.insert(child.hash())) continue;
+						if (stored++ >= options.max_states)
+						{
+							truncated = true;
+							continue;
+						}
+
+						child.save_state(child_state);
+						size_t offset = encoded.size();
+						delta_encode(parent_image, child_image, sizeof(child_state), encoded);
+						found.push_back({index, key, goal(child), score ? score(child) : 0, offset, static_cast<uint16_t>(encoded.size() - offset)});
+					}
+				}
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (unsigned int thread = 1; thread < threads; ++thread) workers.emplace_back(worker, thread);
+		worker(0);
+		for (std::thread& thread : workers) thread.join();
+
+		// the same order however the work was split up
+		std::vector<std::pair<unsigned int, size_t>> order;
+		for (unsigned int thread = 0; thread < threads; ++thread)
+		{
+			for (size_t i = 0; i < children[thread].size(); ++i) order.emplace_back(thread, i);
+		}
+		auto child = [&](const std::pair<unsigned int, size_t>& at) -> const Child& { return children[at.first][at.second]; };
+		auto before = [&](const auto& a, const auto& b)
+		{
+			return child(a).parent < child(b).parent || (child(a).parent == child(b).parent && child(a).key < child(b).key);
+		};
+		std::sort(order.begin(), order.end(), before);
+
+		if (options.beam_width && order.size() > options.beam_width)
+		{
+			// goals first, then the best scores
+			auto better = [&](const auto& a, const auto& b)
+			{
+				if (child(a).goal != child(b).goal) return child(a).goal;
+				if (child(a).score != child(b).score) return child(a).score > child(b).score;
+				return before(a, b);
+			};
+			std::nth_element(order.begin(), order.begin() + options.beam_width, order.end(), better);
+			order.resize(options.beam_width);
+			std::sort(order.begin(), order.end(), before);
+		}
+
+		frontier.clear();
+		for (const auto& at : order)
+		{
+			const Child& found = child(at);
+			nodes.push_back({deltas.size(), found.parent, found.delta_size, found.key});
+			const uint8_t* delta = child_deltas[at.first].data() + found.delta;
+			deltas.insert(deltas.end(), delta, delta + found.delta_size);
+
+			uint32_t index = nodes.size() - 1;
+			frontier.push_back(index);
+			if (found.goal && result.solutions.size() < options.max_solutions) result.solutions.push_back(path(index));
+		}
+
+		++result.depth;
+		result.truncated = truncated;
+	}
+
+	result.exhausted = frontier.empty();
+	result.states = nodes.size();
+	result.state_bytes = nodes.capacity() * sizeof(Node) + deltas.capacity();
+	result.table_bytes = table.capacity() * sizeof(uint64_t);
+	return result;
+}
+
+Chip8 Explorer::replay(const std::vector<uint8_t>& keys) const
+{
+	Chip8 chip8 = start;
+	std::unique_ptr<Engine> engine = make_engine(options.engine);
+	for (uint8_t key : keys) advance(chip8, *engine, key, options);
+	return chip8;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "chip8.hpp"
+#include "engine.hpp"
+
+/* Set of state hashes that many threads insert into at once, without locks:
+ * open addressing with linear probing, each slot claimed with a
+ * compare-and-swap. The size is fixed, keep it well below capacity.
+ */
+class StateTable
+{
+	std::unique_ptr<std::atomic<uint64_t>[]> slots;
+	size_t mask;
+	std::atomic<size_t> count {0};
+public:
+	// capacity is rounded up to a power of two
+	explicit StateTable(size_t capacity);
+
+	// false if the hash was already there (or the table is full)
+	bool insert(uint64_t);
+	bool contains(uint64_t) const;
+	size_t size() const { return count; }
+	size_t capacity() const { return mask + 1; }
+};
+
+/* Searches the inputs a ROM can be given, for play-testing and for finding
+ * the shortest way to a goal. At every decision one of the 16 keys (or no
+ * key) is held for a few frames, so each state has 17 children. States are
+ * deduplicated by their hash, and searched breadth first, one depth at a
+ * time, spread over threads. With a beam width only the best scoring states
+ * of each depth are kept, which reaches deeper at the risk of missing paths.
+ *
+ * Each stored state costs a small node plus its snapshot XORed against its
+ * parent's and run-length encoded, which is usually tens of bytes: a
+ * decision changes a few registers, some memory and some pixels. A state is
+ * rebuilt by applying the deltas on its path to the start.
+ *
+ * The RNG isn't part of the state hash, so before each decision it is seeded
+ * from the hash and the key. That keeps children a function of the state,
+ * and advance() repeats it when replaying a solution.
+ */
+class Explorer
+{
+public:
+	constexpr static uint8_t no_key = Chip8::registers_size;
+	constexpr static unsigned int choices = Chip8::registers_size + 1;
+
+	struct Options
+	{
+		std::string engine = "reference";
+		uint64_t steps_per_frame = 16; // ignored with VIP timing, which runs whole frames
+		unsigned int frames_per_decision = 1;
+		unsigned int max_depth = 60;
+		size_t max_states = 1 << 20;
+		size_t beam_width = 0; // 0 keeps every state
+		size_t max_solutions = 1;
+		unsigned int threads = 0; // 0 for all cores
+	};
+
+	// called from every thread at once, so they must not change anything shared
+	typedef std::function<bool(const Chip8&)> goal_t;
+	typedef std::function<int64_t(const Chip8&)> score_t; // higher is better
+
+	struct Result
+	{
+		// key sequences reaching the goal, all of the shortest length found
+		std::vector<std::vector<uint8_t>> solutions;
+		unsigned int depth = 0; // decisions searched
+		size_t states = 0; // distinct states stored
+		bool exhausted = false; // no new states were left, nothing more can be found
+		bool truncated = false; // stopped at max_states
+		size_t state_bytes = 0; // nodes and their deltas
+		size_t table_bytes = 0; // sized by max_states up front
+	};
+
+private:
+	struct Node
+	{
+		uint64_t delta; // offset into deltas
+		uint32_t parent;
+		uint16_t delta_size;
+		uint8_t key;
+	};
+
+	// a new state found while expanding, kept per thread until the depth is done
+	struct Child
+	{
+		uint32_t parent;
+		uint8_t key;
+		bool goal;
+		int64_t score;
+		uint64_t delta; // offset into the thread's deltas
+		uint16_t delta_size;
+	};
+
+	Chip8::Snapshot root;
+	Options options;
+	Chip8 start;
+
+	std::vector<Node> nodes;
+	std::vector<uint8_t> deltas;
+
+	void rebuild(uint32_t, Chip8::Snapshot&) const;
+	std::vector<uint8_t> path(uint32_t) const;
+public:
+	Explorer(const Chip8&, const Options&);
+
+	Result search(const goal_t&, const score_t& = nullptr);
+
+	// one decision as search() makes it: hold the key (or no_key) for the frames, then let go
+	static void advance(Chip8&, Engine&, uint8_t, const Options&);
+	// the state a key sequence leads to from the start
+	Chip8 replay(const std::vector<uint8_t>&) const;
+};
@@ -0,0 +1,172 @@
+#include "engine.hpp"
+#include "fused.hpp"
+
+// instructions are fetched three at a time, as the low 48 bits of a word
+constexpr static uint64_t code_masks[] = {0, 0xffff00000000, 0xffffffff0000, 0xffffffffffff};
+
+static uint16_t opcode_at(uint64_t code, unsigned int index)
+{
+	return (code >> (32 - index * 16)) & 0xffff;
+}
+
+FusedEngine::FusedEngine() : cache(Chip8::memory_size)
+{
+}
+
+const char* FusedEngine::name() const
+{
+	return "fused";
+}
+
+void FusedEngine::decode(Entry& entry, uint64_t code)
+{
+	uint16_t first = opcode_at(code, 0);
+	uint16_t second = opcode_at(code, 1);
+	uint16_t third = opcode_at(code, 2);
+
+	auto [op, n, x, y] = Chip8::decode_opcode(first);
+	entry.op = op;
+	entry.n = n;
+	entry.x = x;
+	entry.y = y;
+
+	auto [_, n2, x2, y2] = Chip8::decode_opcode(second);
+	entry.n2 = n2;
+	entry.x2 = x2;
+	entry.y2 = y2;
+	entry.target = third & 0x0fff;
+
+	bool loops_on_x = (second >> 12) == 0x3 && x2 == x && (third >> 12) == 0x1;
+
+	if (!op) entry.kind = Kind::invalid;
+	else if ((first >> 12) == 0x6 && (second >> 12) == 0x6) entry.kind = Kind::store_pair;
+	else if ((first >> 12) == 0xa && (second >> 12) == 0xd) entry.kind = Kind::draw;
+	else if ((first >> 12) == 0x7 && loops_on_x) entry.kind = Kind::count_loop;
+	else if ((first & 0xf0ff) == 0xf007 && loops_on_x) entry.kind = Kind::timer_wait;
+	else entry.kind = Kind::single;
+
+	switch (entry.kind)
+	{
+		case Kind::store_pair:
+		case Kind::draw:
+			entry.length = 2;
+			break;
+		case Kind::count_loop:
+		case Kind::timer_wait:
+			entry.length = 3;
+			break;
+		default:
+			entry.length = 1;
+			break;
+	}
+
+	entry.mask = code_masks[entry.length];
+	entry.code = code & entry.mask;
+}
+
+Chip8::Fault FusedEngine::run(Chip8& chip8, uint64_t steps, uint64_t* counted)
+{
+	// traces need every instruction to go through step, and so does cycle counting
+	if (chip8.trace || chip8.timing != Chip8::Timing::steps) return ReferenceEngine().run(chip8, steps, counted);
+
+	auto tick = [&chip8]()
+	{
+		if (chip8.delay_timer > 0) --chip8.delay_timer;
+		if (chip8.sound_timer > 0) --chip8.sound_timer;
+	};
+	auto& v = chip8.data_registers;
+
+	uint64_t executed = 0;
+	while (executed < steps)
+	{
+		// nothing changes until a key is pressed, which can't happen during a run
+		if (chip8.waiting_for_input || chip8.fault != Chip8::Fault::none) break;
+
+		uint16_t start = chip8.program_counter;
+		if (start + 6u > Chip8::memory_size)
+		{
+			chip8.step();
+			++executed;
+			continue;
+		}
+
+		const auto& memory = chip8.memory;
+		uint64_t code = static_cast<uint64_t>(memory[start]) << 40 | static_cast<uint64_t>(memory[start + 1]) << 32
+			| static_cast<uint64_t>(memory[start + 2]) << 24 | static_cast<uint64_t>(memory[start + 3]) << 16
+			| static_cast<uint64_t>(memory[start + 4]) << 8 | memory[start + 5];
+
+		Entry& entry = cache[start];
+		if (!entry.mask || (code & entry.mask) != entry.code) decode(entry, code);
+
+		++dispatches;
+		uint64_t remaining = steps - executed;
+
+		// sequences that don't fit in the remaining steps run one instruction at a time
+		Kind kind = entry.length <= remaining ? entry.kind : Kind::single;
+		if (kind == Kind::single && !entry.op) kind = Kind::invalid;
+
+		switch (kind)
+		{
+			case Kind::invalid:
+				chip8.step(); // faults
+				++executed;
+				break;
+			case Kind::single:
+				tick();
+				chip8.program_counter += 2;
+				(chip8.*entry.op)(entry.n, entry.x, entry.y);
+				++executed;
+				break;
+			case Kind::store_pair:
+				tick();
+				v[entry.x] = entry.n;
+				tick();
+				v[entry.x2] = entry.n2;
+				chip8.program_counter += 4;
+				executed += 2;
+				break;
+			case Kind::draw:
+				tick();
+				chip8.address_register = entry.n;
+				tick();
+				chip8.program_counter += 4;
+				executed += 2;
+				chip8.op_disp(entry.n2, entry.x2, entry.y2);
+				break;
+			case Kind::count_loop:
+			case Kind::timer_wait:
+				do
+				{
+					tick();
+					if (kind == Kind::count_loop) v[entry.x] += entry.n;
+					else v[entry.x] = chip8.delay_timer;
+
+					tick();
+					if (v[entry.x] == entry.n2)
+					{
+						chip8.program_counter = start + 6;
+						executed += 2;
+						break;
+					}
+
+					tick();
+					chip8.program_counter = entry.target;
+					executed += 3;
+				}
+				while (entry.target == start && steps - executed >= 3);
+				break;
+		}
+	}
+	if (counted) *counted += executed;
+	return chip8.fault;
+}
+
+void FusedEngine::invalidate()
+{
+	for (Entry& entry : cache) entry = Entry();
+}
+
+uint64_t FusedEngine::get_dispatches() const
+{
+	return dispatches;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+#include "engine.hpp"
+
+/* Engine that predecodes instructions per address and fuses common
+ * sequences into superinstructions, so they cost one dispatch:
+ *
+ *   6XNN 6YNN       register setup
+ *   ANNN DXYN       sprite draws
+ *   7XNN 3XNN 1NNN  counted loops
+ *   FX07 3XNN 1NNN  waits on the delay timer
+ *
+ * Loops that jump back to their own start run to completion without going
+ * back to the dispatcher. Each cache entry keeps the bytes it was decoded
+ * from and is only used while memory still holds them, so self modifying
+ * code and restored states need no explicit invalidation.
+ *
+ * The candidates were picked by hand from opcode pair and triple statistics
+ * over a ROM corpus, see opstats.
+ */
+class FusedEngine : public Engine
+{
+public:
+	enum class Kind : uint8_t
+	{
+		invalid, // not decodable, left to Chip8::step to report
+		single,
+		store_pair,
+		draw,
+		count_loop,
+		timer_wait,
+	};
+
+private:
+	struct Entry
+	{
+		uint64_t code = 0; // up to three opcodes this was decoded from
+		uint64_t mask = 0; // the part of code that matters, 0 if the entry is empty
+		Kind kind = Kind::invalid;
+		uint8_t length = 0; // in instructions
+
+		// the first instruction, for running it alone
+		Chip8::opfn_t op = nullptr;
+		uint16_t n = 0;
+		uint8_t x = 0;
+		uint8_t y = 0;
+
+		// operands of the rest of the sequence
+		uint16_t n2 = 0;
+		uint8_t x2 = 0;
+		uint8_t y2 = 0;
+		uint16_t target = 0;
+	};
+
+	std::vector<Entry> cache;
+	uint64_t dispatches = 0;
+
+	void decode(Entry&, uint64_t);
+public:
+	FusedEngine();
+
+	const char* name() const override;
+	Chip8::Fault run(Chip8&, uint64_t steps, uint64_t* executed = nullptr) override;
+	void invalidate() override;
+
+	// how many times an instruction or superinstruction was dispatched
+	uint64_t get_dispatches() const;
+};
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "fuzzer.hpp"
+
+/* Coverage guided fuzzer. Mutates either the key input fed to a ROM or the
+ * ROM itself, keeps mutations that reach new (PC, opcode) pairs, and saves
+ * inputs that crash the interpreter.
+ */
+
+typedef std::vector<uint8_t> input_t;
+
+static void mutate(input_t& input, const std::vector<input_t>& corpus, size_t max_size, std::mt19937& random)
+{
+	unsigned int mutations = 1 + random() % 4;
+	for (unsigned int i = 0; i < mutations; ++i)
+	{
+		switch (random() % 6)
+		{
+			case 0: // flip a bit
+				if (!input.empty()) input[random() % input.size()] ^= 1 << (random() % 8);
+				break;
+			case 1: // random byte
+				if (!input.empty()) input[random() % input.size()] = random();
+				break;
+			case 2: // insert a byte
+				if (input.size() < max_size) input.insert(input.begin() + random() % (input.size() + 1), random());
+				break;
+			case 3: // delete a byte
+				if (!input.empty()) input.erase(input.begin() + random() % input.size());
+				break;
+			case 4: // copy a block within the input
+				if (input.size() >= 2)
+				{
+					size_t length = 1 + random() % (input.size() / 2);
+					size_t from = random() % (input.size() - length + 1);
+					size_t to = random() % (input.size() - length + 1);
+					std::copy_n(input.begin() + from, length, input.begin() + to);
+				}
+				break;
+			case 5: // splice with another corpus entry
+			{
+				const input_t& other = corpus[random() % corpus.size()];
+				if (other.empty()) break;
+				size_t cut = random() % (std::min(input.size(), other.size()) + 1);
+				input.resize(cut);
+				input.insert(input.end(), other.begin() + std::min(cut, other.size()), other.end());
+				break;
+			}
+		}
+	}
+	if (input.size() > max_size) input.resize(max_size);
+}
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-p] [-n STEPS] [-i RUNS] [-o DIR] [-s SEED] ROM\n"
+		<< "  -p        mutate the program instead of the key input\n"
+		<< "  -n STEPS  steps per run (default 20000)\n"
+		<< "  -i RUNS   number of runs (default 1000000)\n"
+		<< "  -o DIR    where to save crashing inputs (default .)\n"
+		<< "  -s SEED   seed for mutations and the ROM's RNG (default 1)\n";
+}
+
+int main(int argc, char** argv)
+{
+	bool mutate_program = false;
+	uint64_t steps = 20000;
+	uint64_t runs = 1000000;
+	std::string output = ".";
+	unsigned int seed = 1;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "pn:i:o:s:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'p': mutate_program = true; break;
+			case 'n': steps = std::strtoull(optarg, nullptr, 10); break;
+			case 'i': runs = std::strtoull(optarg, nullptr, 10); break;
+			case 'o': output = optarg; break;
+			case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Chip8 golden(seed);
+	golden.load_rom(argv[optind]);
+	Fuzzer fuzzer(golden, steps);
+
+	// start from the ROM itself, or from no input at all
+	std::vector<input_t> corpus;
+	size_t max_size = 0x100;
+	if (mutate_program)
+	{
+		std::ifstream romfile(argv[optind], std::ios::binary);
+		corpus.emplace_back(std::istreambuf_iterator<char>(romfile), std::istreambuf_iterator<char>());
+		max_size = Chip8::memory_size - Chip8::program_mem_start;
+	}
+	else
+	{
+		corpus.emplace_back();
+	}
+
+	std::mt19937 random(seed);
+	std::set<std::pair<Crash, uint16_t>> crashes; // only save the first of each kind at each address
+
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t run = 0; run < runs; ++run)
+	{
+		input_t input = corpus[random() % corpus.size()];
+		if (run > 0) mutate(input, corpus, max_size, random);
+
+		FuzzResult result = mutate_program ? fuzzer.run_program(input) : fuzzer.run_input(input);
+
+		if (result.crash != Crash::none && crashes.emplace(result.crash, result.program_counter).second)
+		{
+			char name[64];
+			std::snprintf(name, sizeof(name), "/crash-%s-%03x.bin", crash_name(result.crash), result.program_counter);
+			std::ofstream file(output + name, std::ios::binary);
+			file.write(reinterpret_cast<const char*>(input.data()), input.size());
+
+			std::cout << crash_name(result.crash) << " at " << std::hex << result.program_counter << ": "
+				<< Chip8::disassemble(result.opcode) << std::dec << " after " << result.steps << " steps, saved to "
+				<< output << name << std::endl;
+		}
+		else if (result.new_coverage > 0)
+		{
+			corpus.push_back(std::move(input));
+		}
+
+		if ((run + 1) % 100000 == 0)
+		{
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::cout << run + 1 << " runs, " << (run + 1) / elapsed.count() << " runs/s, corpus "
+				<< corpus.size() << ", coverage " << fuzzer.coverage() << std::endl;
+		}
+	}
+
+	return crashes.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
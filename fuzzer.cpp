@@ -0,0 +1,103 @@
+#include "fuzzer.hpp"
+#include "hash.hpp"
+
+const char* crash_name(Crash crash)
+{
+	switch (crash)
+	{
+		case Crash::none: return "none";
+		case Crash::invalid_opcode: return "invalid-opcode";
+		case Crash::stack_underflow: return "stack-underflow";
+		case Crash::stack_overflow: return "stack-overflow";
+		case Crash::address_out_of_range: return "address-out-of-range";
+	}
+	return "unknown";
+}
+
+// AFL style buckets, so loops only count as new coverage when their trip count changes a lot
+static uint8_t bucket(uint8_t hits)
+{
+	if (hits >= 128) return 0x80;
+	if (hits >= 32) return 0x40;
+	if (hits >= 16) return 0x20;
+	if (hits >= 8) return 0x10;
+	if (hits >= 4) return 0x08;
+	return hits; // 1, 2 or 3
+}
+
+Fuzzer::Fuzzer(const Chip8& _golden, uint64_t _steps_per_run)
+	: golden(_golden), machine(_golden), steps_per_run(_steps_per_run), hits(coverage_size), seen(coverage_size)
+{
+	touched.reserve(coverage_size);
+}
+
+FuzzResult Fuzzer::execute(const std::vector<uint8_t>& input)
+{
+	FuzzResult result;
+	size_t next_input = 0;
+	uint64_t next_event = input.empty() ? 0 : (input[0] >> 5) * 16;
+
+	for (; result.steps < steps_per_run; ++result.steps)
+	{
+		while (next_input < input.size() && result.steps >= next_event)
+		{
+			uint8_t event = input[next_input++];
+			if (event & 0x10) machine.press(event & 0xf);
+			else machine.release(event & 0xf);
+
+			if (next_input < input.size()) next_event = result.steps + (input[next_input] >> 5) * 16;
+		}
+
+		result.program_counter = machine.get_program_counter();
+		// a PC past memory faults in step(), don't read there
+		result.opcode = machine.get_memory(result.program_counter % Chip8::memory_size) << 8
+			| machine.get_memory((result.program_counter + 1) % Chip8::memory_size);
+
+		uint16_t entry = hash_mix(static_cast<uint64_t>(result.program_counter) << 16 | result.opcode) % coverage_size;
+		if (hits[entry] == 0) touched.push_back(entry);
+		if (hits[entry] < 0xff) ++hits[entry];
+
+		machine.step();
+		if (machine.get_fault() != Chip8::Fault::none)
+		{
+			result.crash = machine.get_fault();
+			break;
+		}
+	}
+
+	for (uint16_t entry : touched)
+	{
+		uint8_t bits = bucket(hits[entry]);
+		if (bits & ~seen[entry])
+		{
+			seen[entry] |= bits;
+			++result.new_coverage;
+		}
+		hits[entry] = 0;
+	}
+	touched.clear();
+
+	machine.restore(golden);
+	return result;
+}
+
+FuzzResult Fuzzer::run_input(const std::vector<uint8_t>& input)
+{
+	return execute(input);
+}
+
+FuzzResult Fuzzer::run_program(const std::vector<uint8_t>& program)
+{
+	for (size_t i = 0; i < program.size() && Chip8::program_mem_start + i < Chip8::memory_size; ++i)
+	{
+		machine.set_memory(Chip8::program_mem_start + i, program[i]);
+	}
+	return execute({});
+}
+
+size_t Fuzzer::coverage() const
+{
+	size_t count = 0;
+	for (uint8_t bits : seen) count += bits != 0;
+	return count;
+}
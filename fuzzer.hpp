@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+
+// ways a ROM can crash the interpreter
+typedef Chip8::Fault Crash;
+
+const char* crash_name(Crash);
+
+struct FuzzResult
+{
+	Crash crash = Crash::none;
+	uint16_t program_counter = 0; // of the crashing instruction
+	uint16_t opcode = 0;
+	uint64_t steps = 0;
+	unsigned int new_coverage = 0; // coverage map entries that reached a new hit count bucket
+};
+
+/* Runs many short executions from one golden machine state, e.g. right
+ * after loading a ROM. Between runs the machine is restored by copying back
+ * only the memory pages it wrote to. Each run records which (PC, opcode)
+ * pairs executed, so a mutator can keep inputs that reach new code.
+ */
+class Fuzzer
+{
+public:
+	constexpr static size_t coverage_size = 0x10000;
+
+private:
+	Chip8 golden;
+	Chip8 machine;
+	uint64_t steps_per_run;
+
+	std::vector<uint8_t> hits; // hit counts for the current run
+	std::vector<uint16_t> touched; // entries of hits to clear after the run
+	std::vector<uint8_t> seen; // hit count buckets seen over all runs
+
+	FuzzResult execute(const std::vector<uint8_t>&);
+public:
+	Fuzzer(const Chip8&, uint64_t steps_per_run);
+
+	/* run from the golden state, feeding the input as key events. each byte
+	 * waits (byte >> 5) * 16 steps, then presses (bit 4 set) or releases
+	 * the key in its low nibble
+	 */
+	FuzzResult run_input(const std::vector<uint8_t>&);
+	// run from the golden state with the program replaced by these bytes
+	FuzzResult run_program(const std::vector<uint8_t>&);
+
+	// coverage map entries hit in any run
+	size_t coverage() const;
+};
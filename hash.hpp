@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 64 bit non-cryptographic hash, fast enough to run over the whole machine state often
+constexpr uint64_t hash_mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+inline uint64_t hash_bytes(const void* data, size_t size, uint64_t seed = 0)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ull);
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + i, 8);
+		h = (h ^ hash_mix(word)) * 0x9e3779b97f4a7c15ull;
+	}
+
+	uint64_t tail = 0;
+	std::memcpy(&tail, bytes + i, size - i);
+	return hash_mix(h ^ tail ^ (size - i));
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "engine.hpp"
+
+/* Measures what state hashing costs: each ROM is run without hashing, with
+ * hash() computed from scratch after every frame, with hash tracking on, and
+ * with hash tracking on and hash() after every frame.
+ */
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-e ENGINE] [-f FRAMES] [-i STEPS] ROM...\n"
+		<< "  -e ENGINE   engine to run with (default reference)\n"
+		<< "  -f FRAMES   frames to run each ROM for (default 100000)\n"
+		<< "  -i STEPS    steps per frame (default 16)\n"
+		<< "engines:";
+	for (const std::string& engine : engine_names()) std::cerr << ' ' << engine;
+	std::cerr << '\n';
+}
+
+enum Mode
+{
+	no_hash,
+	full_hash,
+	tracking, // tracking on, but hash() isn't called
+	tracked_hash,
+	modes
+};
+
+static const char* mode_names[modes] = {"no hashing", "full hash", "tracking only", "tracked hash"};
+
+// million steps per second, the hashes folded into result so they aren't optimized away
+static double run(Engine& engine, const Chip8& start, Mode mode, uint64_t frames, uint64_t steps_per_frame, uint64_t& result)
+{
+	Chip8 chip8 = start;
+	chip8.set_hash_tracking(mode == tracking || mode == tracked_hash);
+	engine.invalidate();
+
+	auto begin = std::chrono::steady_clock::now();
+	for (uint64_t frame = 0; frame < frames; ++frame)
+	{
+		engine.run(chip8, steps_per_frame);
+		if (mode == full_hash || mode == tracked_hash) result ^= chip8.hash();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	return frames * steps_per_frame / elapsed.count() / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+	std::string engine_name = "reference";
+	uint64_t frames = 100000;
+	uint64_t steps_per_frame = 16;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "e:f:i:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'e': engine_name = optarg; break;
+			case 'f': frames = std::strtoull(optarg, nullptr, 10); break;
+			case 'i': steps_per_frame = std::strtoull(optarg, nullptr, 10); break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	std::unique_ptr<Engine> engine = make_engine(engine_name);
+	if (!engine || optind >= argc)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	uint64_t result = 0;
+	for (int arg = optind; arg < argc; ++arg)
+	{
+		Chip8 start(1);
+		try
+		{
+			start.load_rom(argv[arg]);
+			std::cout << argv[arg] << ':';
+			double base = 0;
+			for (int mode = 0; mode < modes; ++mode)
+			{
+				double speed = run(*engine, start, static_cast<Mode>(mode), frames, steps_per_frame, result);
+				if (mode == no_hash) base = speed;
+				std::cout << ' ' << mode_names[mode] << ' ' << std::fixed << std::setprecision(1) << speed << " M steps/s";
+				if (mode != no_hash) std::cout << " (" << std::setprecision(0) << 100 * (base / speed - 1) << "% slower)";
+				if (mode + 1 < modes) std::cout << ',';
+			}
+			std::cout << std::endl;
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << argv[arg] << ": " << e.what() << std::endl;
+			status = EXIT_FAILURE;
+		}
+	}
+
+	// only so result is used
+	if (result == 1) std::cout << std::endl;
+	return status;
+}
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include "input.hpp"
+
+Keymap::Keymap()
+{
+	for (std::array<int8_t, codes>& map : maps) map.fill(-1);
+}
+
+void Keymap::bind(Device device, unsigned int code, uint8_t key)
+{
+	if (code >= codes || key >= Chip8::registers_size) return;
+	std::replace(maps[device].begin(), maps[device].end(), static_cast<int8_t>(key), static_cast<int8_t>(-1));
+	maps[device][code] = key;
+}
+
+void Keymap::unbind(Device device, unsigned int code)
+{
+	if (code < codes) maps[device][code] = -1;
+}
+
+void InputQueue::push(const InputEvent& event)
+{
+	// keyboard and gamepad events can arrive slightly out of order
+	auto later = std::upper_bound(events.begin(), events.end(), event,
+		[](const InputEvent& a, const InputEvent& b) { return a.time < b.time; });
+	events.insert(later, event);
+}
+
+void InputQueue::start_frame(uint64_t begin, uint64_t end, unsigned int steps)
+{
+	frame_begin = begin;
+	frame_end = std::max(begin + 1, end);
+	frame_steps = steps;
+}
+
+unsigned int InputQueue::step_of(uint64_t time) const
+{
+	if (time <= frame_begin) return 0;
+	if (time >= frame_end) return frame_steps;
+	return (time - frame_begin) * frame_steps / (frame_end - frame_begin);
+}
+
+unsigned int InputQueue::apply(Chip8& chip8, unsigned int step)
+{
+	uint16_t changed = 0; // keys already applied before this instruction
+	while (!events.empty())
+	{
+		const InputEvent& event = events.front();
+		unsigned int due = step_of(event.time);
+		if (due > step || event.time >= frame_end) return std::min(due, frame_steps);
+		if (changed & (1 << event.key)) return step + 1; // give the ROM a chance to see it
+
+		changed |= 1 << event.key;
+		if (event.pressed) chip8.press(event.key);
+		else chip8.release(event.key);
+		events.pop_front();
+	}
+	return frame_steps;
+}
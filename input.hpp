@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include "chip8.hpp"
+
+/* Host input for the frontend, kept apart from SDL so it can be tested.
+ * Times are nanoseconds on the Metrics::now() clock.
+ */
+
+/* Host keys and gamepad buttons to Chip8 keys, as flat arrays indexed by
+ * the host's code (SDL scancodes and controller buttons). -1 is unbound.
+ */
+class Keymap
+{
+public:
+	enum Device
+	{
+		keyboard,
+		gamepad,
+		devices
+	};
+	constexpr static size_t codes = 512; // SDL_NUM_SCANCODES, plenty for buttons too
+
+private:
+	std::array<std::array<int8_t, codes>, devices> maps;
+
+public:
+	Keymap();
+
+	// the Chip8 key for a host code, -1 if there is none
+	int lookup(Device device, unsigned int code) const
+	{
+		return code < codes ? maps[device][code] : -1;
+	}
+	/* from now on code presses key. whatever else on the same device pressed
+	 * key is unbound, so rebinding moves a key rather than adding to it
+	 */
+	void bind(Device, unsigned int code, uint8_t key);
+	void unbind(Device, unsigned int code);
+};
+
+struct InputEvent
+{
+	uint64_t time;
+	uint8_t key;
+	bool pressed;
+};
+
+/* Key events waiting to reach the machine. A frame's instructions stand for
+ * the host time between two polls, and each event is applied just before
+ * the instruction its timestamp falls on instead of all at once at the
+ * start of the frame. A press and release of the same key are never applied
+ * before the same instruction, so short taps are seen by the ROM.
+ */
+class InputQueue
+{
+	std::deque<InputEvent> events; // in time order
+	uint64_t frame_begin = 0;
+	uint64_t frame_end = 0;
+	unsigned int frame_steps = 0;
+
+public:
+	void push(const InputEvent&);
+	size_t size() const { return events.size(); }
+
+	// the next steps instructions cover host time [begin, end)
+	void start_frame(uint64_t begin, uint64_t end, unsigned int steps);
+	// the instruction of the current frame an event at time is due before
+	unsigned int step_of(uint64_t time) const;
+
+	/* apply the events due before instruction step of the frame and return
+	 * the instruction the next one is due before, at most the frame's length.
+	 * events after the frame wait for the next one
+	 */
+	unsigned int apply(Chip8&, unsigned int step);
+};
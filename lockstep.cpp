@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <random>
+#include "lockstep.hpp"
+
+Lockstep::Lockstep(Engine& _a, Engine& _b, uint64_t _interval) : a(_a), b(_b), interval(std::max<uint64_t>(_interval, 1))
+{
+}
+
+bool Lockstep::same(const Chip8& chip8_a, const Chip8& chip8_b)
+{
+	return chip8_a.get_fault() == chip8_b.get_fault() && chip8_a.hash() == chip8_b.hash();
+}
+
+LockstepResult Lockstep::run(const Chip8& start, uint64_t steps, unsigned int input_seed)
+{
+	LockstepResult result;
+
+	// states are hashed every interval, keep that cheap
+	Chip8 chip8_a = start;
+	chip8_a.set_hash_tracking(true);
+	Chip8 chip8_b = chip8_a;
+	Chip8 checkpoint = chip8_a;
+	a.invalidate();
+	b.invalidate();
+
+	std::minstd_rand input(input_seed);
+	std::uniform_int_distribution<uint8_t> key(0, Chip8::registers_size - 1);
+
+	while (result.steps < steps)
+	{
+		if (input_seed)
+		{
+			uint8_t k = key(input);
+			if (input() & 1)
+			{
+				chip8_a.press(k);
+				chip8_b.press(k);
+			}
+			else
+			{
+				chip8_a.release(k);
+				chip8_b.release(k);
+			}
+		}
+
+		checkpoint = chip8_a;
+		uint64_t chunk = std::min(interval, steps - result.steps);
+
+		a.run(chip8_a, chunk);
+		b.run(chip8_b, chunk);
+
+		if (same(chip8_a, chip8_b))
+		{
+			if (chip8_a.get_fault() != Chip8::Fault::none)
+			{
+				result.faulted = true;
+				return result;
+			}
+			result.steps += chunk;
+			continue;
+		}
+
+		// they agree after `low` steps from the checkpoint but not after `high`
+		uint64_t low = 0;
+		uint64_t high = chunk;
+		while (high - low > 1)
+		{
+			uint64_t middle = low + (high - low) / 2;
+
+			chip8_a = chip8_b = checkpoint;
+			a.invalidate();
+			b.invalidate();
+			a.run(chip8_a, middle);
+			b.run(chip8_b, middle);
+
+			if (same(chip8_a, chip8_b)) low = middle;
+			else high = middle;
+		}
+
+		// find the instruction both engines were about to execute
+		chip8_a = checkpoint;
+		a.invalidate();
+		a.run(chip8_a, low);
+
+		result.steps += low;
+		result.diverged = true;
+		result.program_counter = chip8_a.get_program_counter();
+		result.opcode = chip8_a.get_memory(result.program_counter) << 8 | chip8_a.get_memory((result.program_counter + 1) % Chip8::memory_size);
+		return result;
+	}
+
+	return result;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include "chip8.hpp"
+#include "engine.hpp"
+
+struct LockstepResult
+{
+	uint64_t steps = 0; // steps both engines agreed on
+	bool diverged = false;
+	bool faulted = false; // both engines faulted at the same point, which ends the run
+
+	// the first instruction executed differently, if diverged
+	uint16_t program_counter = 0;
+	uint16_t opcode = 0;
+};
+
+/* Runs two engines side by side from the same machine state and compares
+ * their state hashes every interval steps. When they disagree, both are
+ * rewound to the last matching checkpoint and the difference is bisected
+ * down to the first instruction they executed differently.
+ */
+class Lockstep
+{
+	Engine& a;
+	Engine& b;
+	uint64_t interval;
+
+	static bool same(const Chip8&, const Chip8&);
+public:
+	Lockstep(Engine&, Engine&, uint64_t interval = 0x1000);
+
+	/* steps is the total to run. with a nonzero input_seed a random key is
+	 * pressed or released on both machines before each interval
+	 */
+	LockstepResult run(const Chip8&, uint64_t steps, unsigned int input_seed = 0);
+};
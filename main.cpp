@@ -1,32 +1,450 @@
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
-#include <unordered_map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
 #include <SDL2/SDL.h>
 #include "chip8.hpp"
+#include "debugger.hpp"
+#include "debugserver.hpp"
+#include "engine.hpp"
+#include "input.hpp"
+#include "metrics.hpp"
+#include "pack.hpp"
+#include "phosphor.hpp"
+#include "rewind.hpp"
+#include "speaker.hpp"
+#include "trace.hpp"
+#include "wall.hpp"
 
-void stream_audio(void*, uint8_t* stream, int length)
+// one buffer of audio, matches the spec opened in main. about 11 ms, so sound changes are heard within a frame
+constexpr int audio_frequency = 48000;
+constexpr int audio_samples = 512;
+
+// what the audio callback works with
+struct Audio
+{
+	Metrics& metrics;
+	Speaker speaker;
+};
+
+void stream_audio(void* userdata, uint8_t* stream, int length)
+{
+	Audio* audio = static_cast<Audio*>(userdata);
+	audio->metrics.audio_callback(Metrics::now(), audio_samples * 1000000000ull / audio_frequency);
+	audio->speaker.render(reinterpret_cast<int16_t*>(stream), length / sizeof(int16_t));
+}
+
+// the device keeps running and plays silence in between, so sounds fade rather than being cut off
+void play(SDL_AudioDeviceID audio_device, Audio& audio, const Chip8& chip8, bool playing)
+{
+	if (!audio_device) return;
+	SDL_LockAudioDevice(audio_device);
+	audio.speaker.update(chip8, playing);
+	SDL_UnlockAudioDevice(audio_device);
+}
+
+void draw(SDL_Renderer* renderer, const Chip8& chip8, unsigned int scale)
+{
+	// clear black
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	SDL_RenderClear(renderer);
+
+	// prepare pixels for drawing
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+	SDL_Rect pixel;
+	pixel.w = scale;
+	pixel.h = scale;
+
+	// draw each pixel
+	for (uint8_t x = 0; x < Chip8::screen_width; ++x)
+	{
+		for (uint8_t y = 0; y < Chip8::screen_height; ++y)
+		{
+			if (chip8.get_pixel(x, y))
+			{
+				pixel.x = x * scale;
+				pixel.y = y * scale;
+				SDL_RenderFillRect(renderer, &pixel);
+			}
+		}
+	}
+}
+
+// through the phosphor filter: a frame passes, then the faded image goes up as one texture
+void draw(SDL_Renderer* renderer, SDL_Texture* texture, Phosphor& phosphor, const Chip8& chip8, unsigned int scale)
+{
+	phosphor.update(chip8);
+	SDL_UpdateTexture(texture, nullptr, phosphor.get_image(), phosphor.get_width() * sizeof(uint32_t));
+	SDL_Rect area = {0, 0, static_cast<int>(Chip8::screen_width * scale), static_cast<int>(Chip8::screen_height * scale)};
+	SDL_RenderCopy(renderer, texture, nullptr, &area);
+}
+
+/* 3x5 glyphs for the metrics overlay, rows from the top, 3 bits each with
+ * the leftmost pixel highest
+ */
+static const char overlay_chars[] = "0123456789ACDEFILMNPRSTU.";
+static const uint16_t overlay_glyphs[] = {
+	0b111101101101111, 0b010110010010111, 0b111001111100111, 0b111001111001111, 0b101101111001001, // 0-4
+	0b111100111001111, 0b111100111101111, 0b111001001001001, 0b111101111101111, 0b111101111001111, // 5-9
+	0b010101111101101, 0b111100100100111, 0b110101101101110, 0b111100111100111, 0b111100111100100, // ACDEF
+	0b111010010010111, 0b100100100100111, 0b101111111101101, 0b110101101101101, 0b111101111100100, // ILMNP
+	0b110101110101101, 0b111100111001111, 0b111010010010010, 0b101101101101111, 0b000000000000010, // RSTU.
+};
+
+void draw_overlay(SDL_Renderer* renderer, const Metrics::Report& report)
+{
+	constexpr int scale = 2;
+	constexpr int line_height = 7 * scale;
+	constexpr int char_width = 4 * scale;
+
+	char lines[8][32];
+	std::snprintf(lines[0], sizeof(lines[0]), "IPS %.0f", report.instructions_per_second);
+	std::snprintf(lines[1], sizeof(lines[1]), "FPS %.1f", report.frames_per_second);
+	std::snprintf(lines[2], sizeof(lines[2]), "EMU %.2f", report.phase_ms[Metrics::emulation]);
+	std::snprintf(lines[3], sizeof(lines[3]), "REN %.2f", report.phase_ms[Metrics::render]);
+	std::snprintf(lines[4], sizeof(lines[4]), "PRE %.2f", report.phase_ms[Metrics::present]);
+	std::snprintf(lines[5], sizeof(lines[5]), "UND %llu", static_cast<unsigned long long>(report.audio_underruns));
+	std::snprintf(lines[6], sizeof(lines[6]), "LAT %.1f", report.input_latency_ms);
+	std::snprintf(lines[7], sizeof(lines[7]), "CPU %.1f", report.cpu_percent);
+
+	// black box behind the text, so it stays readable and overwrites the last overlay
+	SDL_Rect box = {0, 0, 12 * char_width + scale, 8 * line_height + scale};
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+	SDL_RenderFillRect(renderer, &box);
+
+	SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+	SDL_Rect pixel = {0, 0, scale, scale};
+	for (int line = 0; line < 8; ++line)
+	{
+		for (int c = 0; lines[line][c] && c < 12; ++c)
+		{
+			const char* found = std::strchr(overlay_chars, lines[line][c]);
+			if (!found || !*found) continue; // spaces and anything unknown
+			uint16_t glyph = overlay_glyphs[found - overlay_chars];
+			for (int bit = 0; bit < 15; ++bit)
+			{
+				if (glyph & (0x4000 >> bit))
+				{
+					pixel.x = scale + c * char_width + (bit % 3) * scale;
+					pixel.y = scale + line * line_height + (bit / 3) * scale;
+					SDL_RenderFillRect(renderer, &pixel);
+				}
+			}
+		}
+	}
+}
+
+// replace the metrics file in one go, so readers never see half a report
+bool write_metrics(const std::string& filename, const Metrics::Report& report)
+{
+	std::string temporary = filename + ".tmp";
+	{
+		std::ofstream file(temporary);
+		if (!file) return false;
+		Metrics::write_json(file, report);
+		file << '\n';
+		if (!file) return false;
+	}
+	return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+// an SDL event timestamp (milliseconds) on the Metrics::now() clock
+uint64_t event_time(Uint32 timestamp, uint64_t now, Uint32 ticks)
+{
+	uint64_t age = ticks > timestamp ? (ticks - timestamp) * 1000000ull : 0;
+	return now > age ? now - age : now;
+}
+
+// pass on why the debugger stopped a run, if it did. false if the ROM faulted
+bool stopped(const DebugStop& stop, const Chip8& chip8, DebugServer* server)
+{
+	if (stop.reason != DebugStop::none && server) server->stopped(stop);
+	if (stop.reason == DebugStop::fault)
+	{
+		std::cerr << "fault at " << std::hex << stop.address << std::dec << ": " << Chip8::fault_name(chip8.get_fault()) << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// the video wall: many machines in one window, keys go to the one clicked last
+void run_wall(SDL_Window* window, SDL_Renderer* renderer, const std::vector<Chip8>& machines, uint64_t steps_per_frame,
+	const Keymap& keymap, SDL_AudioDeviceID audio_device, Audio& audio)
 {
-	constexpr int samples_per_period = 109; // 48000/440 is approx 109
+	Wall wall(machines, steps_per_frame);
+	const int width = wall.atlas_width();
+	const int height = wall.atlas_height();
+
+	// as large as fits at a whole scale. the renderer scales the atlas to any size the window gets
+	int scale = 1;
+	SDL_Rect bounds;
+	if (SDL_GetDisplayUsableBounds(SDL_GetWindowDisplayIndex(window), &bounds) == 0)
+	{
+		scale = std::clamp(std::min(bounds.w / width, bounds.h / height), 1, 10);
+	}
+	SDL_SetWindowSize(window, width * scale, height * scale);
+	SDL_SetWindowResizable(window, SDL_TRUE);
+	// mouse positions arrive in atlas pixels too
+	SDL_RenderSetLogicalSize(renderer, width, height);
+
+	// one upload per frame for every machine
+	SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+	if (!texture)
+	{
+		std::cerr << "SDL_CreateTexture: " << SDL_GetError() << std::endl;
+		return;
+	}
 
-	for (int i = 0; i < length; ++i)
+	size_t focus = 0;
+	uint64_t run_time = 0;
+	unsigned int frames = 0;
+	Uint32 next_title = SDL_GetTicks();
+	double next_frame = SDL_GetTicks();
+	for (bool running = true; running;)
 	{
-		stream[i] = (std::sin(((i % samples_per_period) * 2 * M_PI) / samples_per_period) + 1) * 128;
+		SDL_Event event;
+		while (SDL_PollEvent(&event))
+		{
+			switch (event.type)
+			{
+				case SDL_WINDOWEVENT:
+					if (event.window.event == SDL_WINDOWEVENT_CLOSE) running = false;
+					break;
+				case SDL_MOUSEBUTTONDOWN:
+				{
+					int tile = wall.tile_at(event.button.x, event.button.y);
+					if (tile < 0) break;
+					// keys held for the last machine would stay down forever
+					for (uint8_t key = 0; key < Chip8::registers_size; ++key) wall.get(focus).release(key);
+					focus = tile;
+					break;
+				}
+				case SDL_KEYDOWN:
+				case SDL_KEYUP:
+				{
+					if (event.key.keysym.scancode == SDL_SCANCODE_ESCAPE)
+					{
+						running = false;
+						break;
+					}
+					int key = keymap.lookup(Keymap::keyboard, event.key.keysym.scancode);
+					if (key < 0 || event.key.repeat) break;
+					if (event.type == SDL_KEYDOWN) wall.get(focus).press(key);
+					else wall.get(focus).release(key);
+					break;
+				}
+			}
+		}
+
+		uint64_t start = Metrics::now();
+		wall.run_frame();
+		run_time += Metrics::now() - start;
+		++frames;
+
+		SDL_UpdateTexture(texture, nullptr, wall.get_atlas(), width * sizeof(uint32_t));
+		SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+		SDL_RenderClear(renderer);
+		SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+
+		// outline the machine that gets the keys, over the borders around it
+		int column = focus % wall.get_columns();
+		int row = focus / wall.get_columns();
+		SDL_Rect outline = {column * static_cast<int>(Wall::tile_width) - 1, row * static_cast<int>(Wall::tile_height) - 1,
+			Wall::tile_width + 1, Wall::tile_height + 1};
+		SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+		SDL_RenderDrawRect(renderer, &outline);
+		SDL_RenderPresent(renderer);
+
+		// only the focused machine is heard
+		play(audio_device, audio, wall.get(focus), wall.get(focus).beep());
+
+		if (SDL_GetTicks() >= next_title)
+		{
+			char title[128];
+			std::snprintf(title, sizeof(title), "CHIP8 - %zu machines, %zu faulted, %.2f ms per frame, keys to %zu",
+				wall.size(), wall.faults(), run_time / 1e6 / frames, focus);
+			SDL_SetWindowTitle(window, title);
+			run_time = 0;
+			frames = 0;
+			next_title += 1000;
+		}
+
+		// wait for the next frame, or give up on catching up if we fell behind
+		next_frame += 1000.0 / 60;
+		double now = SDL_GetTicks();
+		if (next_frame > now) SDL_Delay(next_frame - now);
+		else next_frame = now;
 	}
+
+	SDL_DestroyTexture(texture);
+}
+
+void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-a FRAMES] [-t FILE] [-m FILE] [-o] [-g SOCKET] [-V] [-P PACK] [-w COPIES] [-p] ROM...\n"
+		<< "  -a FRAMES  run ahead this many frames to hide input latency\n"
+		<< "  -t FILE    trace recent instructions, written to FILE on exit\n"
+		<< "  -m FILE    write performance metrics to FILE as JSON every second\n"
+		<< "  -o         show the metrics overlay from the start, F1 toggles it\n"
+		<< "  -g SOCKET  accept debugger connections on this Unix socket\n"
+		<< "  -V         COSMAC VIP timing: run each frame for its machine cycles, not 16 instructions\n"
+		<< "  -P PACK    take ROM from this pack, by name or hash, with its settings\n"
+		<< "  -w COPIES  video wall: run COPIES of each ROM side by side, click one to give it the keys\n"
+		<< "  -p         phosphor filter: let pixels fade instead of going dark at once, F3 toggles it\n"
+		<< "F1 toggles the overlay, F2 rebinds the 16 keys in order to the next keys or buttons pressed\n";
 }
 
 int main(int argc, char** argv)
 {
-	if (argc <= 1)
+	// frames to emulate ahead of the real state before presenting
+	unsigned int runahead_frames = 0;
+	// where to write the instruction trace, if tracing
+	std::string trace_file;
+	// where to write metrics, if anywhere
+	std::string metrics_file;
+	bool overlay = false;
+	// where to listen for a debugger, if anywhere
+	std::string debug_socket;
+	bool vip_timing = false;
+	// where ROMs come from, if not from files
+	std::string pack_file;
+	// copies of each ROM on the video wall, 0 for a single machine
+	unsigned int wall_copies = 0;
+	bool phosphor_on = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "a:t:m:og:VP:w:p")) != -1)
+	{
+		switch (opt)
+		{
+			case 'a':
+				runahead_frames = std::strtoul(optarg, nullptr, 10);
+				break;
+			case 't':
+				trace_file = optarg;
+				break;
+			case 'm':
+				metrics_file = optarg;
+				break;
+			case 'o':
+				overlay = true;
+				break;
+			case 'g':
+				debug_socket = optarg;
+				break;
+			case 'V':
+				vip_timing = true;
+				break;
+			case 'P':
+				pack_file = optarg;
+				break;
+			case 'w':
+				wall_copies = std::strtoul(optarg, nullptr, 10);
+				break;
+			case 'p':
+				phosphor_on = true;
+				break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	// only the wall takes more than one ROM
+	if (optind >= argc || (optind + 1 < argc && !wall_copies))
 	{
-		std::cerr << "usage: " << argv[0] << " ROM\n";
+		usage(argv[0]);
 		return EXIT_FAILURE;
 	}
 
 	Chip8 chip8;
-	chip8.load_rom(argv[1]);
+	PackSettings settings;
+	try
+	{
+		if (pack_file.empty())
+		{
+			chip8.load_rom(argv[optind]);
+		}
+		else
+		{
+			Pack pack;
+			if (!pack.open(pack_file))
+			{
+				std::cerr << pack_file << ": not a ROM pack" << std::endl;
+				return EXIT_FAILURE;
+			}
+			const PackEntry* entry = pack.find(argv[optind]);
+			if (!entry)
+			{
+				std::cerr << argv[optind] << ": not in " << pack_file << std::endl;
+				return EXIT_FAILURE;
+			}
+			pack.load(*entry, chip8);
+			settings = pack.settings(*entry);
+		}
+	}
+	catch (const std::runtime_error& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (settings.profile == profile_vip) vip_timing = true;
+	if (vip_timing) chip8.set_timing(Chip8::Timing::vip);
+
+	// each copy with its own random numbers, so they don't all play the same game
+	std::vector<Chip8> wall_machines;
+	for (int arg = optind; wall_copies && arg < argc; ++arg)
+	{
+		Chip8 machine = chip8;
+		if (arg > optind)
+		{
+			try
+			{
+				machine.load_rom(argv[arg]);
+			}
+			catch (const std::runtime_error& e)
+			{
+				std::cerr << e.what() << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		for (unsigned int copy = 0; copy < wall_copies; ++copy)
+		{
+			machine.seed(wall_machines.size());
+			wall_machines.push_back(machine);
+		}
+	}
+
+	std::unique_ptr<Trace> trace;
+	if (!trace_file.empty())
+	{
+		trace = std::make_unique<Trace>();
+		chip8.set_trace(trace.get());
+	}
+	bool faulted = false;
 
-	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0)
+	ReferenceEngine engine;
+	Debugger debugger;
+	std::unique_ptr<DebugServer> server;
+	if (!debug_socket.empty())
+	{
+		server = std::make_unique<DebugServer>(debug_socket);
+		if (!server->is_listening())
+		{
+			std::cerr << debug_socket << ": could not listen" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) < 0)
 	{
 		std::cerr << "SDL_Init: " << SDL_GetError() << std::endl;
 		return EXIT_FAILURE;
@@ -52,38 +470,123 @@ int main(int argc, char** argv)
 
 	bool running = true;
 
-	std::unordered_map<SDL_Scancode, uint8_t> keymap = {
-		{SDL_SCANCODE_1, 0x1}, {SDL_SCANCODE_2, 0x2}, {SDL_SCANCODE_3, 0x3}, {SDL_SCANCODE_4, 0xc},
-		{SDL_SCANCODE_Q, 0x4}, {SDL_SCANCODE_W, 0x5}, {SDL_SCANCODE_E, 0x6}, {SDL_SCANCODE_R, 0xd},
-		{SDL_SCANCODE_A, 0x7}, {SDL_SCANCODE_S, 0x8}, {SDL_SCANCODE_D, 0x9}, {SDL_SCANCODE_F, 0xe},
-		{SDL_SCANCODE_Z, 0xa}, {SDL_SCANCODE_X, 0x0}, {SDL_SCANCODE_C, 0xb}, {SDL_SCANCODE_V, 0xf},
+	Metrics metrics;
+	Metrics::Report report;
+
+	static_assert(SDL_NUM_SCANCODES <= Keymap::codes && SDL_CONTROLLER_BUTTON_MAX <= Keymap::codes, "keymap too small");
+	Keymap keymap;
+	const SDL_Scancode keys[Chip8::registers_size] = {
+		SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3, SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+		SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C, SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V,
+	};
+	for (uint8_t key = 0; key < Chip8::registers_size; ++key) keymap.bind(Keymap::keyboard, keys[key], key);
+	// then the ROM's own layout from the pack, where it has one
+	for (uint8_t key = 0; key < Chip8::registers_size; ++key)
+	{
+		if (settings.keys[key]) keymap.bind(Keymap::keyboard, settings.keys[key], key);
+	}
+	// the d-pad on the 2/4/6/8-style arrows most ROMs use (W/A/S/D), the face buttons next to them
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_DPAD_UP, 0x5);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_DPAD_LEFT, 0x7);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_DPAD_DOWN, 0x8);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_DPAD_RIGHT, 0x9);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_A, 0x6);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_B, 0x4);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_X, 0x0);
+	keymap.bind(Keymap::gamepad, SDL_CONTROLLER_BUTTON_Y, 0xc);
+	std::vector<SDL_GameController*> controllers;
+	// the key bound by the next press while rebinding with F2, -1 otherwise
+	int rebinding = -1;
+	int shown_rebinding = -1;
+
+	// key events wait here for the instruction they are due before
+	InputQueue input;
+	uint64_t last_poll = Metrics::now();
+	// to tell whether a present shows anything new, for key to photon latency
+	uint64_t drawn_hash = chip8.screen_hash();
+	uint64_t presented_hash = drawn_hash;
+
+	// with the phosphor filter on the screen is redrawn every frame, since pixels fade even when nothing is drawn
+	Phosphor phosphor;
+	SDL_Texture* screen_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+		Chip8::screen_width, Chip8::screen_height);
+	if (!screen_texture)
+	{
+		std::cerr << "SDL_CreateTexture: " << SDL_GetError() << std::endl;
+		phosphor_on = false;
+	}
+	auto show = [&]()
+	{
+		if (phosphor_on) draw(renderer, screen_texture, phosphor, chip8, scale);
+		else draw(renderer, chip8, scale);
 	};
 
 	SDL_AudioSpec spec = {};
 	SDL_AudioSpec got_spec = {};
-	spec.freq = 48000;
-	spec.format = AUDIO_S8;
+	spec.freq = audio_frequency;
+	spec.format = AUDIO_S16SYS;
 	spec.channels = 1;
-	spec.samples = 0x1000;
+	spec.samples = audio_samples;
 	spec.callback = stream_audio;
+	Audio audio {metrics, Speaker(audio_frequency)};
+	spec.userdata = &audio;
 
 	// minimum number of frames to play each beep
 	constexpr int audio_frames = 3;
 	// number of frames left in current beep
 	int remaining_audio_frames = 0;
 
+	// the interpreter runs in batches, one per displayed frame
+	constexpr unsigned int frames_per_second = 60;
+	// about one step per millisecond, unless the ROM wants otherwise
+	const unsigned int steps_per_frame = settings.steps_per_frame ? settings.steps_per_frame : 16;
+	// what a frame is measured in: instructions, or machine cycles with VIP timing
+	const unsigned int frame_length = vip_timing ? Chip8::vip_frame_cycles : steps_per_frame;
+
+	// history played back while backspace is held
+	constexpr unsigned int rewind_seconds = 60;
+	Rewind rewind(rewind_seconds * frames_per_second);
+	bool rewinding = false;
+
+	// the real state is set aside here while running ahead
+	Chip8::Snapshot runahead_snapshot;
+	// time spent emulating real frames and running ahead, to report the cost
+	Uint64 emulation_ticks = 0;
+	Uint64 runahead_ticks = 0;
+	Uint64 emulated_frames = 0;
+
 	// don't allow any changes, so spec == got_spec
 	SDL_AudioDeviceID audio_device = SDL_OpenAudioDevice(NULL, false, &spec, &got_spec, 0);
 	if (!audio_device)
 	{
 		std::cerr << "SDL_OpenAudioDevice: " << SDL_GetError() << std::endl;
 	}
+	else
+	{
+		SDL_PauseAudioDevice(audio_device, false);
+	}
 
+	if (!wall_machines.empty())
+	{
+		run_wall(window, renderer, wall_machines, steps_per_frame, keymap, audio_device, audio);
+		running = false;
+	}
+
+	double next_frame = SDL_GetTicks();
 	while (running)
 	{
+		uint64_t poll_time = Metrics::now();
+		Uint32 poll_ticks = SDL_GetTicks();
 		SDL_Event event;
 		while (SDL_PollEvent(&event))
 		{
+			// set for a key or button that may be meant for the machine
+			bool host_input = false;
+			Keymap::Device device = Keymap::keyboard;
+			unsigned int code = 0;
+			Uint32 timestamp = 0;
+			bool pressed = false;
+
 			switch (event.type)
 			{
 				case SDL_WINDOWEVENT:
@@ -92,80 +595,229 @@ int main(int argc, char** argv)
 				case SDL_KEYDOWN:
 				case SDL_KEYUP:
 				{
-					SDL_Scancode code = event.key.keysym.scancode;
+					code = event.key.keysym.scancode;
 					if (code == SDL_SCANCODE_ESCAPE)
 					{
 						running = false;
 						break;
 					}
-
-					if (keymap.count(code))
+					if (code == SDL_SCANCODE_BACKSPACE)
+					{
+						rewinding = event.type == SDL_KEYDOWN;
+						break;
+					}
+					if (code == SDL_SCANCODE_F1)
 					{
-						if (event.type == SDL_KEYDOWN)
-							chip8.press(keymap.at(code));
-						else
-							chip8.release(keymap.at(code));
+						if (event.type == SDL_KEYDOWN) overlay = !overlay;
+						break;
 					}
+					if (code == SDL_SCANCODE_F3)
+					{
+						if (event.type == SDL_KEYDOWN && screen_texture)
+						{
+							phosphor_on = !phosphor_on;
+							phosphor.clear();
+							show();
+						}
+						break;
+					}
+					if (code == SDL_SCANCODE_F2)
+					{
+						if (event.type == SDL_KEYDOWN) rebinding = rebinding < 0 ? 0 : -1;
+						break;
+					}
+					if (event.key.repeat) break;
+
+					device = Keymap::keyboard;
+					timestamp = event.key.timestamp;
+					pressed = event.type == SDL_KEYDOWN;
+					host_input = true;
 					break;
 				}
+				case SDL_CONTROLLERBUTTONDOWN:
+				case SDL_CONTROLLERBUTTONUP:
+					device = Keymap::gamepad;
+					code = event.cbutton.button;
+					timestamp = event.cbutton.timestamp;
+					pressed = event.type == SDL_CONTROLLERBUTTONDOWN;
+					host_input = true;
+					break;
+				case SDL_CONTROLLERDEVICEADDED:
+					if (SDL_GameController* controller = SDL_GameControllerOpen(event.cdevice.which)) controllers.push_back(controller);
+					break;
 			}
-		}
+			if (!host_input) continue;
 
-		chip8.step();
+			if (rebinding >= 0)
+			{
+				if (!pressed) continue;
+				keymap.bind(device, code, rebinding);
+				if (++rebinding == Chip8::registers_size) rebinding = -1;
+				continue;
+			}
+
+			int key = keymap.lookup(device, code);
+			if (key < 0) continue;
+			uint64_t time = event_time(timestamp, poll_time, poll_ticks);
+			input.push({time, static_cast<uint8_t>(key), pressed});
+			metrics.input(time);
+		}
 
-		if (chip8.should_draw())
+		// show which key F2 is waiting for
+		if (rebinding != shown_rebinding)
 		{
-			// clear black
-			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-			SDL_RenderClear(renderer);
+			std::string title = "CHIP8";
+			if (rebinding >= 0) title += " - press the key or button for " + std::string(1, "0123456789ABCDEF"[rebinding]);
+			SDL_SetWindowTitle(window, title.c_str());
+			shown_rebinding = rebinding;
+		}
+
+		// this frame's instructions stand for the time since the last poll
+		input.start_frame(last_poll, poll_time, frame_length);
+		last_poll = poll_time;
 
-			// prepare pixels for drawing
-			SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-			SDL_Rect pixel;
-			pixel.w = scale;
-			pixel.h = scale;
+		// one non-blocking look at the socket per frame
+		if (server) server->poll(chip8, debugger);
 
-			// draw each pixel
-			for (uint8_t x = 0; x < Chip8::screen_width; ++x)
+		uint64_t frame_start = Metrics::now();
+		uint64_t render_time = 0;
+		if (server && server->is_halted())
+		{
+			// the debugger has the machine, keep presenting what it last drew
+		}
+		else if (rewinding)
+		{
+			rewind.pop(chip8);
+			if (chip8.should_draw() || phosphor_on)
 			{
-				for (uint8_t y = 0; y < Chip8::screen_height; ++y)
-				{
-					if (chip8.get_pixel(x, y))
-					{
-						pixel.x = x * scale;
-						pixel.y = y * scale;
-						SDL_RenderFillRect(renderer, &pixel);
-					}
-				}
+				uint64_t start = Metrics::now();
+				show();
+				drawn_hash = chip8.screen_hash();
+				render_time += Metrics::now() - start;
 			}
 		}
-
-		if (audio_device)
+		else
 		{
-			if (chip8.beep())
+			Uint64 start = SDL_GetPerformanceCounter();
+			// run up to each key event in turn
+			uint64_t frame_cycles = chip8.next_frame_cycles() - Chip8::vip_frame_cycles;
+			uint64_t steps = 0;
+			for (unsigned int at = 0; at < frame_length && !faulted && !(server && server->is_halted());)
 			{
-				remaining_audio_frames = audio_frames;
+				unsigned int next = input.apply(chip8, at);
+				if (!vip_timing)
+				{
+					faulted = !stopped(debugger.run(chip8, engine, next - at), chip8, server.get());
+					steps += next - at;
+					at = next;
+					continue;
+				}
+				DebugStop stop = debugger.run_until(chip8, engine, frame_cycles + next);
+				faulted = !stopped(stop, chip8, server.get());
+				steps += stop.steps;
+				at = std::max<uint64_t>(next, chip8.get_cycles() - frame_cycles);
 			}
+			if (faulted) break;
+			rewind.push(chip8);
+			Uint64 end = SDL_GetPerformanceCounter();
+			emulation_ticks += end - start;
+			++emulated_frames;
+			metrics.add_steps(steps);
 
-			if (remaining_audio_frames > 0)
+			if (runahead_frames > 0)
 			{
-				SDL_PauseAudioDevice(audio_device, false);
-				--remaining_audio_frames;
+				/* show where the current input leads, then go back to the real state.
+				 * what happens ahead may never happen for real, so it is not traced
+				 * and faults there are ignored
+				 */
+				chip8.save_state(runahead_snapshot);
+				chip8.set_trace(nullptr);
+				for (unsigned int i = 0; i < runahead_frames; ++i) engine.run_frame(chip8, steps_per_frame);
+				chip8.set_trace(trace.get());
+				runahead_ticks += SDL_GetPerformanceCounter() - end;
+
+				uint64_t render_start = Metrics::now();
+				show();
+				drawn_hash = chip8.screen_hash();
+				render_time += Metrics::now() - render_start;
+
+				start = SDL_GetPerformanceCounter();
+				chip8.load_state(runahead_snapshot);
+				runahead_ticks += SDL_GetPerformanceCounter() - start;
 			}
-			else
+			else if (chip8.should_draw() || phosphor_on)
 			{
-				SDL_PauseAudioDevice(audio_device, true);
+				uint64_t render_start = Metrics::now();
+				show();
+				drawn_hash = chip8.screen_hash();
+				render_time += Metrics::now() - render_start;
 			}
 		}
+		metrics.add_time(Metrics::emulation, Metrics::now() - frame_start - render_time);
 
+		if (overlay)
+		{
+			uint64_t start = Metrics::now();
+			draw_overlay(renderer, report);
+			render_time += Metrics::now() - start;
+		}
+		metrics.add_time(Metrics::render, render_time);
+
+		if (chip8.beep())
+		{
+			remaining_audio_frames = audio_frames;
+		}
+		play(audio_device, audio, chip8, remaining_audio_frames > 0);
+		if (remaining_audio_frames > 0) --remaining_audio_frames;
+
+		uint64_t present_start = Metrics::now();
 		SDL_RenderPresent(renderer);
-		SDL_Delay(1);
+		uint64_t present_end = Metrics::now();
+		metrics.add_time(Metrics::present, present_end - present_start);
+		metrics.presented(present_end, drawn_hash != presented_hash);
+		presented_hash = drawn_hash;
+
+		if (metrics.update(present_end, report) && !metrics_file.empty() && !write_metrics(metrics_file, report))
+		{
+			std::cerr << metrics_file << ": could not write metrics" << std::endl;
+			metrics_file.clear();
+		}
+
+		// wait for the next frame, or give up on catching up if we fell behind
+		next_frame += 1000.0 / frames_per_second;
+		double now = SDL_GetTicks();
+		if (next_frame > now) SDL_Delay(next_frame - now);
+		else next_frame = now;
+	}
+
+	if (trace && !trace->dump(trace_file))
+	{
+		std::cerr << trace_file << ": could not write trace" << std::endl;
+	}
+
+	if (runahead_frames > 0 && emulated_frames > 0 && emulation_ticks > 0)
+	{
+		double frequency = SDL_GetPerformanceFrequency();
+		std::cerr << "run-ahead: " << runahead_frames << " frames saves about "
+			<< runahead_frames * 1000 / frames_per_second << " ms of input latency for "
+			<< runahead_ticks * 1e6 / frequency / emulated_frames << " us extra emulation per frame ("
+			<< static_cast<double>(runahead_ticks) / emulation_ticks << "x the normal cost)" << std::endl;
+	}
+
+	if (rewind.size() > 0)
+	{
+		size_t per_minute = rewind.memory_used() * 60 * frames_per_second / rewind.size();
+		std::cerr << "rewind: " << rewind.size() << " frames in " << rewind.memory_used() / 1024 << " KiB, about "
+			<< per_minute / 1024 << " KiB per minute of history" << std::endl;
 	}
 
-	SDL_CloseAudio();
+	for (SDL_GameController* controller : controllers) SDL_GameControllerClose(controller);
+	// stops the callback before the state it uses goes away
+	if (audio_device) SDL_CloseAudioDevice(audio_device);
+	if (screen_texture) SDL_DestroyTexture(screen_texture);
 	SDL_DestroyRenderer(renderer);
 	SDL_DestroyWindow(window);
 	SDL_Quit();
 
-	return EXIT_SUCCESS;
+	return faulted ? EXIT_FAILURE : EXIT_SUCCESS;
 }
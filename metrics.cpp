@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <chrono>
+#include "metrics.hpp"
+
+uint64_t Metrics::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Metrics::input(uint64_t time)
+{
+	// several inputs in one frame are all answered by the same present, count the oldest
+	if (!pending_input) pending_input = time;
+}
+
+void Metrics::presented(uint64_t time, bool changed)
+{
+	++frames;
+	if (!pending_input) return;
+
+	// key to photon: only a frame that shows something new answers an input
+	uint64_t latency = time > pending_input ? time - pending_input : 0;
+	if (changed)
+	{
+		input_latency += latency;
+		max_input_latency = std::max(max_input_latency, latency);
+		++inputs;
+		pending_input = 0;
+	}
+	else if (latency > input_timeout)
+	{
+		// e.g. a key the ROM ignores, don't blame the next unrelated change on it
+		++unanswered;
+		pending_input = 0;
+	}
+}
+
+void Metrics::audio_callback(uint64_t time, uint64_t buffer_nanoseconds)
+{
+	uint64_t last = last_callback.exchange(time, std::memory_order_relaxed);
+	if (last && time - last > buffer_nanoseconds * 3 / 2)
+	{
+		underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+bool Metrics::update(uint64_t time, Report& report)
+{
+	if (!period_start)
+	{
+		period_start = time;
+		cpu_start = std::clock();
+		return false;
+	}
+	if (time - period_start < interval) return false;
+
+	double seconds = (time - period_start) / 1e9;
+	std::clock_t cpu = std::clock();
+	uint64_t total_underruns = underruns.load(std::memory_order_relaxed);
+
+	report.seconds = seconds;
+	report.instructions_per_second = steps / seconds;
+	report.frames_per_second = frames / seconds;
+	for (unsigned int phase = 0; phase < phases; ++phase)
+	{
+		report.phase_ms[phase] = frames ? phase_time[phase] / 1e6 / frames : 0;
+	}
+	report.audio_underruns = total_underruns - reported_underruns;
+	report.input_latency_ms = inputs ? input_latency / 1e6 / inputs : 0;
+	report.input_latency_max_ms = max_input_latency / 1e6;
+	report.unanswered_inputs = unanswered;
+	report.cpu_percent = 100.0 * (cpu - cpu_start) / CLOCKS_PER_SEC / seconds;
+
+	period_start = time;
+	cpu_start = cpu;
+	steps = 0;
+	frames = 0;
+	phase_time.fill(0);
+	input_latency = 0;
+	max_input_latency = 0;
+	inputs = 0;
+	unanswered = 0;
+	reported_underruns = total_underruns;
+	return true;
+}
+
+void Metrics::write_json(std::ostream& out, const Report& report)
+{
+	out << "{\"seconds\": " << report.seconds
+		<< ", \"instructions_per_second\": " << report.instructions_per_second
+		<< ", \"frames_per_second\": " << report.frames_per_second
+		<< ", \"emulation_ms\": " << report.phase_ms[emulation]
+		<< ", \"render_ms\": " << report.phase_ms[render]
+		<< ", \"present_ms\": " << report.phase_ms[present]
+		<< ", \"audio_underruns\": " << report.audio_underruns
+		<< ", \"input_latency_ms\": " << report.input_latency_ms
+		<< ", \"input_latency_max_ms\": " << report.input_latency_max_ms
+		<< ", \"unanswered_inputs\": " << report.unanswered_inputs
+		<< ", \"cpu_percent\": " << report.cpu_percent
+		<< "}";
+}
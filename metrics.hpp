@@ -0,0 +1,83 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+
+/* Performance counters for the frontend, cheap enough to leave on.
+ *
+ * Each thread only touches its own counters: the frontend thread uses plain
+ * integers and the audio thread a relaxed atomic. Everything is turned into
+ * a Report once per second, which is the only time the threads meet.
+ * Times are nanoseconds on the steady clock, see now().
+ */
+class Metrics
+{
+public:
+	// where the frontend spends a frame
+	enum Phase
+	{
+		emulation,
+		render,
+		present,
+		phases
+	};
+
+	struct Report
+	{
+		double seconds = 0; // covered by this report
+		double instructions_per_second = 0;
+		double frames_per_second = 0;
+		std::array<double, phases> phase_ms {}; // mean per frame
+		uint64_t audio_underruns = 0;
+		double input_latency_ms = 0; // mean, input event to the first present showing a change
+		double input_latency_max_ms = 0;
+		uint64_t unanswered_inputs = 0; // nothing on screen changed within input_timeout
+		double cpu_percent = 0; // host CPU time of the whole process, all threads
+	};
+
+private:
+	constexpr static uint64_t interval = 1000000000; // aggregate once per second
+	constexpr static uint64_t input_timeout = 500000000;
+
+	// frontend thread
+	uint64_t period_start = 0;
+	std::clock_t cpu_start = 0;
+	uint64_t steps = 0;
+	uint64_t frames = 0;
+	std::array<uint64_t, phases> phase_time {};
+	uint64_t pending_input = 0; // oldest input not presented yet, 0 if none
+	uint64_t input_latency = 0;
+	uint64_t max_input_latency = 0;
+	uint64_t inputs = 0;
+	uint64_t unanswered = 0;
+
+	// audio thread
+	std::atomic<uint64_t> last_callback {0}; // 0 after a pause, the next gap isn't an underrun
+	std::atomic<uint64_t> underruns {0};
+	uint64_t reported_underruns = 0;
+
+public:
+	static uint64_t now();
+
+	// frontend thread
+	void add_steps(uint64_t count) { steps += count; }
+	void add_time(Phase phase, uint64_t nanoseconds) { phase_time[phase] += nanoseconds; }
+	// a key event, stamped with when the host saw it
+	void input(uint64_t);
+	// changed is false if the frame looks the same as the one presented before
+	void presented(uint64_t, bool changed = true);
+	void audio_paused() { last_callback.store(0, std::memory_order_relaxed); }
+
+	/* audio thread: called at the start of each callback. a gap of more than
+	 * one and a half buffers since the last one means the device ran dry
+	 */
+	void audio_callback(uint64_t, uint64_t buffer_nanoseconds);
+
+	// true once per second with the averages since the last report
+	bool update(uint64_t, Report&);
+
+	// one JSON object on a single line
+	static void write_json(std::ostream&, const Report&);
+};
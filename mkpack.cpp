@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "pack.hpp"
+
+/* Builds a ROM pack from directories of ROMs, or lists one. Every regular
+ * file under the given directories becomes a ROM named after the file.
+ */
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-s SETTINGS] PACK DIRECTORY|ROM...\n"
+		<< "       " << name << " -l PACK\n"
+		<< "  -s SETTINGS  per-ROM settings, see pack.hpp for the format\n"
+		<< "  -l           list the ROMs in a pack\n";
+}
+
+static int list(const std::string& filename)
+{
+	Pack pack;
+	if (!pack.open(filename))
+	{
+		std::cerr << filename << ": not a ROM pack" << std::endl;
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < pack.size(); ++i)
+	{
+		const PackEntry& entry = pack.entry(i);
+		PackSettings settings = pack.settings(entry);
+		std::cout << std::hex << std::setw(16) << std::setfill('0') << entry.hash << std::dec
+			<< ' ' << std::setw(4) << std::setfill(' ') << entry.image_size << ' ' << pack.name(entry);
+		if (settings.steps_per_frame) std::cout << " steps=" << settings.steps_per_frame;
+		if (settings.profile != profile_default) std::cout << " profile=" << profile_name(settings.profile);
+		std::cout << '\n';
+	}
+	return EXIT_SUCCESS;
+}
+
+static bool add_rom(const std::filesystem::path& path, std::vector<PackRom>& roms)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << path.string() << ": could not read" << std::endl;
+		return false;
+	}
+	PackRom rom;
+	rom.name = path.filename().string();
+	rom.image.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	if (rom.image.size() > Chip8::max_rom_size)
+	{
+		std::cerr << path.string() << ": larger than " << Chip8::max_rom_size << " bytes, skipped" << std::endl;
+		return true;
+	}
+	roms.push_back(rom);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	std::string settings_file;
+	bool listing = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "s:l")) != -1)
+	{
+		switch (opt)
+		{
+			case 's': settings_file = optarg; break;
+			case 'l': listing = true; break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (listing && optind + 1 == argc) return list(argv[optind]);
+	if (listing || optind + 2 > argc)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	std::string pack_file = argv[optind];
+
+	std::vector<PackRom> roms;
+	for (int arg = optind + 1; arg < argc; ++arg)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(argv[arg], error))
+		{
+			if (!add_rom(argv[arg], roms)) return EXIT_FAILURE;
+			continue;
+		}
+		// sorted, so the same directory always gives the same pack and keeps the same duplicate
+		std::vector<std::filesystem::path> files;
+		for (const auto& file : std::filesystem::recursive_directory_iterator(argv[arg], error))
+		{
+			if (file.is_regular_file()) files.push_back(file.path());
+		}
+		if (error)
+		{
+			std::cerr << argv[arg] << ": " << error.message() << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::sort(files.begin(), files.end());
+		for (const std::filesystem::path& file : files)
+		{
+			if (!add_rom(file, roms)) return EXIT_FAILURE;
+		}
+	}
+
+	if (!settings_file.empty())
+	{
+		std::ifstream in(settings_file);
+		std::vector<std::pair<std::string, PackSettings>> settings;
+		std::string error;
+		if (!in || !read_pack_settings(in, settings, error))
+		{
+			std::cerr << settings_file << ": " << (in ? error : "could not read") << std::endl;
+			return EXIT_FAILURE;
+		}
+		for (const auto& [name, rom_settings] : settings)
+		{
+			bool found = false;
+			for (PackRom& rom : roms)
+			{
+				if (rom.name != name) continue;
+				rom.settings = rom_settings;
+				found = true;
+			}
+			if (!found) std::cerr << settings_file << ": no ROM named " << name << std::endl;
+		}
+	}
+
+	if (!write_pack(pack_file, roms))
+	{
+		std::cerr << pack_file << ": could not write" << std::endl;
+		return EXIT_FAILURE;
+	}
+	// duplicates were left out, so count what made it in
+	Pack pack;
+	if (!pack.open(pack_file))
+	{
+		std::cerr << pack_file << ": could not read back" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << pack_file << ": " << pack.size() << " ROMs" << std::endl;
+	return EXIT_SUCCESS;
+}
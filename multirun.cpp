@@ -0,0 +1,98 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "engine.hpp"
+#include "metrics.hpp"
+#include "scheduler.hpp"
+
+/* Runs many copies of ROMs in real time on a single thread with the
+ * cooperative scheduler, and prints its metrics as JSON once per second.
+ */
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-e ENGINE] [-n COPIES] [-t SECONDS] [-i STEPS] [-V] ROM...\n"
+		<< "  -e ENGINE   engine to run with (default reference)\n"
+		<< "  -n COPIES   instances of each ROM (default 100)\n"
+		<< "  -t SECONDS  how long to run (default 10)\n"
+		<< "  -i STEPS    steps per frame (default 16)\n"
+		<< "  -V          COSMAC VIP timing\n"
+		<< "engines:";
+	for (const std::string& engine : engine_names()) std::cerr << ' ' << engine;
+	std::cerr << '\n';
+}
+
+int main(int argc, char** argv)
+{
+	std::string engine_name = "reference";
+	unsigned long copies = 100;
+	uint64_t seconds = 10;
+	uint64_t steps_per_frame = 16;
+	bool vip_timing = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "e:n:t:i:V")) != -1)
+	{
+		switch (opt)
+		{
+			case 'e': engine_name = optarg; break;
+			case 'n': copies = std::strtoul(optarg, nullptr, 10); break;
+			case 't': seconds = std::strtoull(optarg, nullptr, 10); break;
+			case 'i': steps_per_frame = std::strtoull(optarg, nullptr, 10); break;
+			case 'V': vip_timing = true; break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	std::unique_ptr<Engine> engine = make_engine(engine_name);
+	if (!engine || optind >= argc)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	Scheduler scheduler(*engine);
+	for (int arg = optind; arg < argc; ++arg)
+	{
+		Chip8 chip8;
+		try
+		{
+			chip8.load_rom(argv[arg]);
+		}
+		catch (const std::runtime_error& e)
+		{
+			std::cerr << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (vip_timing) chip8.set_timing(Chip8::Timing::vip);
+		for (unsigned long copy = 0; copy < copies; ++copy) scheduler.add(chip8, steps_per_frame);
+	}
+
+	uint64_t start = Metrics::now();
+	uint64_t end = start + seconds * 1000000000;
+	uint64_t next_report = start + 1000000000;
+	Scheduler::Report report;
+	for (uint64_t now = start; now < end; now = Metrics::now())
+	{
+		uint64_t next = std::min(scheduler.run(next_report), next_report);
+		now = Metrics::now();
+		if (now >= next_report)
+		{
+			scheduler.report(report);
+			Scheduler::write_json(std::cout, report);
+			std::cout << std::endl;
+			next_report += 1000000000;
+		}
+		else if (next > now)
+		{
+			usleep((next - now) / 1000);
+		}
+	}
+	return EXIT_SUCCESS;
+}
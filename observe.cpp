@@ -0,0 +1,202 @@
+#include <cstring>
+#include "observe.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static_assert(Chip8::screen_width % 16 == 0, "kernels work on 16 pixels at a time");
+static_assert(sizeof(bool) == 1, "the framebuffer is read as bytes");
+
+// nonzero bytes of a plane become on, the rest 0.0
+static void plane_to_float(const uint8_t* plane, float* out, size_t size, float on)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	// widen each byte to a 32 bit all-ones or all-zeros mask and select on's bits with it
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+	const __m128i bits = _mm_castps_si128(_mm_set1_ps(on));
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(plane + i));
+		__m128i mask = _mm_xor_si128(_mm_cmpeq_epi8(pixels, zero), ones);
+		__m128i low = _mm_unpacklo_epi8(mask, mask);
+		__m128i high = _mm_unpackhi_epi8(mask, mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_and_si128(_mm_unpacklo_epi16(low, low), bits));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_and_si128(_mm_unpackhi_epi16(low, low), bits));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_and_si128(_mm_unpacklo_epi16(high, high), bits));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_and_si128(_mm_unpackhi_epi16(high, high), bits));
+	}
+#endif
+	for (; i < size; ++i) out[i] = plane[i] ? on : 0.0f;
+}
+
+void pack_screen(const Chip8& chip8, uint8_t* packed)
+{
+	const uint8_t* screen = reinterpret_cast<const uint8_t*>(chip8.get_screen().data());
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	for (; i < screen_pixels; i += 16)
+	{
+		__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(screen + i));
+		// byte k of the 16 lands in bit k
+		unsigned int bits = _mm_movemask_epi8(_mm_cmpgt_epi8(pixels, zero));
+		packed[i / 8] = bits;
+		packed[i / 8 + 1] = bits >> 8;
+	}
+#endif
+	for (; i < screen_pixels; i += 8)
+	{
+		uint8_t bits = 0;
+		for (unsigned int bit = 0; bit < 8; ++bit) bits |= (screen[i + bit] != 0) << bit;
+		packed[i / 8] = bits;
+	}
+}
+
+void unpack_screen(const uint8_t* packed, uint8_t* out, uint8_t on)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	// spread each packed byte over 8 bytes and test one bit in each
+	const __m128i select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m128i value = _mm_set1_epi8(on);
+	for (; i < screen_pixels; i += 16)
+	{
+		uint64_t low = packed[i / 8] * 0x0101010101010101ull;
+		uint64_t high = packed[i / 8 + 1] * 0x0101010101010101ull;
+		__m128i spread = _mm_set_epi64x(high, low);
+		__m128i lit = _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_and_si128(lit, value));
+	}
+#endif
+	for (; i < screen_pixels; ++i) out[i] = (packed[i / 8] >> (i % 8)) & 1 ? on : 0;
+}
+
+void unpack_screen(const uint8_t* packed, float* out, float on)
+{
+	uint8_t plane[screen_pixels];
+	unpack_screen(packed, plane, 1);
+	plane_to_float(plane, out, screen_pixels, on);
+}
+
+void downsample_screen(const uint8_t* plane, uint8_t* out)
+{
+	constexpr unsigned int width = Chip8::screen_width;
+	for (unsigned int row = 0; row < Chip8::screen_height; row += 2)
+	{
+		const uint8_t* top = plane + row * width;
+		const uint8_t* bottom = top + width;
+		uint8_t* result = out + row / 2 * width / 2;
+		unsigned int x = 0;
+#ifdef __SSE2__
+		// max of the two rows, then of neighbouring bytes, then narrow the 16 bit lanes back to bytes
+		const __m128i low_bytes = _mm_set1_epi16(0xff);
+		for (; x < width; x += 32)
+		{
+			__m128i a = _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x)));
+			__m128i b = _mm_max_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x + 16)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x + 16)));
+			a = _mm_and_si128(_mm_max_epu8(a, _mm_srli_epi16(a, 8)), low_bytes);
+			b = _mm_and_si128(_mm_max_epu8(b, _mm_srli_epi16(b, 8)), low_bytes);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(result + x / 2), _mm_packus_epi16(a, b));
+		}
+#endif
+		for (; x < width; x += 2)
+		{
+			uint8_t m = top[x];
+			if (top[x + 1] > m) m = top[x + 1];
+			if (bottom[x] > m) m = bottom[x];
+			if (bottom[x + 1] > m) m = bottom[x + 1];
+			result[x / 2] = m;
+		}
+	}
+}
+
+FrameStack::FrameStack(unsigned int depth) : depth(depth), ring((depth + 1) * packed_screen_size)
+{
+}
+
+void FrameStack::push(const Chip8& chip8)
+{
+	pack_screen(chip8, ring.data() + pushed % (depth + 1) * packed_screen_size);
+	++pushed;
+}
+
+void FrameStack::clear()
+{
+	pushed = 0;
+}
+
+unsigned int FrameStack::get_depth() const
+{
+	return depth;
+}
+
+size_t FrameStack::plane_size(bool downsample)
+{
+	return downsample ? downsampled_pixels : screen_pixels;
+}
+
+const uint8_t* FrameStack::frame(unsigned int age) const
+{
+	static const uint8_t blank[packed_screen_size] = {};
+	if (age >= pushed) return blank;
+	return ring.data() + (pushed - 1 - age) % (depth + 1) * packed_screen_size;
+}
+
+void FrameStack::combine(unsigned int age, bool max_pool, uint8_t* packed) const
+{
+	std::memcpy(packed, frame(age), packed_screen_size);
+	if (!max_pool) return;
+
+	// packed pixels are bits, so the max of two frames is an or
+	const uint8_t* before = frame(age + 1);
+	for (size_t i = 0; i < packed_screen_size; i += 8)
+	{
+		uint64_t a, b;
+		std::memcpy(&a, packed + i, 8);
+		std::memcpy(&b, before + i, 8);
+		a |= b;
+		std::memcpy(packed + i, &a, 8);
+	}
+}
+
+void FrameStack::write(uint8_t* out, bool max_pool, bool downsample, uint8_t on) const
+{
+	uint8_t packed[packed_screen_size];
+	uint8_t plane[screen_pixels];
+	for (unsigned int i = 0; i < depth; ++i)
+	{
+		combine(depth - 1 - i, max_pool, packed);
+		uint8_t* target = out + i * plane_size(downsample);
+		if (!downsample)
+		{
+			unpack_screen(packed, target, on);
+			continue;
+		}
+		unpack_screen(packed, plane, on);
+		downsample_screen(plane, target);
+	}
+}
+
+void FrameStack::write(float* out, bool max_pool, bool downsample, float on) const
+{
+	uint8_t packed[packed_screen_size];
+	uint8_t plane[screen_pixels];
+	uint8_t small[downsampled_pixels];
+	for (unsigned int i = 0; i < depth; ++i)
+	{
+		combine(depth - 1 - i, max_pool, packed);
+		float* target = out + i * plane_size(downsample);
+		if (!downsample)
+		{
+			unpack_screen(packed, target, on);
+			continue;
+		}
+		unpack_screen(packed, plane, 1);
+		downsample_screen(plane, small);
+		plane_to_float(small, target, downsampled_pixels, on);
+	}
+}
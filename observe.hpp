@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+
+/* Kernels turning the framebuffer into the planes training code consumes,
+ * written straight into caller buffers. SSE2 where available, with plain
+ * loops as the fallback; both give identical results.
+ *
+ * Planes are row-major, one element per pixel: 64x32, or 32x16 when
+ * downsampled with a 2x2 max. Packed screens keep one bit per pixel,
+ * pixel i in bit i % 8 of byte i / 8.
+ */
+
+constexpr size_t screen_pixels = Chip8::screen_width * Chip8::screen_height;
+constexpr size_t packed_screen_size = screen_pixels / 8;
+constexpr size_t downsampled_pixels = screen_pixels / 4;
+
+void pack_screen(const Chip8&, uint8_t* packed);
+// lit pixels become on, the rest 0
+void unpack_screen(const uint8_t* packed, uint8_t* out, uint8_t on = 1);
+void unpack_screen(const uint8_t* packed, float* out, float on = 1);
+// 2x2 max pooling of an unpacked plane
+void downsample_screen(const uint8_t* plane, uint8_t* out);
+
+/* The last depth screens, for stacking as channels. Screens are kept packed
+ * in a ring, so a push only writes the newest one and older ones are never
+ * moved.
+ */
+class FrameStack
+{
+	unsigned int depth;
+	std::vector<uint8_t> ring; // depth + 1 packed screens, the extra one for pooling the oldest
+	uint64_t pushed = 0;
+
+	// packed screen age frames back, 0 is the newest. blank before anything was pushed
+	const uint8_t* frame(unsigned int age) const;
+	void combine(unsigned int age, bool max_pool, uint8_t* packed) const;
+public:
+	explicit FrameStack(unsigned int depth);
+
+	void push(const Chip8&);
+	void clear();
+
+	unsigned int get_depth() const;
+	// elements per plane written by write()
+	static size_t plane_size(bool downsample);
+
+	/* depth planes, oldest first. max_pool lights a pixel if it was lit in
+	 * that frame or the one before, which hides sprites that flicker
+	 */
+	void write(uint8_t* out, bool max_pool = false, bool downsample = false, uint8_t on = 1) const;
+	void write(float* out, bool max_pool = false, bool downsample = false, float on = 1) const;
+};
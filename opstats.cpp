@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "fused.hpp"
+
+/* Opcode sequence statistics over a ROM corpus, for choosing which
+ * sequences the fused engine should turn into superinstructions. The
+ * choice is made by hand from this report, the engine's candidates are
+ * written out in FusedEngine::decode. Also reports how many dispatches per
+ * frame the fused engine saves.
+ */
+
+// the opcode with its operands masked out, e.g. 6XNN for any register store
+static uint16_t opcode_class(uint16_t opcode)
+{
+	switch (opcode >> 12)
+	{
+		case 0x0: return opcode;
+		case 0x1: case 0x2: case 0xa: case 0xb: return opcode & 0xf000;
+		case 0x3: case 0x4: case 0x6: case 0x7: case 0xc: return opcode & 0xf000;
+		case 0xd: return 0xd000;
+		case 0xe: case 0xf: return opcode & 0xf0ff;
+		default: return opcode & 0xf00f; // 5XY0, 8XY?, 9XY0
+	}
+}
+
+static std::string class_name(uint16_t opclass)
+{
+	char name[5];
+	std::snprintf(name, sizeof(name), "%04X", opclass);
+	std::string text = name;
+	switch (opclass >> 12)
+	{
+		case 0x0: break;
+		case 0x1: case 0x2: case 0xa: case 0xb: text.replace(1, 3, "NNN"); break;
+		case 0x3: case 0x4: case 0x6: case 0x7: case 0xc: text.replace(1, 3, "XNN"); break;
+		case 0xd: text.replace(1, 3, "XYN"); break;
+		case 0xe: case 0xf: text[1] = 'X'; break;
+		default: text.replace(1, 2, "XY"); break;
+	}
+	return text;
+}
+
+struct Input
+{
+	std::minstd_rand random;
+	unsigned int frames_between;
+	uint64_t frame = 0;
+
+	// menus often wait for a key, so tap a random one every so often
+	void next_frame(Chip8& chip8)
+	{
+		if (++frame % frames_between != 0) return;
+		uint8_t key = random() % Chip8::registers_size;
+		chip8.press(key);
+		chip8.release(key);
+	}
+};
+
+static void usage(const char* name)
+{
+	std::cerr << "usage: " << name << " [-f FRAMES] [-i STEPS] [-k FRAMES] [-t TOP] ROM...\n"
+		<< "  -f FRAMES  frames to run each ROM for (default 3600)\n"
+		<< "  -i STEPS   steps per frame (default 16)\n"
+		<< "  -k FRAMES  frames between random key taps (default 60)\n"
+		<< "  -t TOP     sequences to list (default 15)\n";
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t frames = 3600;
+	uint64_t steps_per_frame = 16;
+	unsigned int key_frames = 60;
+	size_t top = 15;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "f:i:k:t:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'f': frames = std::strtoull(optarg, nullptr, 10); break;
+			case 'i': steps_per_frame = std::strtoull(optarg, nullptr, 10); break;
+			case 'k': key_frames = std::max(std::strtoul(optarg, nullptr, 10), 1ul); break;
+			case 't': top = std::strtoul(optarg, nullptr, 10); break;
+			default:
+				usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	if (optind >= argc)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::unordered_map<uint32_t, uint64_t> pairs;
+	std::unordered_map<uint64_t, uint64_t> triples;
+	uint64_t total_steps = 0;
+	uint64_t total_frames = 0;
+	uint64_t fused_dispatches = 0;
+
+	for (int arg = optind; arg < argc; ++arg)
+	{
+		Chip8 chip8(1);
+		chip8.load_rom(argv[arg]);
+		Chip8 start = chip8;
+
+		// reference run, collecting sequences of executed opcodes
+		Input input {std::minstd_rand(1), key_frames};
+		uint64_t previous = 0; // the last two classes, the newest in the low 16 bits
+		unsigned int history = 0; // how many of them have been seen
+		uint64_t frame = 0;
+		for (; frame < frames && chip8.get_fault() == Chip8::Fault::none; ++frame)
+		{
+			input.next_frame(chip8);
+			for (uint64_t i = 0; i < steps_per_frame; ++i)
+			{
+				if (chip8.is_waiting() || chip8.get_fault() != Chip8::Fault::none) break;
+
+				uint16_t pc = chip8.get_program_counter();
+				uint64_t opclass = opcode_class(chip8.get_memory(pc % Chip8::memory_size) << 8 | chip8.get_memory((pc + 1) % Chip8::memory_size)) & 0xffff;
+
+				if (history >= 1) ++pairs[(previous & 0xffff) << 16 | opclass];
+				if (history >= 2) ++triples[previous << 16 | opclass];
+				previous = (previous << 16 | opclass) & 0xffffffff;
+				history = std::min(history + 1, 2u);
+
+				chip8.step();
+				++total_steps;
+			}
+		}
+		if (chip8.get_fault() != Chip8::Fault::none)
+		{
+			std::cerr << argv[arg] << ": faulted at frame " << frame - 1 << ": " << Chip8::fault_name(chip8.get_fault()) << std::endl;
+		}
+		total_frames += frame;
+
+		// same run with the fused engine, counting dispatches
+		FusedEngine fused;
+		chip8 = start;
+		input = {std::minstd_rand(1), key_frames};
+		for (uint64_t f = 0; f < frame; ++f)
+		{
+			input.next_frame(chip8);
+			if (fused.run(chip8, steps_per_frame) != Chip8::Fault::none) break;
+		}
+		fused_dispatches += fused.get_dispatches();
+	}
+
+	if (total_steps == 0) return EXIT_FAILURE;
+
+	auto print = [&](const char* title, auto& counts, unsigned int length)
+	{
+		std::vector<std::pair<uint64_t, uint64_t>> sorted(counts.begin(), counts.end());
+		std::sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) { return a.second > b.second; });
+
+		std::printf("%s\n", title);
+		for (size_t i = 0; i < std::min(top, sorted.size()); ++i)
+		{
+			std::string sequence;
+			for (unsigned int j = length; j-- > 0;)
+			{
+				sequence += class_name((sorted[i].first >> (j * 16)) & 0xffff);
+				if (j) sequence += ' ';
+			}
+			std::printf("  %-16s %12llu  %5.2f%%\n", sequence.c_str(),
+				static_cast<unsigned long long>(sorted[i].second), 100.0 * sorted[i].second / total_steps);
+		}
+	};
+
+	print("pairs", pairs, 2);
+	print("triples", triples, 3);
+
+	// dispatches while waiting on a key don't happen in either engine
+	std::printf("%llu steps over %llu frames: %.1f dispatches per frame as reference, %.1f fused\n",
+		static_cast<unsigned long long>(total_steps), static_cast<unsigned long long>(total_frames),
+		static_cast<double>(total_steps) / total_frames, static_cast<double>(fused_dispatches) / total_frames);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "hash.hpp"
+#include "pack.hpp"
+
+static_assert(sizeof(PackEntry) == 56, "PackEntry is stored as is");
+
+static constexpr char magic[4] = {'C', '8', 'P', 'K'};
+static constexpr uint32_t version = 1;
+
+struct PackHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t names_size;
+};
+
+Pack::~Pack()
+{
+	close();
+}
+
+void Pack::close()
+{
+	if (data) munmap(const_cast<uint8_t*>(data), mapped_size);
+	data = nullptr;
+	mapped_size = 0;
+	entries = nullptr;
+	count = 0;
+	names = nullptr;
+}
+
+bool Pack::open(const std::string& filename)
+{
+	close();
+
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat info;
+	if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(PackHeader))
+	{
+		::close(fd);
+		return false;
+	}
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping stays valid
+	if (mapping == MAP_FAILED) return false;
+	data = static_cast<const uint8_t*>(mapping);
+	mapped_size = info.st_size;
+
+	// check everything once here, so lookups can trust the file
+	PackHeader header;
+	std::memcpy(&header, data, sizeof(header));
+	size_t names_start = sizeof(header) + static_cast<size_t>(header.count) * sizeof(PackEntry);
+	if (std::memcmp(header.magic, magic, sizeof(magic)) || header.version != version
+		|| names_start + header.names_size > mapped_size)
+	{
+		close();
+		return false;
+	}
+	entries = reinterpret_cast<const PackEntry*>(data + sizeof(header));
+	count = header.count;
+	names = reinterpret_cast<const char*>(data + names_start);
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const PackEntry& entry = entries[i];
+		bool valid = entry.image_size <= Chip8::max_rom_size
+			&& static_cast<size_t>(entry.image_offset) + entry.image_size <= mapped_size
+			&& static_cast<size_t>(entry.name_offset) + entry.name_size <= header.names_size
+			&& entry.profile < profiles
+			&& (i == 0 || entries[i - 1].hash <= entry.hash);
+		if (!valid)
+		{
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+const PackEntry* Pack::find(uint64_t hash) const
+{
+	const PackEntry* end = entries + count;
+	const PackEntry* entry = std::lower_bound(entries, end, hash,
+		[](const PackEntry& e, uint64_t h) { return e.hash < h; });
+	return entry != end && entry->hash == hash ? entry : nullptr;
+}
+
+const PackEntry* Pack::find(const std::string& key) const
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const PackEntry& entry = entries[i];
+		if (entry.name_size == key.size() && key.compare(0, key.size(), names + entry.name_offset, entry.name_size) == 0) return &entry;
+	}
+
+	if (key.size() != 16 || key.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) return nullptr;
+	return find(std::stoull(key, nullptr, 16));
+}
+
+std::string Pack::name(const PackEntry& entry) const
+{
+	return std::string(names + entry.name_offset, entry.name_size);
+}
+
+PackSettings Pack::settings(const PackEntry& entry) const
+{
+	PackSettings settings;
+	settings.steps_per_frame = entry.steps_per_frame;
+	settings.profile = static_cast<PackProfile>(entry.profile);
+	settings.keys = entry.keys;
+	return settings;
+}
+
+void Pack::load(const PackEntry& entry, Chip8& chip8) const
+{
+	chip8.load_bytes(data + entry.image_offset, entry.image_size);
+}
+
+uint64_t rom_hash(const uint8_t* image, size_t size)
+{
+	return hash_bytes(image, size);
+}
+
+bool write_pack(const std::string& filename, const std::vector<PackRom>& roms)
+{
+	std::vector<PackEntry> entries;
+	std::vector<const PackRom*> sources;
+	std::string names;
+	for (const PackRom& rom : roms)
+	{
+		if (rom.image.size() > Chip8::max_rom_size || rom.name.size() > UINT16_MAX) return false;
+
+		PackEntry entry {};
+		entry.hash = rom_hash(rom.image.data(), rom.image.size());
+		bool duplicate = std::any_of(entries.begin(), entries.end(), [&](const PackEntry& e) { return e.hash == entry.hash; });
+		if (duplicate) continue;
+
+		entry.name_offset = names.size();
+		entry.name_size = rom.name.size();
+		entry.image_size = rom.image.size();
+		entry.steps_per_frame = rom.settings.steps_per_frame;
+		entry.profile = rom.settings.profile;
+		entry.keys = rom.settings.keys;
+		names += rom.name;
+		entries.push_back(entry);
+		sources.push_back(&rom);
+	}
+
+	// entries are sorted by hash for lookups, and images stored in the same order
+	std::vector<size_t> order(entries.size());
+	for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return entries[a].hash < entries[b].hash; });
+
+	PackHeader header;
+	std::memcpy(header.magic, magic, sizeof(magic));
+	header.version = version;
+	header.count = entries.size();
+	header.names_size = names.size();
+
+	size_t offset = sizeof(header) + entries.size() * sizeof(PackEntry) + names.size();
+	std::vector<PackEntry> sorted;
+	for (size_t i : order)
+	{
+		sorted.push_back(entries[i]);
+		sorted.back().image_offset = offset;
+		offset += entries[i].image_size;
+	}
+	if (offset > UINT32_MAX) return false;
+
+	std::ofstream file(filename, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(sorted.data()), sorted.size() * sizeof(PackEntry));
+	file.write(names.data(), names.size());
+	for (size_t i : order) file.write(reinterpret_cast<const char*>(sources[i]->image.data()), sources[i]->image.size());
+	return static_cast<bool>(file);
+}
+
+// a host key given as a letter or digit, as a USB HID usage
+static uint16_t scancode(char c)
+{
+	c = std::tolower(static_cast<unsigned char>(c));
+	if (c >= 'a' && c <= 'z') return 4 + (c - 'a');
+	if (c >= '1' && c <= '9') return 30 + (c - '1');
+	if (c == '0') return 39;
+	return 0;
+}
+
+bool read_pack_settings(std::istream& in, std::vector<std::pair<std::string, PackSettings>>& settings, std::string& error)
+{
+	std::string line;
+	for (unsigned int number = 1; std::getline(in, line); ++number)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string name;
+		if (!(words >> name)) continue;
+
+		PackSettings rom;
+		for (std::string word; words >> word;)
+		{
+			size_t equals = word.find('=');
+			std::string key = word.substr(0, equals);
+			std::string value = equals == std::string::npos ? "" : word.substr(equals + 1);
+
+			bool valid = !value.empty();
+			if (key == "steps")
+			{
+				unsigned long steps = std::strtoul(value.c_str(), nullptr, 10);
+				valid = valid && steps > 0 && steps <= UINT16_MAX;
+				rom.steps_per_frame = steps;
+			}
+			else if (key == "profile")
+			{
+				valid = false;
+				for (uint8_t p = 0; p < profiles; ++p)
+				{
+					if (value != profile_name(static_cast<PackProfile>(p))) continue;
+					rom.profile = static_cast<PackProfile>(p);
+					valid = true;
+				}
+			}
+			else if (key.size() == 5 && key.compare(0, 4, "key.") == 0 && std::isxdigit(static_cast<unsigned char>(key[4])))
+			{
+				uint16_t code = value.size() == 1 ? scancode(value[0]) : 0;
+				valid = code != 0;
+				rom.keys[std::stoul(key.substr(4), nullptr, 16)] = code;
+			}
+			else
+			{
+				valid = false;
+			}
+
+			if (!valid)
+			{
+				error = "line " + std::to_string(number) + ": bad setting " + word;
+				return false;
+			}
+		}
+		settings.emplace_back(name, rom);
+	}
+	return true;
+}
+
+const char* profile_name(PackProfile profile)
+{
+	switch (profile)
+	{
+		case profile_default: return "default";
+		case profile_vip: return "vip";
+		default: return "unknown";
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "chip8.hpp"
+
+/* A catalog of ROMs in a single file, memory-mapped so that loading a ROM is
+ * a lookup and a copy of at most 3.5 KB. Layout, in host (little endian)
+ * byte order:
+ *
+ *   header   "C8PK", then version, entry count and names size as u32
+ *   entries  count PackEntry records, sorted by hash
+ *   names    all ROM names back to back, not terminated
+ *   images   the ROMs
+ *
+ * mkpack builds packs from directories of ROMs. ROMs are found by name or
+ * by the hash of their contents.
+ */
+
+// how a ROM wants to be run, stored with it
+enum PackProfile : uint8_t
+{
+	profile_default,
+	profile_vip, // Chip8::Timing::vip
+	profiles
+};
+
+struct PackSettings
+{
+	uint16_t steps_per_frame = 0; // 0 for the frontend's default
+	PackProfile profile = profile_default;
+	// host scancode (USB HID usage, as SDL uses) for each key, 0 to keep the default
+	std::array<uint16_t, Chip8::registers_size> keys {};
+};
+
+struct PackEntry
+{
+	uint64_t hash;
+	uint32_t image_offset; // from the start of the file
+	uint32_t name_offset; // from the start of the names
+	uint16_t image_size;
+	uint16_t name_size;
+	uint16_t steps_per_frame;
+	uint8_t profile;
+	uint8_t reserved;
+	std::array<uint16_t, Chip8::registers_size> keys;
+};
+
+// a ROM to put into a pack
+struct PackRom
+{
+	std::string name;
+	std::vector<uint8_t> image;
+	PackSettings settings;
+};
+
+class Pack
+{
+	const uint8_t* data = nullptr;
+	size_t mapped_size = 0;
+
+	const PackEntry* entries = nullptr;
+	uint32_t count = 0;
+	const char* names = nullptr;
+
+	void close();
+public:
+	Pack() = default;
+	~Pack();
+	Pack(const Pack&) = delete;
+	Pack& operator=(const Pack&) = delete;
+
+	// map a pack, false if it can't be read or isn't a valid pack
+	bool open(const std::string& filename);
+
+	size_t size() const { return count; }
+	const PackEntry& entry(size_t i) const { return entries[i]; }
+
+	// nullptr if there is no such ROM
+	const PackEntry* find(uint64_t hash) const;
+	// by name, or by hash written as 16 hex digits
+	const PackEntry* find(const std::string&) const;
+
+	std::string name(const PackEntry&) const;
+	PackSettings settings(const PackEntry&) const;
+	// load the ROM into a machine, as Chip8::load_rom would
+	void load(const PackEntry&, Chip8&) const;
+};
+
+uint64_t rom_hash(const uint8_t*, size_t);
+
+/* write a pack, false if it can't be written or a ROM is too large. a ROM
+ * whose contents are already in the pack under another name is left out
+ */
+bool write_pack(const std::string& filename, const std::vector<PackRom>&);
+
+/* per-ROM settings, one ROM per line, # starts a comment:
+ *   NAME [steps=STEPS] [profile=default|vip] [key.K=C]...
+ * where STEPS is instructions per frame, K a Chip8 key as a hex digit and C
+ * a letter or digit on the host keyboard. false and a message in error on
+ * malformed lines
+ */
+bool read_pack_settings(std::istream&, std::vector<std::pair<std::string, PackSettings>>&, std::string& error);
+
+const char* profile_name(PackProfile);
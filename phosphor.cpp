@@ -0,0 +1,74 @@
+#include <algorithm>
+#include "phosphor.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static_assert(sizeof(bool) == 1, "the framebuffer is read as bytes");
+
+Phosphor::Phosphor(unsigned int _width, unsigned int _height, uint8_t _retain)
+	: width(_width), height(_height), retain(_retain), intensity(_width * _height), image(_width * _height)
+{
+	clear();
+}
+
+void Phosphor::clear()
+{
+	std::fill(intensity.begin(), intensity.end(), 0);
+	std::fill(image.begin(), image.end(), 0xff000000);
+}
+
+void Phosphor::update(const Chip8& chip8)
+{
+	update(chip8.get_screen().data());
+}
+
+void Phosphor::update(const bool* screen)
+{
+	const uint8_t* lit = reinterpret_cast<const uint8_t*>(screen);
+	size_t i = 0;
+#ifdef __SSE2__
+	/* decay in 16 bit lanes, since SSE2 can't multiply bytes. lit pixels are
+	 * ORed in as all ones, then each byte is spread over a pixel as i, i, i,
+	 * 0xff, which is ARGB8888 in little endian memory order
+	 */
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_cmpeq_epi8(zero, zero);
+	const __m128i factor = _mm_set1_epi16(retain);
+	for (; i + 16 <= intensity.size(); i += 16)
+	{
+		__m128i level = _mm_loadu_si128(reinterpret_cast<const __m128i*>(intensity.data() + i));
+		__m128i low = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(level, zero), factor), 8);
+		__m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(level, zero), factor), 8);
+		__m128i mask = _mm_xor_si128(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lit + i)), zero), ones);
+		level = _mm_or_si128(_mm_packus_epi16(low, high), mask);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(intensity.data() + i), level);
+
+		__m128i gray_low = _mm_unpacklo_epi8(level, level);
+		__m128i gray_high = _mm_unpackhi_epi8(level, level);
+		__m128i alpha_low = _mm_unpacklo_epi8(level, ones);
+		__m128i alpha_high = _mm_unpackhi_epi8(level, ones);
+		__m128i* out = reinterpret_cast<__m128i*>(image.data() + i);
+		_mm_storeu_si128(out, _mm_unpacklo_epi16(gray_low, alpha_low));
+		_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gray_low, alpha_low));
+		_mm_storeu_si128(out + 2, _mm_unpacklo_epi16(gray_high, alpha_high));
+		_mm_storeu_si128(out + 3, _mm_unpackhi_epi16(gray_high, alpha_high));
+	}
+#endif
+	decay(lit, i);
+}
+
+void Phosphor::update_plain(const bool* screen)
+{
+	decay(reinterpret_cast<const uint8_t*>(screen), 0);
+}
+
+void Phosphor::decay(const uint8_t* lit, size_t begin)
+{
+	for (size_t i = begin; i < intensity.size(); ++i)
+	{
+		uint8_t level = lit[i] ? 0xff : intensity[i] * retain >> 8;
+		intensity[i] = level;
+		image[i] = 0xff000000 | level * 0x010101u;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+
+/* Display filter against flicker. Games move sprites by XORing them off and
+ * drawing them again, so a sprite is often missing from the frame that gets
+ * shown. Like the phosphor of a CRT, each pixel keeps an intensity that goes
+ * to full while the pixel is lit and fades by a fixed share every frame it
+ * isn't, so a sprite that is off for a frame only dims a little.
+ *
+ * The intensities and the ARGB8888 image made from them are updated in one
+ * pass on the CPU, ready for a single texture upload, 16 pixels at a time
+ * with SSE2 where available. The plain loop it falls back to also finishes
+ * the pixels left over.
+ */
+class Phosphor
+{
+	unsigned int width;
+	unsigned int height;
+	unsigned int retain; // out of 256, kept by an unlit pixel each frame
+	std::vector<uint8_t> intensity;
+	std::vector<uint32_t> image;
+
+	// the plain loop, from pixel begin on
+	void decay(const uint8_t* lit, size_t begin);
+public:
+	// retain 0 turns the filter off, higher values leave longer trails
+	Phosphor(unsigned int width = Chip8::screen_width, unsigned int height = Chip8::screen_height, uint8_t retain = 160);
+
+	// one frame passes with these pixels lit, width * height of them, row-major
+	void update(const bool* screen);
+	void update(const Chip8&);
+	// the same without SSE2, for checking one against the other
+	void update_plain(const bool* screen);
+	// everything dark again, e.g. after loading a state
+	void clear();
+
+	uint8_t get_intensity(unsigned int x, unsigned int y) const { return intensity[y * width + x]; }
+	// white at the intensity of each pixel, width pixels per row
+	const uint32_t* get_image() const { return image.data(); }
+	unsigned int get_width() const { return width; }
+	unsigned int get_height() const { return height; }
+};
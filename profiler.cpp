@@ -0,0 +1,120 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "profiler.hpp"
+
+Profiler::Profiler()
+{
+	clear();
+}
+
+uint32_t Profiler::child(uint32_t parent, uint16_t address)
+{
+	uint64_t key = static_cast<uint64_t>(parent) << 16 | address;
+	auto found = children.find(key);
+	if (found != children.end()) return found->second;
+
+	uint32_t node = nodes.size();
+	nodes.push_back({parent, address});
+	children.emplace(key, node);
+	return node;
+}
+
+void Profiler::run(Chip8& chip8, uint64_t steps)
+{
+	if (path.size() != chip8.get_stack_depth() + 1)
+	{
+		reset_path();
+		sample(chip8, 0);
+	}
+
+	for (uint64_t i = 0; i < steps && chip8.get_fault() == Chip8::Fault::none; ++i)
+	{
+		++nodes[path.back()].count;
+		chip8.step();
+
+		// calls and returns show up as a change in stack depth
+		unsigned int depth = chip8.get_stack_depth();
+		if (depth + 1 == path.size()) continue;
+		while (path.size() > depth + 1) path.pop_back();
+		if (path.size() < depth + 1) path.push_back(child(path.back(), chip8.get_program_counter()));
+	}
+}
+
+void Profiler::sample(const Chip8& chip8, uint64_t weight)
+{
+	path.resize(1);
+	for (unsigned int frame = 0; frame < chip8.get_stack_depth(); ++frame)
+	{
+		// the call is the instruction before the return address
+		uint16_t call = (chip8.get_stack_frame(frame) - 2) % Chip8::memory_size;
+		uint16_t opcode = chip8.get_memory(call) << 8 | chip8.get_memory((call + 1) % Chip8::memory_size);
+		uint16_t entry = (opcode >> 12) == 0x2 ? opcode & 0x0fff : call;
+		path.push_back(child(path.back(), entry));
+	}
+	nodes[path.back()].count += weight;
+}
+
+void Profiler::reset_path()
+{
+	path.assign(1, 0);
+}
+
+void Profiler::clear()
+{
+	nodes.assign(1, {0, 0});
+	children.clear();
+	reset_path();
+}
+
+uint64_t Profiler::total() const
+{
+	uint64_t sum = 0;
+	for (const Node& node : nodes) sum += node.count;
+	return sum;
+}
+
+void Profiler::write_folded(std::ostream& out, const std::string& root, const symbols_t& symbols) const
+{
+	// names are built root first, so parents always come before their children
+	std::vector<std::string> names(nodes.size());
+	names[0] = root;
+	for (uint32_t node = 1; node < nodes.size(); ++node)
+	{
+		auto symbol = symbols.find(nodes[node].address);
+		std::string name;
+		if (symbol != symbols.end())
+		{
+			name = symbol->second;
+		}
+		else
+		{
+			char buffer[16];
+			std::snprintf(buffer, sizeof(buffer), "sub_%03X", nodes[node].address);
+			name = buffer;
+		}
+		names[node] = names[nodes[node].parent] + ';' + name;
+	}
+
+	for (uint32_t node = 0; node < nodes.size(); ++node)
+	{
+		if (nodes[node].count) out << names[node] << ' ' << nodes[node].count << '\n';
+	}
+}
+
+bool Profiler::read_symbols(const std::string& filename, symbols_t& symbols)
+{
+	std::ifstream file(filename);
+	if (!file) return false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream fields(line);
+		unsigned int address;
+		std::string name;
+		if (fields >> std::hex >> address >> name) symbols[address % Chip8::memory_size] = name;
+	}
+	return true;
+}
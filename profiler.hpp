@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "chip8.hpp"
+
+/* Attributes executed instructions to guest call paths, i.e. the chain of
+ * subroutine entry addresses on the stack, and writes them as folded stacks
+ * for flamegraph.pl.
+ *
+ * In exact mode the profiler executes the machine itself and counts every
+ * step. In sampling mode any engine runs the machine and the call path is
+ * rebuilt from the guest stack now and then: each return address points
+ * just past the CALL that pushed it, which holds the entry address.
+ */
+class Profiler
+{
+	struct Node
+	{
+		uint32_t parent;
+		uint16_t address; // subroutine entry
+		uint64_t count = 0;
+	};
+
+	std::vector<Node> nodes; // call tree, 0 is the root
+	std::unordered_map<uint64_t, uint32_t> children; // (parent, address) -> node
+
+	std::vector<uint32_t> path; // nodes for the current stack in exact mode, root first
+
+	uint32_t child(uint32_t, uint16_t);
+public:
+	typedef std::map<uint16_t, std::string> symbols_t;
+
+	Profiler();
+
+	// exact mode: execute steps, attributing each to the current call path
+	void run(Chip8&, uint64_t);
+	// sampling mode: attribute weight steps to the machine's current call path
+	void sample(const Chip8&, uint64_t weight = 1);
+
+	// forget the call path, e.g. after the machine was reset
+	void reset_path();
+	void clear();
+
+	uint64_t total() const;
+
+	// one line per call path: root;name;name count. unnamed subroutines show as sub_ADDR
+	void write_folded(std::ostream&, const std::string& root, const symbols_t& = symbols_t()) const;
+	// lines of "ADDRESS NAME" with a hex address, # starts a comment
+	static bool read_symbols(const std::string&, symbols_t&);
+};
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include "delta.hpp"
+#include "rewind.hpp"
+
+Rewind::Rewind(unsigned int _capacity, unsigned int _keyframe_interval)
+	: capacity(std::max(_capacity, 1u)), keyframe_interval(std::clamp(_keyframe_interval, 1u, capacity))
+{
+}
+
+// rebuild keyframe_image from the newest keyframe in the history
+void Rewind::decode_keyframe()
+{
+	keyframe_image.fill(0);
+	since_keyframe = 0;
+
+	for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame)
+	{
+		if (frame->keyframe)
+		{
+			delta_apply(frame->delta, keyframe_image.data(), image_size);
+			return;
+		}
+		++since_keyframe;
+	}
+}
+
+void Rewind::push(const Chip8& chip8)
+{
+	chip8.save_state(snapshot);
+
+	std::copy(snapshot.memory.begin(), snapshot.memory.end(), scratch.begin());
+	std::copy(snapshot.screen.begin(), snapshot.screen.end(), scratch.begin() + Chip8::memory_size);
+
+	frames.emplace_back();
+	Frame& frame = frames.back();
+
+	frame.keyframe = frames.size() == 1 || since_keyframe + 1 >= keyframe_interval;
+	if (frame.keyframe)
+	{
+		// keyframes are a delta against nothing, which compresses the zeroed parts of memory
+		image_t zero {};
+		delta_encode(zero.data(), scratch.data(), image_size, frame.delta);
+		keyframe_image = scratch;
+		since_keyframe = 0;
+	}
+	else
+	{
+		delta_encode(keyframe_image.data(), scratch.data(), image_size, frame.delta);
+		++since_keyframe;
+	}
+	frame.delta.shrink_to_fit();
+
+	frame.data_registers = snapshot.data_registers;
+	frame.address_register = snapshot.address_register;
+	frame.stack.assign(snapshot.stack.begin(), snapshot.stack.begin() + snapshot.stack_pointer);
+	frame.program_counter = snapshot.program_counter;
+	frame.delay_timer = snapshot.delay_timer;
+	frame.sound_timer = snapshot.sound_timer;
+	frame.audio_pattern = snapshot.audio_pattern;
+	frame.pitch = snapshot.pitch;
+	frame.waiting_for_input = snapshot.waiting_for_input;
+	frame.input_register = snapshot.input_register;
+	frame.random_state = snapshot.random_state;
+	frame.cycles = snapshot.cycles;
+
+	if (frames.size() > capacity)
+	{
+		// frames only make sense with their keyframe, so drop whole groups
+		do frames.pop_front();
+		while (!frames.empty() && !frames.front().keyframe);
+	}
+}
+
+bool Rewind::pop(Chip8& chip8)
+{
+	if (frames.empty()) return false;
+
+	const Frame& frame = frames.back();
+
+	if (frame.keyframe)
+	{
+		scratch.fill(0);
+		delta_apply(frame.delta, scratch.data(), image_size);
+	}
+	else
+	{
+		scratch = keyframe_image;
+		delta_apply(frame.delta, scratch.data(), image_size);
+	}
+
+	std::copy(scratch.begin(), scratch.begin() + Chip8::memory_size, snapshot.memory.begin());
+	std::copy(scratch.begin() + Chip8::memory_size, scratch.end(), snapshot.screen.begin());
+
+	snapshot.data_registers = frame.data_registers;
+	snapshot.address_register = frame.address_register;
+	snapshot.stack.fill(0);
+	std::copy(frame.stack.begin(), frame.stack.end(), snapshot.stack.begin());
+	snapshot.stack_pointer = frame.stack.size();
+	snapshot.program_counter = frame.program_counter;
+	snapshot.delay_timer = frame.delay_timer;
+	snapshot.sound_timer = frame.sound_timer;
+	snapshot.audio_pattern = frame.audio_pattern;
+	snapshot.pitch = frame.pitch;
+	snapshot.waiting_for_input = frame.waiting_for_input;
+	snapshot.input_register = frame.input_register;
+	snapshot.random_state = frame.random_state;
+	snapshot.cycles = frame.cycles;
+
+	chip8.load_state(snapshot);
+
+	bool was_keyframe = frame.keyframe;
+	frames.pop_back();
+
+	if (was_keyframe) decode_keyframe();
+	else --since_keyframe;
+
+	return true;
+}
+
+void Rewind::clear()
+{
+	frames.clear();
+	since_keyframe = 0;
+}
+
+size_t Rewind::size() const
+{
+	return frames.size();
+}
+
+size_t Rewind::memory_used() const
+{
+	size_t bytes = sizeof(*this);
+	for (const Frame& frame : frames)
+	{
+		bytes += sizeof(Frame) + frame.delta.capacity() + frame.stack.capacity() * sizeof(uint16_t);
+	}
+	return bytes;
+}
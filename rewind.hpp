@@ -0,0 +1,68 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "chip8.hpp"
+
+/* History of machine states, one per frame, for rewinding. Memory and screen
+ * are stored as compressed deltas against the most recent keyframe, so a
+ * frame usually costs a few dozen bytes instead of 6 KB.
+ */
+class Rewind
+{
+public:
+	// memory followed by the screen, one byte per pixel
+	constexpr static size_t image_size = Chip8::memory_size + Chip8::screen_width * Chip8::screen_height;
+
+private:
+	typedef std::array<uint8_t, image_size> image_t;
+
+	struct Frame
+	{
+		bool keyframe;
+		std::vector<uint8_t> delta; // image XORed against the keyframe (or nothing for keyframes)
+
+		std::array<uint8_t, Chip8::registers_size> data_registers;
+		uint16_t address_register;
+		std::vector<uint16_t> stack; // only the frames in use
+		uint16_t program_counter;
+		uint8_t delay_timer;
+		uint8_t sound_timer;
+		std::array<uint8_t, Chip8::audio_pattern_size> audio_pattern;
+		uint8_t pitch;
+		bool waiting_for_input;
+		uint8_t input_register;
+		uint32_t random_state; // so replaying a frame draws the same numbers
+		uint64_t cycles;
+	};
+
+	unsigned int capacity;
+	unsigned int keyframe_interval;
+
+	std::deque<Frame> frames;
+	unsigned int since_keyframe = 0; // frames pushed after the newest keyframe
+
+	// image of the newest keyframe, shared by encoding and decoding
+	image_t keyframe_image {};
+	image_t scratch {};
+	Chip8::Snapshot snapshot {};
+
+	void decode_keyframe();
+public:
+	/* capacity is in frames. Old frames are dropped a keyframe interval at a
+	 * time, so between capacity - keyframe_interval and capacity frames are kept
+	 */
+	Rewind(unsigned int capacity, unsigned int keyframe_interval = 60);
+
+	// record the current state
+	void push(const Chip8&);
+	// restore the most recent state and forget it, false if there is no history
+	bool pop(Chip8&);
+	void clear();
+
+	size_t size() const;
+	// approximate heap and object usage in bytes
+	size_t memory_used() const;
+};
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cmath>
+#include "metrics.hpp"
+#include "scheduler.hpp"
+
+Scheduler::Scheduler(Engine& _engine, uint64_t _frame_time, clock_t _clock) :
+	engine(_engine), frame_time(std::max<uint64_t>(_frame_time, 1)), clock(_clock ? _clock : Metrics::now)
+{
+	period_start = clock();
+}
+
+size_t Scheduler::add(const Chip8& chip8, uint64_t steps_per_frame)
+{
+	Instance instance {chip8, steps_per_frame, clock()};
+	// idle detection compares the state hash after every frame
+	instance.chip8.set_hash_tracking(true);
+	instance.last_hash = instance.chip8.hash();
+	instances.push_back(instance);
+	queue.emplace(instance.deadline, instances.size() - 1);
+	return instances.size() - 1;
+}
+
+void Scheduler::run_frame(Instance& instance)
+{
+	// a waiting machine with VIP timing takes one step per frame
+	engine.run_frame(instance.chip8, instance.steps_per_frame);
+}
+
+void Scheduler::wake(size_t i)
+{
+	Instance& instance = instances[i];
+	if (instance.state != waiting && instance.state != idle) return;
+
+	uint64_t now = clock();
+	if (instance.state == waiting && instance.chip8.get_timing() == Chip8::Timing::vip)
+	{
+		// the VIP takes its display interrupts while waiting, which tick the timers
+		for (; instance.deadline + frame_time <= now; instance.deadline += frame_time) run_frame(instance);
+	}
+	instance.deadline = std::max(instance.deadline, now);
+	instance.state = ready;
+	queue.emplace(instance.deadline, i);
+}
+
+void Scheduler::press(size_t i, uint8_t key)
+{
+	wake(i);
+	instances[i].chip8.press(key);
+}
+
+void Scheduler::release(size_t i, uint8_t key)
+{
+	wake(i);
+	instances[i].chip8.release(key);
+}
+
+uint64_t Scheduler::run(uint64_t until)
+{
+	uint64_t start = clock();
+	uint64_t now = start;
+	while (!queue.empty() && queue.top().first <= now && now < until)
+	{
+		size_t i = queue.top().second;
+		queue.pop();
+		Instance& instance = instances[i];
+
+		if (now - instance.deadline > max_lag_frames * frame_time)
+		{
+			uint64_t missed = (now - instance.deadline) / frame_time;
+			instance.dropped_frames += missed;
+			instance.deadline += missed * frame_time;
+		}
+
+		uint64_t frame_start = clock();
+		uint64_t lateness = frame_start - instance.deadline;
+		add_sample(instance.lateness, lateness);
+		instance.max_lateness = std::max(instance.max_lateness, lateness);
+		run_frame(instance);
+		if (instance.chip8.get_fault() != Chip8::Fault::none) instance.state = faulted;
+		machine_time += clock() - frame_start;
+		++instance.frames;
+		instance.deadline += frame_time;
+
+		if (instance.state != faulted)
+		{
+			uint64_t hash = instance.chip8.hash();
+			if (instance.chip8.is_waiting()) instance.state = waiting;
+			else if (hash == instance.last_hash) instance.state = idle;
+			else queue.emplace(instance.deadline, i);
+			instance.last_hash = hash;
+		}
+		now = clock();
+	}
+	run_time += now - start;
+	return queue.empty() ? UINT64_MAX : queue.top().first;
+}
+
+void Scheduler::add_sample(histogram_t& histogram, uint64_t nanoseconds)
+{
+	uint64_t microseconds = nanoseconds / 1000;
+	unsigned int bucket = microseconds ? 64 - __builtin_clzll(microseconds) : 0;
+	++histogram[std::min(bucket, buckets - 1)];
+}
+
+double Scheduler::percentile(const histogram_t& histogram, double fraction)
+{
+	uint64_t total = 0;
+	for (uint32_t count : histogram) total += count;
+	if (!total) return 0;
+
+	// the upper bound of the bucket the percentile falls into
+	uint64_t rank = std::ceil(fraction * total);
+	uint64_t seen = 0;
+	for (unsigned int bucket = 0; bucket < buckets; ++bucket)
+	{
+		seen += histogram[bucket];
+		if (seen >= rank) return (1ull << bucket) / 1e3;
+	}
+	return (1ull << (buckets - 1)) / 1e3;
+}
+
+void Scheduler::report(Report& report)
+{
+	uint64_t now = clock();
+	report = Report();
+	report.seconds = (now - period_start) / 1e9;
+	report.overhead_percent = run_time ? 100.0 * (run_time - machine_time) / run_time : 0;
+
+	histogram_t lateness {};
+	uint64_t max_lateness = 0;
+	double share_sum = 0, share_squares = 0;
+	size_t owed = 0;
+	for (Instance& instance : instances)
+	{
+		InstanceReport instance_report;
+		instance_report.state = instance.state;
+		instance_report.frames = instance.frames;
+		instance_report.dropped_frames = instance.dropped_frames;
+		instance_report.lateness_p99_ms = percentile(instance.lateness, 0.99);
+		instance_report.lateness_max_ms = instance.max_lateness / 1e6;
+		report.instances.push_back(instance_report);
+
+		report.frames += instance.frames;
+		report.dropped_frames += instance.dropped_frames;
+		if (instance.state == waiting || instance.state == idle) ++report.parked;
+		for (unsigned int bucket = 0; bucket < buckets; ++bucket) lateness[bucket] += instance.lateness[bucket];
+		max_lateness = std::max(max_lateness, instance.max_lateness);
+
+		// machines that were parked all along weren't owed anything
+		if (instance.frames + instance.dropped_frames)
+		{
+			double share = static_cast<double>(instance.frames) / (instance.frames + instance.dropped_frames);
+			share_sum += share;
+			share_squares += share * share;
+			++owed;
+		}
+
+		instance.frames = 0;
+		instance.dropped_frames = 0;
+		instance.lateness.fill(0);
+		instance.max_lateness = 0;
+	}
+
+	report.fairness = share_squares ? share_sum * share_sum / (owed * share_squares) : 1;
+	report.lateness_p50_ms = percentile(lateness, 0.5);
+	report.lateness_p99_ms = percentile(lateness, 0.99);
+	report.lateness_max_ms = max_lateness / 1e6;
+
+	period_start = now;
+	run_time = 0;
+	machine_time = 0;
+}
+
+void Scheduler::write_json(std::ostream& out, const Report& report)
+{
+	static const char* state_names[] = {"ready", "waiting", "idle", "faulted"};
+
+	out << "{\"seconds\": " << report.seconds
+		<< ", \"frames\": " << report.frames
+		<< ", \"dropped_frames\": " << report.dropped_frames
+		<< ", \"parked\": " << report.parked
+		<< ", \"overhead_percent\": " << report.overhead_percent
+		<< ", \"fairness\": " << report.fairness
+		<< ", \"lateness_p50_ms\": " << report.lateness_p50_ms
+		<< ", \"lateness_p99_ms\": " << report.lateness_p99_ms
+		<< ", \"lateness_max_ms\": " << report.lateness_max_ms
+		<< ", \"instances\": [";
+	for (size_t i = 0; i < report.instances.size(); ++i)
+	{
+		const InstanceReport& instance = report.instances[i];
+		out << (i ? ", " : "") << "{\"state\": \"" << state_names[instance.state]
+			<< "\", \"frames\": " << instance.frames
+			<< ", \"dropped_frames\": " << instance.dropped_frames
+			<< ", \"lateness_p99_ms\": " << instance.lateness_p99_ms
+			<< ", \"lateness_max_ms\": " << instance.lateness_max_ms << "}";
+	}
+	out << "]}";
+}
@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "chip8.hpp"
+#include "engine.hpp"
+
+/* Runs many machines on one thread, cooperatively: every machine owes one
+ * frame (steps_per_frame steps, or a frame's cycles with VIP timing) per
+ * frame period, and the frame with the earliest deadline always runs first.
+ * Machines that can't do anything useful are parked and cost nothing until
+ * a key is pressed or released on them:
+ *
+ *   - waiting for a key (FX0A)
+ *   - idle: a whole frame left the state hash unchanged, e.g. a ROM spinning
+ *     in a loop once its timers ran out. since the machine is deterministic,
+ *     every later frame would do the same until the keys change
+ *
+ * With steps timing a waiting machine doesn't change at all, so parking is
+ * exact. With VIP timing the frames it missed are caught up when it wakes.
+ * Idle detection relies on the hash, which leaves out the RNG: a loop that
+ * draws random numbers without keeping them would lose those draws.
+ */
+class Scheduler
+{
+public:
+	typedef uint64_t (*clock_t)(); // nanoseconds, e.g. Metrics::now
+
+	constexpr static uint64_t default_frame_time = 1000000000 / 60;
+	// a machine further behind than this skips frames instead of running a backlog
+	constexpr static uint64_t max_lag_frames = 4;
+
+	enum State
+	{
+		ready,
+		waiting, // parked on FX0A
+		idle, // parked, nothing changes until input
+		faulted, // stopped for good
+	};
+
+	struct InstanceReport
+	{
+		State state = ready;
+		uint64_t frames = 0;
+		uint64_t dropped_frames = 0;
+		double lateness_p99_ms = 0; // frame start after its deadline
+		double lateness_max_ms = 0;
+	};
+
+	// counted since the previous report
+	struct Report
+	{
+		double seconds = 0;
+		uint64_t frames = 0;
+		uint64_t dropped_frames = 0;
+		size_t parked = 0; // now
+		double overhead_percent = 0; // of the time in run(), spent choosing rather than running machines
+		double fairness = 1; // Jain's index of frames run over frames owed, 1 if all got their share
+		double lateness_p50_ms = 0;
+		double lateness_p99_ms = 0;
+		double lateness_max_ms = 0;
+		std::vector<InstanceReport> instances;
+	};
+
+private:
+	// lateness histograms: bucket b counts waits below 2^b microseconds
+	constexpr static unsigned int buckets = 24;
+	typedef std::array<uint32_t, buckets> histogram_t;
+
+	struct Instance
+	{
+		Chip8 chip8;
+		uint64_t steps_per_frame;
+		uint64_t deadline; // of the next frame, or when it was parked
+		State state = ready;
+		uint64_t last_hash = 0;
+
+		uint64_t frames = 0;
+		uint64_t dropped_frames = 0;
+		histogram_t lateness {};
+		uint64_t max_lateness = 0;
+	};
+
+	Engine& engine;
+	uint64_t frame_time;
+	clock_t clock;
+
+	std::vector<Instance> instances;
+	// deadline and index of every ready machine, earliest first
+	typedef std::pair<uint64_t, size_t> due_t;
+	std::priority_queue<due_t, std::vector<due_t>, std::greater<due_t>> queue;
+
+	uint64_t period_start = 0;
+	uint64_t run_time = 0; // inside run()
+	uint64_t machine_time = 0; // inside run(), running machines
+
+	void run_frame(Instance&);
+	void wake(size_t);
+	static void add_sample(histogram_t&, uint64_t);
+	static double percentile(const histogram_t&, double);
+public:
+	Scheduler(Engine&, uint64_t frame_time = default_frame_time, clock_t = nullptr);
+
+	// a copy of the machine is scheduled from now on, returns its index
+	size_t add(const Chip8&, uint64_t steps_per_frame = 16);
+	size_t size() const { return instances.size(); }
+	// the machine itself, to read it or to change it while it isn't running
+	Chip8& get(size_t i) { return instances[i].chip8; }
+	State get_state(size_t i) const { return instances[i].state; }
+
+	// input wakes parked machines
+	void press(size_t, uint8_t);
+	void release(size_t, uint8_t);
+
+	/* run the frames that are due, earliest deadline first, until none are
+	 * left or the clock reaches until. returns the next deadline, UINT64_MAX
+	 * if every machine is parked
+	 */
+	uint64_t run(uint64_t until = UINT64_MAX);
+
+	// the counters since the last report, then reset them
+	void report(Report&);
+	// one JSON object on a single line
+	static void write_json(std::ostream&, const Report&);
+};
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cmath>
+#include "speaker.hpp"
+
+Speaker::Speaker(unsigned int _device_rate) : device_rate(_device_rate)
+{
+	Chip8 initial(1);
+	set_pattern(initial.get_audio_pattern());
+	set_pitch(initial.get_pitch());
+}
+
+double Speaker::bit_rate(uint8_t pitch)
+{
+	return 4000 * std::exp2((pitch - 64) / 48.0);
+}
+
+void Speaker::set_pattern(const std::array<uint8_t, Chip8::audio_pattern_size>& _pattern)
+{
+	pattern = _pattern;
+	for (unsigned int bit = 0; bit < pattern_bits; ++bit)
+	{
+		bits[bit] = (pattern[bit / 8] >> (7 - bit % 8)) & 1;
+		ones[bit + 1] = ones[bit] + bits[bit];
+	}
+}
+
+void Speaker::set_pitch(uint8_t _pitch)
+{
+	pitch = _pitch;
+	increment = std::lround(bit_rate(pitch) / device_rate * (1u << bit_shift));
+}
+
+void Speaker::update(const Chip8& chip8, bool _playing)
+{
+	playing = _playing;
+	// the position is kept, so the sound carries on from where it was
+	if (chip8.get_audio_pattern() != pattern) set_pattern(chip8.get_audio_pattern());
+	if (chip8.get_pitch() != pitch) set_pitch(chip8.get_pitch());
+}
+
+uint64_t Speaker::high_time(uint32_t at) const
+{
+	unsigned int bit = at >> bit_shift;
+	return (static_cast<uint64_t>(ones[bit]) << bit_shift) + bits[bit] * static_cast<uint64_t>(at & bit_mask);
+}
+
+int64_t Speaker::next_level()
+{
+	// the fastest pitch is under 64 kHz, so a sample wraps around the pattern at most once
+	uint64_t end = static_cast<uint64_t>(position) + increment;
+	uint64_t high = high_time(static_cast<uint32_t>(end)) - high_time(position);
+	high += (end >> 32) * (static_cast<uint64_t>(ones[pattern_bits]) << bit_shift);
+	position = static_cast<uint32_t>(end);
+	return 2 * static_cast<int64_t>(high) - increment;
+}
+
+void Speaker::render(int16_t* samples, size_t count)
+{
+	const float scale = static_cast<float>(amplitude) / increment;
+	size_t i = 0;
+
+	// fading in or out, a step of gain per sample
+	for (; i < count && (playing ? gain < fade_samples : gain > 0); ++i)
+	{
+		gain += playing ? 1 : -1;
+		samples[i] = static_cast<int16_t>(next_level() * scale * gain / fade_samples);
+	}
+
+	if (!gain)
+	{
+		std::fill(samples + i, samples + count, 0);
+		return;
+	}
+	// full volume, branch free
+	for (; i < count; ++i) samples[i] = static_cast<int16_t>(next_level() * scale);
+}
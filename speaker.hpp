@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "chip8.hpp"
+
+/* Turns a machine's sound into samples for the audio device: the 1-bit
+ * pattern, looped at the rate its pitch asks for, resampled to the device
+ * rate. Each sample is the average of the pattern over the time the sample
+ * covers rather than the bit under it, so high pitches don't alias into
+ * noise. That average comes from a running count of set bits, a couple of
+ * table lookups per sample whatever the ratio of the rates.
+ *
+ * The position in the pattern carries on across pattern and pitch changes,
+ * and starting or stopping fades over fade_samples, so neither clicks.
+ * update() and render() may be called from different threads, but the
+ * caller must keep them from running at once (SDL_LockAudioDevice).
+ */
+class Speaker
+{
+public:
+	constexpr static unsigned int pattern_bits = Chip8::audio_pattern_size * 8;
+	constexpr static unsigned int fade_samples = 64;
+	constexpr static int16_t amplitude = 0x2000;
+
+private:
+	// the position is fixed point, 2^32 is once around the pattern
+	constexpr static unsigned int bit_shift = 32 - 7;
+	static_assert(pattern_bits == 1u << (32 - bit_shift), "a pattern must be a power of two bits");
+	constexpr static uint32_t bit_mask = (1u << bit_shift) - 1;
+
+	unsigned int device_rate;
+
+	std::array<uint8_t, Chip8::audio_pattern_size> pattern {};
+	std::array<uint8_t, pattern_bits> bits {}; // the pattern, one bit per entry
+	std::array<uint16_t, pattern_bits + 1> ones {}; // set bits before each one
+	uint8_t pitch = 0;
+
+	uint32_t position = 0;
+	uint32_t increment = 0; // per sample
+	bool playing = false;
+	unsigned int gain = 0; // out of fade_samples
+
+	void set_pattern(const std::array<uint8_t, Chip8::audio_pattern_size>&);
+	void set_pitch(uint8_t);
+	// time spent on set bits from the start of the pattern to a position, in the same units
+	uint64_t high_time(uint32_t) const;
+	// advance a sample, the share of it spent high from -increment to increment
+	int64_t next_level();
+public:
+	explicit Speaker(unsigned int device_rate);
+
+	// bits per second for an XO-CHIP pitch
+	static double bit_rate(uint8_t pitch);
+
+	// follow the machine's pattern and pitch, and sound or fall silent
+	void update(const Chip8&, bool playing);
+	// fill a buffer of mono samples
+	void render(int16_t*, size_t);
+};
@@ -69,6 +69,9 @@ TEST_CASE("Opcodes are decodable", "[chip8]")
 	REQUIRE(Chip8::decode_opcode(0xf633) == CHIP8_OP(deci, 0, 0x6, 0));
 	REQUIRE(Chip8::decode_opcode(0xfa55) == CHIP8_OP(dump, 0, 0xa, 0));
 	REQUIRE(Chip8::decode_opcode(0xfc65) == CHIP8_OP(load, 0, 0xc, 0));
+
+	REQUIRE(Chip8::decode_opcode(0xf002) == CHIP8_OP(pattern, 0, 0, 0));
+	REQUIRE(Chip8::decode_opcode(0xfd3a) == CHIP8_OP(pitch, 0, 0xd, 0));
 }
 
 TEST_CASE("Invalid opcodes decode to null", "[chip8]")
@@ -80,6 +83,7 @@ TEST_CASE("Invalid opcodes decode to null", "[chip8]")
 	REQUIRE(Chip8::decode_opcode(0x987d) == nullop);
 	REQUIRE(Chip8::decode_opcode(0xe1fa) == nullop);
 	REQUIRE(Chip8::decode_opcode(0xf235) == nullop);
+	REQUIRE(Chip8::decode_opcode(0xf102) == nullop);
 }
 
 TEST_CASE("Op clear 00E0", "[chip8]")
@@ -113,8 +117,14 @@ TEST_CASE("Op ret 00EE", "[chip8]")
 	REQUIRE(chip8.get_program_counter() == 0xbad);
 	chip8.op_ret(0, 0, 0);
 	REQUIRE(chip8.get_program_counter() == Chip8::program_mem_start);
+	REQUIRE(chip8.get_fault() == Chip8::Fault::none);
 
-	// TODO test when stack is empty?
+	// returning with an empty stack faults at the 00EE
+	chip8.op_goto(0x302, 0, 0);
+	chip8.op_ret(0, 0, 0);
+	REQUIRE(chip8.get_fault() == Chip8::Fault::stack_underflow);
+	REQUIRE(chip8.get_fault_address() == 0x300);
+	REQUIRE(chip8.get_program_counter() == 0x300);
 }
 
 TEST_CASE("Op goto 1NNN", "[chip8]")
@@ -881,6 +891,37 @@ TEST_CASE("Op load FX65", "[chip8]")
 	}
 }
 
+TEST_CASE("Op pattern/pitch F002/FX3A", "[chip8]")
+{
+	Chip8 chip8(1);
+	REQUIRE(chip8.get_pitch() == Chip8::default_pitch);
+	REQUIRE(chip8.get_audio_pattern()[0] == 0xf0);
+
+	for (uint8_t i = 0; i < Chip8::audio_pattern_size; ++i) chip8.set_memory(0x300 + i, i);
+	uint64_t before = chip8.hash();
+	chip8.op_save(0x300, 0, 0);
+	chip8.op_pattern(0, 0, 0);
+	for (uint8_t i = 0; i < Chip8::audio_pattern_size; ++i) REQUIRE(chip8.get_audio_pattern()[i] == i);
+	REQUIRE(chip8.get_address_register() == 0x300);
+	REQUIRE(chip8.hash() != before);
+
+	chip8.op_store(100, 4, 0);
+	chip8.op_pitch(0, 4, 0);
+	REQUIRE(chip8.get_pitch() == 100);
+
+	// both are part of the saved state
+	Chip8::Snapshot snapshot;
+	chip8.save_state(snapshot);
+	chip8.load_bytes(std::array<uint8_t, 2>{0x12, 0x00});
+	REQUIRE(chip8.get_pitch() == Chip8::default_pitch);
+	chip8.load_state(snapshot);
+	REQUIRE(chip8.get_pitch() == 100);
+	REQUIRE(chip8.get_audio_pattern()[15] == 15);
+
+	REQUIRE(Chip8::disassemble(0xf002) == "LD AUDIO, [I]");
+	REQUIRE(Chip8::disassemble(0xf53a) == "LD PITCH, V5");
+}
+
 TEST_CASE("Indicates when screen should redraw")
 {
 	Chip8 chip8;
@@ -888,3 +929,167 @@ TEST_CASE("Indicates when screen should redraw")
 	REQUIRE(chip8.should_draw() == true);
 	REQUIRE(chip8.should_draw() == false);
 }
+
+TEST_CASE("Save states restore the machine", "[chip8]")
+{
+	Chip8 chip8;
+
+	// 7001 2206 1200 00EE: count up in V0 and call an empty subroutine
+	chip8.load_bytes(std::array<uint8_t, 8>{0x70, 0x01, 0x22, 0x06, 0x12, 0x00, 0x00, 0xee});
+	chip8.step();
+	chip8.step();
+
+	Chip8::Snapshot snapshot;
+	chip8.save_state(snapshot);
+	chip8.should_draw();
+
+	for (int i = 0; i < 10; ++i) chip8.step();
+	REQUIRE(chip8.get_register(0) != 1);
+
+	chip8.load_state(snapshot);
+	REQUIRE(chip8.get_register(0) == 1);
+	REQUIRE(chip8.get_program_counter() == 0x206);
+	REQUIRE(chip8.should_draw() == true);
+
+	// the return address was restored too
+	chip8.step();
+	REQUIRE(chip8.get_program_counter() == 0x204);
+
+	// running ahead and loading the state back doesn't use up random numbers
+	chip8.load_bytes(std::array<uint8_t, 4>{0xc0, 0xff, 0x12, 0x00}); // 200 RND V0, FF; 202 JP 200
+	chip8.save_state(snapshot);
+	Chip8 reference = chip8;
+	for (int i = 0; i < 10; ++i) chip8.step();
+	chip8.load_state(snapshot);
+	for (int i = 0; i < 10; ++i)
+	{
+		chip8.step();
+		reference.step();
+		REQUIRE(chip8.get_register(0) == reference.get_register(0));
+	}
+}
+
+TEST_CASE("VIP timing counts machine cycles", "[chip8]")
+{
+	Chip8 chip8;
+	chip8.load_bytes(std::array<uint8_t, 12>{
+		0x60, 0x03, // 200 LD V0, 3
+		0xf0, 0x15, // 202 LD DT, V0
+		0x61, 0x08, // 204 LD V1, 8
+		0xd0, 0x15, // 206 DRW V0, V1, 5
+		0xf1, 0x0a, // 208 LD V1, K
+		0x30, 0x00}); // 20A SE V0, 0
+
+	SECTION("steps don't count cycles")
+	{
+		for (int i = 0; i < 4; ++i) chip8.step();
+		REQUIRE(chip8.get_cycles() == 0);
+	}
+
+	SECTION("instructions cost cycles and timers tick with the display")
+	{
+		chip8.set_timing(Chip8::Timing::vip);
+		REQUIRE(chip8.get_timing() == Chip8::Timing::vip);
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == 46);
+		chip8.step();
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == 142);
+
+		Chip8::Snapshot snapshot;
+		chip8.save_state(snapshot);
+		REQUIRE(snapshot.delay_timer == 3);
+
+		// the draw waits for the interrupt, which ticks the timer, then pays for 5 rows shifted by 3
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == Chip8::vip_frame_cycles + Chip8::vip_interrupt_cycles + 40 + 26 + 5 * (24 + 4 * 3));
+		REQUIRE(chip8.get_pixel(4, 8)); // I is still 0x200, so the sprite is 0x60
+		chip8.save_state(snapshot);
+		REQUIRE(snapshot.delay_timer == 2);
+
+		// waiting for a key lets whole frames pass
+		chip8.step();
+		REQUIRE(chip8.is_waiting());
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == 2 * Chip8::vip_frame_cycles + Chip8::vip_interrupt_cycles);
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == 3 * Chip8::vip_frame_cycles + Chip8::vip_interrupt_cycles);
+		chip8.save_state(snapshot);
+		REQUIRE(snapshot.delay_timer == 0);
+	}
+
+	SECTION("taken skips cost more")
+	{
+		chip8.set_timing(Chip8::Timing::vip);
+		chip8.load_bytes(std::array<uint8_t, 6>{0x30, 0x00, 0x00, 0x00, 0x30, 0x01});
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == 54);
+		chip8.step();
+		REQUIRE(chip8.get_cycles() == 54 + 50);
+	}
+
+	SECTION("save states keep the cycle count")
+	{
+		chip8.set_timing(Chip8::Timing::vip);
+		chip8.step();
+		Chip8::Snapshot snapshot;
+		chip8.save_state(snapshot);
+		chip8.step();
+		chip8.load_state(snapshot);
+		REQUIRE(chip8.get_cycles() == 46);
+	}
+}
+
+TEST_CASE("Faults stop the machine at the faulting instruction", "[chip8]")
+{
+	struct Case
+	{
+		const char* name;
+		std::array<uint8_t, 4> program;
+		Chip8::Fault fault;
+		uint16_t address;
+	};
+	const Case cases[] = {
+		{"invalid opcode", {0x60, 0x01, 0xff, 0xff}, Chip8::Fault::invalid_opcode, 0x202},
+		{"00EE without a call", {0x60, 0x01, 0x00, 0xee}, Chip8::Fault::stack_underflow, 0x202},
+		{"too many calls", {0x22, 0x00}, Chip8::Fault::stack_overflow, 0x200},
+		{"sprite past memory", {0xaf, 0xfe, 0xd0, 0x05}, Chip8::Fault::address_out_of_range, 0x202},
+		{"FX65 past memory", {0xaf, 0xff, 0xf1, 0x65}, Chip8::Fault::address_out_of_range, 0x202},
+		{"FX33 past memory", {0xaf, 0xfe, 0xf0, 0x33}, Chip8::Fault::address_out_of_range, 0x202},
+		{"F002 past memory", {0xaf, 0xf8, 0xf0, 0x02}, Chip8::Fault::address_out_of_range, 0x202},
+		{"key past F", {0x60, 0x10, 0xe0, 0x9e}, Chip8::Fault::address_out_of_range, 0x202},
+		{"PC past memory", {0x60, 0xff, 0xbf, 0xff}, Chip8::Fault::address_out_of_range, 0x10fe},
+	};
+
+	for (const Case& test : cases)
+	{
+		SECTION(test.name)
+		{
+			Chip8 chip8(1);
+			chip8.load_bytes(test.program);
+			for (int i = 0; i < 100; ++i) chip8.step();
+
+			REQUIRE(chip8.get_fault() == test.fault);
+			REQUIRE(chip8.get_fault_address() == test.address);
+			REQUIRE(chip8.get_program_counter() == test.address);
+
+			// stepping a faulted machine does nothing
+			Chip8 faulted = chip8;
+			chip8.step();
+			REQUIRE(chip8.hash() == faulted.hash());
+		}
+	}
+
+	SECTION("Loading a state clears the fault")
+	{
+		Chip8 chip8(1);
+		Chip8::Snapshot snapshot;
+		chip8.save_state(snapshot);
+		chip8.load_bytes(std::array<uint8_t, 2>{0xff, 0xff});
+		chip8.step();
+		REQUIRE(chip8.get_fault() == Chip8::Fault::invalid_opcode);
+
+		chip8.load_state(snapshot);
+		REQUIRE(chip8.get_fault() == Chip8::Fault::none);
+	}
+}
@@ -0,0 +1,122 @@
+#include <array>
+#include <catch/catch.hpp>
+#include <cstring>
+#include <vector>
+#include "chip8env.h"
+
+/* draws a 0, then counts at 0x300 while key 0 is held:
+ * 6200 F229 D225 E19E 1206 A300 F065 7001 A300 F055 1206
+ */
+static const std::array<uint8_t, 22> counter{
+	0x62, 0x00, 0xf2, 0x29, 0xd2, 0x25, 0xe1, 0x9e, 0x12, 0x06, 0xa3,
+	0x00, 0xf0, 0x65, 0x70, 0x01, 0xa3, 0x00, 0xf0, 0x55, 0x12, 0x06};
+
+TEST_CASE("Environment batches step and reset", "[chip8env]")
+{
+	constexpr unsigned int count = 8;
+	chip8_env* env = chip8_env_create(counter.data(), counter.size(), count, 4, 1, CHIP8_ENV_OBSERVE_SCREEN | CHIP8_ENV_OBSERVE_RAM);
+	REQUIRE(env);
+	REQUIRE(chip8_env_count(env) == count);
+
+	// the arrays never move, so views taken now stay valid
+	const uint8_t* screens = chip8_env_screens(env);
+	const uint8_t* ram = chip8_env_ram(env);
+	const float* rewards = chip8_env_rewards(env);
+	const uint8_t* done = chip8_env_done(env);
+	REQUIRE(screens);
+	REQUIRE(ram[1 * CHIP8_ENV_RAM_SIZE + 0x200] == 0x62);
+
+	chip8_env_set_reward_address(env, 0x300);
+	chip8_env_set_terminal(env, 0x300, 20);
+
+	// even instances hold key 0
+	std::array<uint16_t, count> actions {};
+	for (unsigned int i = 0; i < count; i += 2) actions[i] = 1;
+
+	chip8_env_step_batch(env, actions.data(), 1);
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		INFO("instance " << i);
+		REQUIRE(screens[i * CHIP8_ENV_SCREEN_SIZE + 1] == 1); // the 0 is drawn
+		REQUIRE(screens[i * CHIP8_ENV_SCREEN_SIZE + CHIP8_ENV_SCREEN_SIZE - 1] == 0);
+		REQUIRE((rewards[i] > 0) == (i % 2 == 0));
+		REQUIRE(ram[i * CHIP8_ENV_RAM_SIZE + 0x300] == rewards[i]);
+		REQUIRE_FALSE(done[i]);
+	}
+
+	SECTION("episodes end and restart")
+	{
+		float total = rewards[0];
+		unsigned int steps = 1;
+		while (!done[0])
+		{
+			chip8_env_step_batch(env, actions.data(), 1);
+			total += rewards[0];
+			++steps;
+			REQUIRE(steps < 100);
+		}
+		REQUIRE(total + ram[0x300] >= 20);
+		REQUIRE_FALSE(done[1]);
+		REQUIRE_FALSE(chip8_env_faulted(env)[0]);
+
+		// automatically reset: back to the first state, nothing drawn yet
+		REQUIRE(ram[0x300] == 0);
+		REQUIRE(screens[1] == 0);
+	}
+
+	SECTION("without auto reset done instances wait")
+	{
+		chip8_env_set_auto_reset(env, 0);
+		while (!done[0]) chip8_env_step_batch(env, actions.data(), 1);
+		REQUIRE(ram[0x300] == 20);
+
+		chip8_env_step_batch(env, actions.data(), 5);
+		REQUIRE(done[0]);
+		REQUIRE(rewards[0] == 0);
+		REQUIRE(ram[0x300] == 20);
+
+		chip8_env_reset(env, 0);
+		REQUIRE_FALSE(done[0]);
+		REQUIRE(ram[0x300] == 0);
+	}
+
+	SECTION("frame limits and faults end episodes")
+	{
+		chip8_env_set_auto_reset(env, 0);
+		chip8_env_set_max_frames(env, 3);
+		chip8_env_step_batch(env, actions.data(), 10);
+		for (unsigned int i = 0; i < count; ++i) REQUIRE(done[i]);
+
+		const uint8_t bad[] = {0x00, 0x00};
+		chip8_env* faulty = chip8_env_create(bad, sizeof(bad), 2, 2, 1, 0);
+		REQUIRE(chip8_env_screens(faulty) == nullptr);
+		chip8_env_step_batch(faulty, actions.data(), 1);
+		REQUIRE(chip8_env_done(faulty)[1]);
+		REQUIRE(chip8_env_faulted(faulty)[1]);
+		chip8_env_destroy(faulty);
+	}
+
+	chip8_env_destroy(env);
+}
+
+TEST_CASE("Environment results don't depend on threads", "[chip8env]")
+{
+	std::vector<std::vector<uint8_t>> results;
+	for (unsigned int threads : {1, 3, 16})
+	{
+		chip8_env* env = chip8_env_create(counter.data(), counter.size(), 16, threads, 7, CHIP8_ENV_OBSERVE_RAM);
+		std::array<uint16_t, 16> actions {};
+		for (unsigned int step = 0; step < 20; ++step)
+		{
+			for (unsigned int i = 0; i < actions.size(); ++i) actions[i] = (step + i) % 3 == 0;
+			chip8_env_step_batch(env, actions.data(), 2);
+		}
+		const uint8_t* ram = chip8_env_ram(env);
+		results.emplace_back(ram, ram + 16 * CHIP8_ENV_RAM_SIZE);
+		chip8_env_destroy(env);
+	}
+	REQUIRE(results[0] == results[1]);
+	REQUIRE(results[0] == results[2]);
+
+	REQUIRE(chip8_env_create(counter.data(), 0x1000, 1, 1, 1, 0) == nullptr);
+}
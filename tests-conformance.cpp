@@ -0,0 +1,108 @@
+#include <array>
+#include <catch/catch.hpp>
+#include <fstream>
+#include <string>
+#include "chip8.hpp"
+#include "conformance.hpp"
+#include "engine.hpp"
+
+// draws the digit of the last key pressed, waiting for each key with FX0A
+static const std::array<uint8_t, 14> key_echo{
+	0xf0, 0x0a, // LD V0, K
+	0x00, 0xe0, // CLS
+	0xf0, 0x29, // LD F, V0
+	0xd1, 0x15, // DRW V1, V1, 5
+	0x12, 0x00, // JP 200
+	0, 0, 0, 0};
+
+static void write_file(const std::string& filename, const std::string& text)
+{
+	std::ofstream file(filename, std::ios::binary);
+	file << text;
+}
+
+static uint64_t digit_hash(uint8_t digit)
+{
+	Chip8 chip8;
+	chip8.set_memory(Chip8::program_mem_start, 0x60); // LD V0, digit
+	chip8.set_memory(Chip8::program_mem_start + 1, digit);
+	for (uint16_t i = 2; i < 8; ++i) chip8.set_memory(Chip8::program_mem_start + i, key_echo[i]);
+	for (int i = 0; i < 4; ++i) chip8.step();
+	return chip8.screen_hash();
+}
+
+TEST_CASE("Conformance manifests", "[conformance]")
+{
+	write_file("/tmp/tests-conformance.ch8", std::string(key_echo.begin(), key_echo.end()));
+
+	std::string manifest = "/tmp/tests-conformance.txt";
+	char seven[17];
+	std::snprintf(seven, sizeof(seven), "%016llx", static_cast<unsigned long long>(digit_hash(7)));
+	write_file(manifest,
+		"# echo keys\n"
+		"test tests-conformance.ch8\n"
+		"frames 20\n"
+		"press 2 7\n"
+		"release 3 7\n"
+		"hash 5 " + std::string(seven) + " # seven\n"
+		"press 10 a\n"
+		"hash 12 -\n");
+
+	std::vector<ConformanceCase> cases;
+	std::string error;
+	REQUIRE(read_manifest(manifest, cases, error));
+	REQUIRE(cases.size() == 1);
+	REQUIRE(cases[0].rom == "/tmp/tests-conformance.ch8");
+	REQUIRE(cases[0].frames == 20);
+	REQUIRE(cases[0].inputs.size() == 3);
+	REQUIRE(cases[0].checks.size() == 2);
+	REQUIRE_FALSE(cases[0].checks[1].known);
+
+	SECTION("every engine passes")
+	{
+		for (const std::string& name : engine_names())
+		{
+			auto engine = make_engine(name);
+			ConformanceResult result = run_case(cases[0], *engine);
+			INFO(name << ": " << result.message);
+			REQUIRE(result.passed);
+			REQUIRE(result.hashes.size() == 2);
+			REQUIRE(result.hashes[1] == digit_hash(0xa));
+		}
+	}
+
+	SECTION("wrong hashes fail")
+	{
+		cases[0].checks[0].hash ^= 1;
+		ReferenceEngine engine;
+		ConformanceResult result = run_case(cases[0], engine);
+		REQUIRE_FALSE(result.passed);
+		REQUIRE(result.message.find("frame 5") == 0);
+	}
+
+	SECTION("recording fills in hashes")
+	{
+		ReferenceEngine engine;
+		std::vector<ConformanceResult> results{run_case(cases[0], engine)};
+		REQUIRE(record_manifest(manifest, cases, results));
+
+		std::vector<ConformanceCase> recorded;
+		REQUIRE(read_manifest(manifest, recorded, error));
+		REQUIRE(recorded[0].checks[0].hash == digit_hash(7));
+		REQUIRE(recorded[0].checks[1].known);
+		REQUIRE(recorded[0].checks[1].hash == digit_hash(0xa));
+
+		std::ifstream file(manifest);
+		std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		REQUIRE(text.find("# echo keys\n") == 0);
+		REQUIRE(text.find(" # seven\n") != std::string::npos);
+	}
+
+	SECTION("bad manifests name the line")
+	{
+		write_file(manifest, "test a.ch8\nhash 5 xyz\n");
+		std::vector<ConformanceCase> bad;
+		REQUIRE_FALSE(read_manifest(manifest, bad, error));
+		REQUIRE(error == manifest + ":2: bad hash xyz");
+	}
+}
@@ -0,0 +1,63 @@
+#include <array>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+
+/* These run entirely at compile time: if the core stops being usable in
+ * constant evaluation, this file stops compiling.
+ */
+
+template<size_t SIZE>
+constexpr Chip8 run(const std::array<uint8_t, SIZE>& program, uint64_t steps)
+{
+	return Chip8::boot(program, steps);
+}
+
+// decoding
+static_assert(std::get<0>(Chip8::decode_opcode(0x00e0)) == &Chip8::op_clear, "00E0 decodes to clear");
+static_assert(std::get<1>(Chip8::decode_opcode(0xd2eb)) == 0xb, "DXYN decodes N");
+static_assert(std::get<0>(Chip8::decode_opcode(0x5243)) == nullptr, "5XY3 is invalid");
+
+// arithmetic and flags: 60FF 6102 8014, V0 = 0xff + 2
+constexpr Chip8 added = run(std::array<uint8_t, 6>{0x60, 0xff, 0x61, 0x02, 0x80, 0x14}, 3);
+static_assert(added.get_register(0) == 0x01, "8XY4 wraps");
+static_assert(added.get_register(0xf) == 1, "8XY4 sets the carry");
+
+// BCD into memory: 60 7B A3 00 F0 33
+constexpr Chip8 decimal = run(std::array<uint8_t, 6>{0x60, 0x7b, 0xa3, 0x00, 0xf0, 0x33}, 3);
+static_assert(decimal.get_memory(0x300) == 1 && decimal.get_memory(0x301) == 2 && decimal.get_memory(0x302) == 3, "FX33 writes 123");
+
+// calls and returns: 2206 1204 0000 00EE
+constexpr Chip8 called = run(std::array<uint8_t, 8>{0x22, 0x06, 0x12, 0x04, 0x00, 0x00, 0x00, 0xee}, 1);
+static_assert(called.get_stack_depth() == 1 && called.get_program_counter() == 0x206, "2NNN pushes");
+static_assert(run(std::array<uint8_t, 8>{0x22, 0x06, 0x12, 0x04, 0x00, 0x00, 0x00, 0xee}, 3).get_program_counter() == 0x204, "00EE returns");
+
+// drawing the font: 6007 F029 D115 draws a 7 in the corner
+constexpr Chip8 drawn = run(std::array<uint8_t, 6>{0x60, 0x07, 0xf0, 0x29, 0xd1, 0x15}, 3);
+static_assert(drawn.get_pixel(0, 0) && drawn.get_pixel(3, 0) && !drawn.get_pixel(0, 1) && drawn.get_pixel(3, 1), "DXYN draws the font");
+
+// random numbers are deterministic for a seed: C0FF C1FF
+constexpr Chip8 randomised = run(std::array<uint8_t, 4>{0xc0, 0xff, 0xc1, 0xff}, 2);
+static_assert(randomised.get_register(0) != randomised.get_register(1), "CXNN gives different numbers");
+
+/* a boot sequence baked at compile time: clear, set up a counter and draw
+ * a title, then wait for a key. 00E0 6A00 6B00 6C05 A050 DAB5 F00A
+ */
+static constexpr std::array<uint8_t, 14> title_rom{0x00, 0xe0, 0x6a, 0x00, 0x6b, 0x00, 0x6c, 0x05, 0xa0, 0x50, 0xda, 0xb5, 0xf0, 0x0a};
+static constexpr Chip8 title_screen = Chip8::boot(title_rom, 7);
+static_assert(title_screen.is_waiting(), "the boot sequence ran to the key wait");
+
+TEST_CASE("Machines can start from a baked boot state", "[constexpr]")
+{
+	Chip8 booted;
+	booted.load_bytes(title_rom);
+	for (int i = 0; i < 7; ++i) booted.step();
+
+	// same state as running the boot code at runtime, without running it
+	Chip8 baked = title_screen;
+	REQUIRE(baked.hash() == booted.hash());
+	REQUIRE(baked.get_pixel(1, 0));
+
+	baked.press(3);
+	REQUIRE_FALSE(baked.is_waiting());
+	REQUIRE(baked.get_register(0) == 3);
+}
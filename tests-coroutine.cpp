@@ -0,0 +1,126 @@
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "coroutine.hpp"
+#include "engine.hpp"
+#include "fused.hpp"
+
+// only built as C++20, e.g. make STD=c++20
+#ifdef __cpp_impl_coroutine
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+	++allocations;
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+TEST_CASE("Tasks suspend at the end of each frame", "[coroutine]")
+{
+	Chip8 chip8(1);
+	// 7001 1200: counts forever
+	chip8.load_bytes(std::array<uint8_t, 4>{0x70, 0x01, 0x12, 0x00});
+	ReferenceEngine engine;
+	Chip8Task task = run_task(chip8, engine, 16);
+	REQUIRE(chip8.get_register(0) == 0); // nothing runs before the first resume
+
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::frame);
+	REQUIRE(task.should_draw()); // a fresh machine wants its screen drawn
+	REQUIRE(chip8.get_register(0) == 8);
+
+	// suspending and resuming doesn't allocate
+	size_t before = allocations;
+	for (int frame = 0; frame < 100; ++frame) REQUIRE(task.resume());
+	REQUIRE(allocations == before);
+	REQUIRE(chip8.get_register(0) == static_cast<uint8_t>(808));
+	REQUIRE_FALSE(task.should_draw());
+}
+
+TEST_CASE("Tasks suspend when their budget runs out", "[coroutine]")
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 4>{0x70, 0x01, 0x12, 0x00});
+	FusedEngine engine;
+	Chip8Task task = run_task(chip8, engine, 16, 6);
+
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::budget);
+	REQUIRE(chip8.get_register(0) == 3);
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::budget);
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::frame);
+	REQUIRE(chip8.get_register(0) == 8);
+
+	// the budget starts over with each frame
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::budget);
+	REQUIRE(chip8.get_register(0) == 11);
+}
+
+TEST_CASE("Tasks suspend while waiting for a key", "[coroutine]")
+{
+	Chip8 chip8(1);
+	// F20A 1202: wait for a key, then spin
+	chip8.load_bytes(std::array<uint8_t, 4>{0xf2, 0x0a, 0x12, 0x02});
+	ReferenceEngine engine;
+	Chip8Task task = run_task(chip8, engine, 16);
+
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::key_wait);
+	chip8.press(5);
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::frame);
+	REQUIRE(chip8.get_register(2) == 5);
+}
+
+TEST_CASE("Tasks end on faults", "[coroutine]")
+{
+	Chip8 chip8(1);
+	// 6001 0000: an invalid instruction after one good one
+	chip8.load_bytes(std::array<uint8_t, 4>{0x60, 0x01, 0x00, 0x00});
+	ReferenceEngine engine;
+	Chip8Task task = run_task(chip8, engine, 16, 1);
+
+	REQUIRE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::budget);
+	REQUIRE_FALSE(task.resume());
+	REQUIRE(task.reason() == Chip8Task::fault);
+	REQUIRE(task.done());
+	REQUIRE_FALSE(task.resume());
+}
+
+TEST_CASE("Tasks with VIP timing run a frame's cycles", "[coroutine]")
+{
+	Chip8 chip8(1);
+	// F00A 1202: waiting lets frames pass with VIP timing
+	chip8.load_bytes(std::array<uint8_t, 4>{0xf0, 0x0a, 0x12, 0x02});
+	chip8.set_timing(Chip8::Timing::vip);
+	ReferenceEngine engine;
+	Chip8Task task = run_task(chip8, engine, 16);
+
+	for (uint64_t frame = 1; frame <= 3; ++frame)
+	{
+		REQUIRE(task.resume());
+		REQUIRE(task.reason() == Chip8Task::frame);
+		REQUIRE(chip8.get_cycles() >= frame * Chip8::vip_frame_cycles);
+		REQUIRE(chip8.get_cycles() < (frame + 1) * Chip8::vip_frame_cycles);
+	}
+}
+
+#endif
@@ -0,0 +1,246 @@
+#include <array>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "debugger.hpp"
+#include "engine.hpp"
+#include "fused.hpp"
+
+static const std::array<uint8_t, 22> program{
+	0x60, 0x05, // 200 LD V0, 5
+	0xa3, 0x00, // 202 LD I, 300
+	0xf0, 0x33, // 204 LD B, V0
+	0x22, 0x10, // 206 CALL 210
+	0x75, 0x01, // 208 ADD V5, 1
+	0x12, 0x06, // 20A JP 206
+	0, 0, 0, 0,
+	0x62, 0x04, // 210 LD V2, 4
+	0xf2, 0x65, // 212 LD V2, [I]
+	0x00, 0xee}; // 214 RET
+
+TEST_CASE("Debugger stops where asked", "[debugger]")
+{
+	Chip8 chip8;
+	chip8.load_bytes(program);
+	Debugger debugger;
+	FusedEngine engine;
+
+	SECTION("nothing armed runs the engine")
+	{
+		REQUIRE_FALSE(debugger.armed());
+		DebugStop stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::none);
+		REQUIRE(stop.steps == 1000);
+	}
+
+	SECTION("breakpoints")
+	{
+		debugger.set_breakpoint(0x210);
+		REQUIRE(debugger.armed());
+		DebugStop stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::breakpoint);
+		REQUIRE(stop.address == 0x210);
+		REQUIRE(stop.steps == 4);
+		REQUIRE(chip8.get_program_counter() == 0x210);
+
+		// continuing runs the loop once more to the same place
+		stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::breakpoint);
+		REQUIRE(stop.steps == 6);
+		REQUIRE(chip8.get_register(5) == 1);
+
+		debugger.clear_breakpoint(0x210);
+		REQUIRE_FALSE(debugger.armed());
+	}
+
+	SECTION("watchpoints")
+	{
+		debugger.watch(0x301, 1, false, true);
+		DebugStop stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::write);
+		REQUIRE(stop.address == 0x301);
+		REQUIRE(chip8.get_program_counter() == 0x206); // just after the write
+		REQUIRE(chip8.get_memory(0x302) == 5);
+
+		// reads but not writes
+		debugger.unwatch(0x301, 1);
+		debugger.watch(0x302, 1, true, false);
+		stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::read);
+		REQUIRE(stop.address == 0x302);
+		REQUIRE(chip8.get_program_counter() == 0x214);
+
+		// F002 reads the 16 byte audio pattern
+		Chip8 audio;
+		audio.load_bytes(std::array<uint8_t, 6>{
+			0xa3, 0x00, // 200 LD I, 300
+			0xf0, 0x02, // 202 LD AUDIO, [I]
+			0x12, 0x04}); // 204 JP 204
+		debugger.unwatch(0x302, 1);
+		debugger.watch(0x30f, 1, true, false);
+		stop = debugger.run(audio, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::read);
+		REQUIRE(stop.address == 0x30f);
+		REQUIRE(audio.get_program_counter() == 0x204);
+	}
+
+	SECTION("register conditions")
+	{
+		debugger.watch_register(5, 3);
+		DebugStop stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::register_changed);
+		REQUIRE(stop.address == 5);
+		REQUIRE(chip8.get_register(5) == 3);
+
+		// V2 is 5 after each call, the next LD V2, 4 changes it
+
+		debugger.watch_register(2);
+		stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::register_changed);
+		REQUIRE(stop.address == 2);
+		REQUIRE(chip8.get_program_counter() == 0x212);
+	}
+
+	SECTION("stepping")
+	{
+		debugger.step();
+		DebugStop stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::step);
+		REQUIRE(stop.steps == 1);
+		REQUIRE_FALSE(debugger.armed());
+
+		// over the call
+		debugger.run(chip8, engine, 2);
+		REQUIRE(chip8.get_program_counter() == 0x206);
+		debugger.step_over(chip8);
+		stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::step);
+		REQUIRE(stop.steps == 4);
+		REQUIRE(chip8.get_program_counter() == 0x208);
+
+		// into it and back out
+		debugger.run(chip8, engine, 4);
+		REQUIRE(chip8.get_program_counter() == 0x212);
+		debugger.step_out(chip8);
+		stop = debugger.run(chip8, engine, 1000);
+		REQUIRE(stop.reason == DebugStop::step);
+		REQUIRE(stop.steps == 2);
+		REQUIRE(chip8.get_program_counter() == 0x208);
+		REQUIRE(chip8.get_stack_depth() == 0);
+	}
+}
+
+TEST_CASE("Debugger stops count the instructions that ran", "[debugger]")
+{
+	ReferenceEngine reference;
+	FusedEngine fused;
+	for (Engine* engine : {static_cast<Engine*>(&reference), static_cast<Engine*>(&fused)})
+	{
+		for (bool armed : {false, true})
+		{
+			Debugger debugger;
+			if (armed) debugger.set_breakpoint(0xffe);
+
+			// the faulting instruction counts, the rest of the batch doesn't
+			Chip8 faulting;
+			faulting.load_bytes(std::array<uint8_t, 6>{0x60, 0x01, 0x70, 0x01, 0xff, 0xff});
+			DebugStop stop = debugger.run(faulting, *engine, 100);
+			REQUIRE(stop.reason == DebugStop::fault);
+			REQUIRE(stop.steps == 3);
+			stop = debugger.run(faulting, *engine, 100);
+			REQUIRE(stop.steps == 0);
+
+			// neither do steps waiting for a key
+			Chip8 waiting;
+			waiting.load_bytes(std::array<uint8_t, 4>{0x60, 0x01, 0xf1, 0x0a});
+			stop = debugger.run(waiting, *engine, 100);
+			REQUIRE(stop.reason == DebugStop::none);
+			REQUIRE(stop.steps == 2);
+		}
+	}
+}
+
+TEST_CASE("Breakpoints are hit across batches", "[debugger]")
+{
+	// 200 ADD V0, 1; 202 ADD V1, 1; 204 JP 200
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 6>{0x70, 0x01, 0x71, 0x01, 0x12, 0x00});
+	Debugger debugger;
+	ReferenceEngine engine;
+	debugger.set_breakpoint(0x200);
+
+	// batches that end right before the breakpoint, as frames do
+	unsigned int hits = 0;
+	for (int call = 0; call < 10; ++call)
+	{
+		DebugStop stop = debugger.run(chip8, engine, 3);
+		if (stop.reason == DebugStop::breakpoint) ++hits;
+	}
+	// once before every pass through the loop, each call after a hit runs one
+	REQUIRE(chip8.get_program_counter() == 0x200);
+	REQUIRE(hits == chip8.get_register(0));
+	REQUIRE(hits == 5);
+}
+
+TEST_CASE("Watchpoints ignore a machine waiting for a key", "[debugger]")
+{
+	// 200 LD I, 300; 202 LD V0, K; 204 LD [I], V0
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 6>{0xa3, 0x00, 0xf0, 0x0a, 0xf0, 0x55});
+	Debugger debugger;
+	ReferenceEngine engine;
+	debugger.watch(0x300, 1, false, true);
+
+	for (int call = 0; call < 10; ++call)
+	{
+		DebugStop stop = debugger.run(chip8, engine, 16);
+		REQUIRE(stop.reason == DebugStop::none);
+	}
+	REQUIRE(chip8.is_waiting());
+
+	// stepping waits for an instruction that actually runs
+	debugger.step();
+	REQUIRE(debugger.run(chip8, engine, 16).reason == DebugStop::none);
+
+	chip8.press(7);
+	DebugStop stop = debugger.run(chip8, engine, 16);
+	REQUIRE(stop.reason == DebugStop::write);
+	REQUIRE(stop.steps == 1);
+	REQUIRE(chip8.get_memory(0x300) == 7);
+}
+
+TEST_CASE("The debugger stops VIP frames where asked", "[debugger]")
+{
+	// 200 ADD V0, 1; 202 ADD V1, 1; 204 JP 200
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 6>{0x70, 0x01, 0x71, 0x01, 0x12, 0x00});
+	chip8.set_timing(Chip8::Timing::vip);
+	Chip8 reference = chip8;
+	Debugger debugger;
+	ReferenceEngine engine;
+
+	// nothing armed, a frame is what the engine runs up to the display interrupt
+	DebugStop stop = debugger.run_until(chip8, engine, chip8.next_frame_cycles());
+	REQUIRE(stop.reason == DebugStop::none);
+	REQUIRE(engine.run_frame(reference, 16) == Chip8::Fault::none);
+	REQUIRE(chip8.hash() == reference.hash());
+	REQUIRE(chip8.get_cycles() >= Chip8::vip_frame_cycles);
+	REQUIRE(stop.steps > 0);
+
+	// a breakpoint stops the frame early, and the rest of the frame carries on from there
+	debugger.set_breakpoint(0x202);
+	unsigned int hits = 0;
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		uint64_t end = chip8.next_frame_cycles();
+		while (chip8.get_cycles() < end)
+		{
+			stop = debugger.run_until(chip8, engine, end);
+			if (stop.reason == DebugStop::none) continue;
+			REQUIRE(stop.reason == DebugStop::breakpoint);
+			REQUIRE(chip8.get_program_counter() == 0x202);
+			++hits;
+		}
+	}
+	REQUIRE(hits == static_cast<unsigned int>(chip8.get_register(1) - reference.get_register(1) + (chip8.get_program_counter() == 0x202)));
+	REQUIRE(hits > 10);
+}
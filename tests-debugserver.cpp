@@ -0,0 +1,183 @@
+#include <array>
+#include <catch/catch.hpp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "chip8.hpp"
+#include "debugger.hpp"
+#include "debugserver.hpp"
+#include "engine.hpp"
+
+// a minimal client: frames packets and reads one reply, after skipping the acknowledgement
+class Client
+{
+	int fd;
+public:
+	explicit Client(const std::string& path)
+	{
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		std::strcpy(address.sun_path, path.c_str());
+		connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	}
+	~Client() { close(fd); }
+
+	void send_raw(const std::string& data) { ::send(fd, data.data(), data.size(), 0); }
+
+	void send(const std::string& packet)
+	{
+		unsigned int checksum = 0;
+		for (char c : packet) checksum += static_cast<uint8_t>(c);
+		char tail[4];
+		std::snprintf(tail, sizeof(tail), "#%02x", checksum & 0xff);
+		send_raw("$" + packet + tail);
+	}
+
+	std::string receive()
+	{
+		std::string data;
+		char c;
+		while (recv(fd, &c, 1, 0) == 1 && c != '$');
+		while (recv(fd, &c, 1, 0) == 1 && c != '#') data += c;
+		recv(fd, &c, 1, 0);
+		recv(fd, &c, 1, 0);
+		return data;
+	}
+};
+
+TEST_CASE("Debug server speaks the remote protocol", "[debugserver]")
+{
+	const std::string path = "/tmp/tests-debugserver.sock";
+	DebugServer server(path);
+	REQUIRE(server.is_listening());
+
+	// 6005 7001 1202: V0 = 5, then count up forever
+	Chip8 chip8;
+	chip8.load_bytes(std::array<uint8_t, 6>{0x60, 0x05, 0x70, 0x01, 0x12, 0x02});
+	Debugger debugger;
+	ReferenceEngine engine;
+
+	// nobody attached, nothing changes
+	server.poll(chip8, debugger);
+	REQUIRE_FALSE(server.is_attached());
+	REQUIRE_FALSE(server.is_halted());
+	debugger.run(chip8, engine, 3);
+
+	Client client(path);
+	auto request = [&](const std::string& packet)
+	{
+		client.send(packet);
+		server.poll(chip8, debugger);
+		return client.receive();
+	};
+
+	REQUIRE(request("?") == "S05");
+	REQUIRE(server.is_attached());
+	REQUIRE(server.is_halted());
+
+	SECTION("registers")
+	{
+		std::string registers = request("g");
+		REQUIRE(registers.size() == 46);
+		REQUIRE(registers.substr(0, 2) == "06");
+		REQUIRE(registers.substr(32, 8) == "00020202"); // I and PC, both 200, little endian
+
+		registers.replace(2, 2, "2a");
+		REQUIRE(request("G" + registers) == "OK");
+		REQUIRE(chip8.get_register(1) == 0x2a);
+		REQUIRE(request("G12") == "E01");
+	}
+
+	SECTION("memory")
+	{
+		REQUIRE(request("m200,6") == "600570011202");
+		REQUIRE(request("M300,2:beef") == "OK");
+		REQUIRE(chip8.get_memory(0x301) == 0xef);
+		REQUIRE(request("mfff,2") == "E01");
+	}
+
+	SECTION("breakpoints and stepping")
+	{
+		REQUIRE(request("Z0,204,2") == "OK");
+		client.send("c");
+		server.poll(chip8, debugger);
+		REQUIRE_FALSE(server.is_halted());
+
+		DebugStop stop = debugger.run(chip8, engine, 100);
+		REQUIRE(stop.reason == DebugStop::breakpoint);
+		server.stopped(stop);
+		REQUIRE(client.receive() == "T05swbreak:;");
+		REQUIRE(server.is_halted());
+
+		REQUIRE(request("z0,204,2") == "OK");
+		client.send("s");
+		server.poll(chip8, debugger);
+		server.stopped(debugger.run(chip8, engine, 100));
+		REQUIRE(client.receive() == "S05");
+		REQUIRE(chip8.get_program_counter() == 0x202);
+	}
+
+	SECTION("snapshots")
+	{
+		REQUIRE(request("qSnapshot:load") == "E02");
+		REQUIRE(request("qSnapshot:save") == "OK");
+		uint64_t hash = chip8.hash();
+		chip8.step();
+		REQUIRE(request("qSnapshot:load") == "OK");
+		REQUIRE(chip8.hash() == hash);
+	}
+
+	SECTION("interrupt and unknown packets")
+	{
+		client.send("c");
+		server.poll(chip8, debugger);
+		client.send_raw("\x03");
+		server.poll(chip8, debugger);
+		REQUIRE(client.receive() == "S02");
+		REQUIRE(request("vMustReplyEmpty") == "");
+	}
+
+	SECTION("replies wait for a client that is slow to read")
+	{
+		// each reply is 8 KB, far more than the socket holds in total
+		const int replies = 64;
+		for (int i = 0; i < replies; ++i)
+		{
+			client.send("m0,1000");
+			server.poll(chip8, debugger);
+		}
+		REQUIRE(server.is_attached());
+
+		// they arrive whole and in order as the client catches up
+		for (int i = 0; i < replies; ++i)
+		{
+			server.poll(chip8, debugger);
+			std::string memory = client.receive();
+			REQUIRE(memory.size() == 2 * Chip8::memory_size);
+			REQUIRE(memory.substr(2 * Chip8::program_mem_start, 4) == "6005");
+		}
+		REQUIRE(request("?") == "S05");
+
+		// one that doesn't read at all is dropped
+		for (int i = 0; i < 1000 && server.is_attached(); ++i)
+		{
+			client.send("m0,1000");
+			server.poll(chip8, debugger);
+		}
+		REQUIRE_FALSE(server.is_attached());
+		REQUIRE_FALSE(server.is_halted());
+	}
+
+	SECTION("detaching resumes the machine")
+	{
+		REQUIRE(request("Z0,204,2") == "OK");
+		REQUIRE(request("D") == "OK");
+		REQUIRE_FALSE(server.is_attached());
+		REQUIRE_FALSE(server.is_halted());
+		REQUIRE_FALSE(debugger.armed());
+	}
+}
@@ -0,0 +1,132 @@
+#include <array>
+#include <thread>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "explorer.hpp"
+
+// waits for keys 1 then 2, starting over on anything else, then writes 1 to 0x301
+static const std::array<uint8_t, 20> combination_lock = {
+	0xf0, 0x0a, // 200: LD V0, K
+	0x30, 0x01, // 202: SE V0, 1
+	0x12, 0x00, // 204: JP 200
+	0xf0, 0x0a, // 206: LD V0, K
+	0x30, 0x02, // 208: SE V0, 2
+	0x12, 0x00, // 20A: JP 200
+	0x61, 0x01, // 20C: LD V1, 1
+	0xa3, 0x00, // 20E: LD I, 300
+	0xf1, 0x55, // 210: LD [I], V1
+	0x12, 0x12, // 212: JP 212
+};
+
+static bool unlocked(const Chip8& chip8)
+{
+	return chip8.get_memory(0x301) == 1;
+}
+
+TEST_CASE("State tables deduplicate hashes from many threads", "[explorer]")
+{
+	StateTable table(1000);
+	REQUIRE(table.capacity() >= 1000);
+	REQUIRE(table.insert(0));
+	REQUIRE_FALSE(table.insert(0));
+	REQUIRE(table.contains(0));
+	REQUIRE_FALSE(table.contains(5));
+
+	// every thread inserts every hash, each hash must be new exactly once
+	std::atomic<unsigned int> new_hashes {0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&]()
+		{
+			for (uint64_t hash = 1; hash <= 400; ++hash) new_hashes += table.insert(hash * 0x9e3779b97f4a7c15);
+		});
+	}
+	for (std::thread& thread : threads) thread.join();
+	REQUIRE(new_hashes == 400);
+	REQUIRE(table.size() == 401);
+}
+
+TEST_CASE("The explorer finds the shortest key sequence", "[explorer]")
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(combination_lock);
+
+	Explorer::Options options;
+	options.max_depth = 5;
+
+	for (unsigned int threads : {1u, 4u})
+	{
+		options.threads = threads;
+		Explorer explorer(chip8, options);
+		Explorer::Result result = explorer.search(unlocked);
+
+		// the first decision only gets the lock to its first wait, whatever key is held
+		REQUIRE(result.solutions.size() == 1);
+		REQUIRE(result.solutions[0] == std::vector<uint8_t>{0, 1, 2});
+		REQUIRE(result.depth == 3);
+		REQUIRE(unlocked(explorer.replay(result.solutions[0])));
+		REQUIRE_FALSE(unlocked(explorer.replay({0, 1, 3})));
+
+		// the start, the first wait with each key in V0, the second wait and the open lock
+		REQUIRE(result.states == 3 + Chip8::registers_size);
+		// states are stored as deltas, far smaller than snapshots
+		REQUIRE(result.state_bytes / result.states < sizeof(Chip8::Snapshot) / 10);
+	}
+}
+
+TEST_CASE("The explorer stops when every state was seen", "[explorer]")
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(combination_lock);
+
+	Explorer::Options options;
+	options.threads = 2;
+	options.max_depth = 100;
+	Explorer explorer(chip8, options);
+	Explorer::Result result = explorer.search([](const Chip8& state) { return state.get_memory(0x301) == 2; });
+
+	REQUIRE(result.solutions.empty());
+	REQUIRE(result.exhausted);
+	REQUIRE(result.depth < 10);
+}
+
+TEST_CASE("Beam search keeps the best scoring states", "[explorer]")
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(combination_lock);
+
+	Explorer::Options options;
+	options.threads = 2;
+	options.beam_width = 1;
+	options.max_depth = 5;
+	Explorer explorer(chip8, options);
+
+	// the further through the program, the better
+	Explorer::Result result = explorer.search(unlocked, [](const Chip8& state) { return state.get_program_counter(); });
+	REQUIRE(result.solutions.size() == 1);
+	REQUIRE(unlocked(explorer.replay(result.solutions[0])));
+	REQUIRE(result.states <= 1 + result.depth);
+}
+
+TEST_CASE("The explorer drops faulting inputs and respects its limits", "[explorer]")
+{
+	// pressing F crashes on an invalid opcode, the other keys keep waiting
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 8>{0xf0, 0x0a, 0x30, 0x0f, 0x12, 0x00, 0xff, 0xff});
+
+	Explorer::Options options;
+	options.threads = 1;
+	options.max_depth = 3;
+	Explorer explorer(chip8, options);
+	Explorer::Result result = explorer.search([](const Chip8& state) { return state.get_fault() != Chip8::Fault::none; });
+	REQUIRE(result.solutions.empty());
+	REQUIRE(result.exhausted);
+
+	options.max_states = 3;
+	Explorer limited(chip8, options);
+	result = limited.search([](const Chip8&) { return false; });
+	REQUIRE(result.truncated);
+	REQUIRE(result.states == 3);
+}
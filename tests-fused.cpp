@@ -0,0 +1,57 @@
+#include <array>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "engine.hpp"
+#include "fused.hpp"
+#include "lockstep.hpp"
+
+TEST_CASE("Fused engine matches the reference", "[fused]")
+{
+	ReferenceEngine reference;
+	FusedEngine fused;
+	Chip8 chip8(1);
+
+	SECTION("register setup and draws")
+	{
+		// 6005 610A A050 D015 7001 1202
+		chip8.load_bytes(std::array<uint8_t, 12>{0x60, 0x05, 0x61, 0x0a, 0xa0, 0x50, 0xd0, 0x15, 0x70, 0x01, 0x12, 0x02});
+	}
+
+	SECTION("counted loops")
+	{
+		// 6300 7301 3340 1202 1200: count V3 up to 0x40, then start over
+		chip8.load_bytes(std::array<uint8_t, 10>{0x63, 0x00, 0x73, 0x01, 0x33, 0x40, 0x12, 0x02, 0x12, 0x00});
+	}
+
+	SECTION("timer waits")
+	{
+		// 6A20 FA15 F507 3500 1204 F918 1200: wait for the delay timer, beep, repeat
+		chip8.load_bytes(std::array<uint8_t, 14>{0x6a, 0x20, 0xfa, 0x15, 0xf5, 0x07, 0x35, 0x00, 0x12, 0x04, 0xf9, 0x18, 0x12, 0x00});
+	}
+
+	SECTION("self modifying code")
+	{
+		// 6012 6108 A20A F155 7201 1200: overwrite the jump at 0x20A with 1208, then count in V2
+		chip8.load_bytes(std::array<uint8_t, 12>{0x60, 0x12, 0x61, 0x08, 0xa2, 0x0a, 0xf1, 0x55, 0x72, 0x01, 0x12, 0x00});
+	}
+
+	// odd intervals make sure sequences get split at run boundaries too
+	for (uint64_t interval : {1, 2, 5, 1000})
+	{
+		Lockstep lockstep(reference, fused, interval);
+		LockstepResult result = lockstep.run(chip8, 20000, 1);
+		REQUIRE(!result.diverged);
+		REQUIRE(result.steps == 20000);
+	}
+}
+
+TEST_CASE("Fused engine reduces dispatches", "[fused]")
+{
+	FusedEngine fused;
+	Chip8 chip8(1);
+
+	// 6A20 FA15 F507 3500 1204 1200: wait for the delay timer in a loop
+	chip8.load_bytes(std::array<uint8_t, 12>{0x6a, 0x20, 0xfa, 0x15, 0xf5, 0x07, 0x35, 0x00, 0x12, 0x04, 0x12, 0x00});
+	fused.run(chip8, 3000);
+	REQUIRE(fused.get_dispatches() < 3000 / 5);
+}
@@ -0,0 +1,59 @@
+#include <array>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "fuzzer.hpp"
+
+TEST_CASE("Restoring copies back written memory", "[fuzzer]")
+{
+	Chip8 golden(1);
+	// 6A07 A900 FA55 F029 D005 1200: write registers high in memory and draw
+	golden.load_bytes(std::array<uint8_t, 12>{0x6a, 0x07, 0xa9, 0x00, 0xfa, 0x55, 0xf0, 0x29, 0xd0, 0x05, 0x12, 0x00});
+
+	Chip8 machine = golden;
+	machine.restore(golden);
+	for (int i = 0; i < 10; ++i) machine.step();
+	machine.press(3);
+	REQUIRE(machine.hash() != golden.hash());
+	REQUIRE(machine.get_memory(0x90a) == 7);
+
+	machine.restore(golden);
+	REQUIRE(machine.hash() == golden.hash());
+	REQUIRE(machine.get_memory(0x90a) == 0);
+
+	// patching memory is undone too
+	machine.set_memory(0xfff, 1);
+	machine.restore(golden);
+	REQUIRE(machine.hash() == golden.hash());
+}
+
+TEST_CASE("Fuzzer reports crashes and coverage", "[fuzzer]")
+{
+	Chip8 golden(1);
+	// F00A 3005 1200 00EE: wait for a key, return from nowhere if it was 5
+	golden.load_bytes(std::array<uint8_t, 8>{0xf0, 0x0a, 0x30, 0x05, 0x12, 0x00, 0x00, 0xee});
+	Fuzzer fuzzer(golden, 1000);
+
+	FuzzResult result = fuzzer.run_input({});
+	REQUIRE(result.crash == Crash::none);
+	REQUIRE(result.new_coverage > 0);
+	REQUIRE(fuzzer.run_input({}).new_coverage == 0);
+
+	result = fuzzer.run_input({0x34});
+	REQUIRE(result.crash == Crash::none);
+	REQUIRE(result.new_coverage > 0);
+
+	result = fuzzer.run_input({0x35});
+	REQUIRE(result.crash == Crash::stack_underflow);
+	REQUIRE(result.program_counter == 0x206);
+
+	SECTION("programs can be fuzzed too")
+	{
+		REQUIRE(fuzzer.run_program({0xff, 0xff}).crash == Crash::invalid_opcode);
+		REQUIRE(fuzzer.run_program({0x22, 0x00}).crash == Crash::stack_overflow);
+		REQUIRE(fuzzer.run_program({0xaf, 0xff, 0xf1, 0x65}).crash == Crash::address_out_of_range);
+
+		// and the original program is back afterwards
+		REQUIRE(fuzzer.run_input({0x35}).crash == Crash::stack_underflow);
+	}
+}
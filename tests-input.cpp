@@ -0,0 +1,94 @@
+#include <array>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "input.hpp"
+
+// counts in V1 the times key 0 is held when checked
+static const std::array<uint8_t, 6> program{
+	0xe0, 0xa1, // 200 SKNP V0
+	0x71, 0x01, // 202 ADD V1, 1
+	0x12, 0x00}; // 204 JP 200
+
+// one frame the way the frontend runs it
+static void run_frame(Chip8& chip8, InputQueue& queue, unsigned int steps)
+{
+	for (unsigned int step = 0; step < steps;)
+	{
+		unsigned int next = queue.apply(chip8, step);
+		for (; step < next; ++step) chip8.step();
+	}
+}
+
+TEST_CASE("Keymaps bind host codes to keys", "[input]")
+{
+	Keymap keymap;
+	REQUIRE(keymap.lookup(Keymap::keyboard, 4) == -1);
+	REQUIRE(keymap.lookup(Keymap::keyboard, Keymap::codes) == -1);
+
+	keymap.bind(Keymap::keyboard, 4, 0x7);
+	keymap.bind(Keymap::gamepad, 13, 0x7);
+	REQUIRE(keymap.lookup(Keymap::keyboard, 4) == 0x7);
+	REQUIRE(keymap.lookup(Keymap::gamepad, 13) == 0x7);
+	REQUIRE(keymap.lookup(Keymap::gamepad, 4) == -1);
+
+	// rebinding moves the key on that device only
+	keymap.bind(Keymap::keyboard, 80, 0x7);
+	REQUIRE(keymap.lookup(Keymap::keyboard, 80) == 0x7);
+	REQUIRE(keymap.lookup(Keymap::keyboard, 4) == -1);
+	REQUIRE(keymap.lookup(Keymap::gamepad, 13) == 0x7);
+
+	keymap.unbind(Keymap::gamepad, 13);
+	REQUIRE(keymap.lookup(Keymap::gamepad, 13) == -1);
+}
+
+TEST_CASE("Input events are applied at instruction boundaries", "[input]")
+{
+	InputQueue queue;
+	Chip8 chip8;
+	chip8.load_bytes(program);
+
+	queue.push({1020, 5, true}); // next frame
+	queue.push({1004, 5, false});
+	queue.push({1004, 5, true}); // same time, goes after the release
+	queue.push({1009, 5, false});
+	REQUIRE(queue.size() == 4);
+
+	queue.start_frame(1000, 1016, 16);
+	REQUIRE(queue.step_of(900) == 0);
+	REQUIRE(queue.step_of(1004) == 4);
+	REQUIRE(queue.step_of(1015) == 15);
+	REQUIRE(queue.step_of(1016) == 16);
+
+	REQUIRE(queue.apply(chip8, 0) == 4);
+	// events of equal time keep the order they were pushed in, and the release waits a step
+	REQUIRE(queue.apply(chip8, 4) == 5);
+	REQUIRE(queue.apply(chip8, 5) == 9);
+	REQUIRE(queue.apply(chip8, 9) == 16);
+	REQUIRE(queue.size() == 1);
+
+	queue.start_frame(1016, 1032, 16);
+	REQUIRE(queue.apply(chip8, 0) == 4);
+	REQUIRE(queue.apply(chip8, 4) == 16);
+	REQUIRE(queue.size() == 0);
+}
+
+TEST_CASE("Taps shorter than an instruction reach the ROM", "[input]")
+{
+	InputQueue queue;
+	Chip8 chip8;
+	chip8.load_bytes(program);
+
+	// pressed and released before the same instruction, checked by SKNP there
+	queue.push({1004, 0, true});
+	queue.push({1004, 0, false});
+	queue.start_frame(1000, 1016, 16);
+	run_frame(chip8, queue, 16);
+	REQUIRE(chip8.get_register(1) == 1);
+
+	// held for a quarter of the frame
+	queue.push({1020, 0, true});
+	queue.push({1024, 0, false});
+	queue.start_frame(1016, 1032, 16);
+	run_frame(chip8, queue, 16);
+	REQUIRE(chip8.get_register(1) == 2);
+}
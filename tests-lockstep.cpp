@@ -0,0 +1,134 @@
+#include <array>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "engine.hpp"
+#include "fused.hpp"
+#include "lockstep.hpp"
+
+// behaves like the reference engine, except for mangling VE when V0 reaches 100 at 0x202
+class BrokenEngine : public Engine
+{
+public:
+	const char* name() const override
+	{
+		return "broken";
+	}
+
+	Chip8::Fault run(Chip8& chip8, uint64_t steps, uint64_t* executed = nullptr) override
+	{
+		for (uint64_t i = 0; i < steps && chip8.get_fault() == Chip8::Fault::none; ++i)
+		{
+			if (chip8.get_register(0) == 100 && chip8.get_program_counter() == 0x202) chip8.op_add(1, 0xe, 0);
+			if (executed && !chip8.is_waiting()) ++*executed;
+			chip8.step();
+		}
+		return chip8.get_fault();
+	}
+};
+
+TEST_CASE("State hashes follow the machine state", "[lockstep]")
+{
+	Chip8 a(1);
+	Chip8 b(1);
+	REQUIRE(a.hash() == b.hash());
+
+	a.op_store(1, 3, 0);
+	REQUIRE(a.hash() != b.hash());
+	b.op_store(1, 3, 0);
+	REQUIRE(a.hash() == b.hash());
+
+	a.press(4);
+	REQUIRE(a.hash() != b.hash());
+}
+
+TEST_CASE("Tracked state hashes match hashing from scratch", "[lockstep]")
+{
+	Chip8 tracked(1);
+	tracked.load_bytes(std::array<uint8_t, 22>{
+		0xc0, 0xff, // 200 RND V0, FF
+		0xc1, 0x3f, // 202 RND V1, 3F
+		0xa3, 0x00, // 204 LD I, 300
+		0xf1, 0x1e, // 206 ADD I, V1
+		0xf0, 0x33, // 208 LD B, V0
+		0xf2, 0x55, // 20A LD [I], V2
+		0xd0, 0x15, // 20C DRW V0, V1, 5
+		0x30, 0x00, // 20E SE V0, 0
+		0x12, 0x00, // 210 JP 200
+		0x00, 0xe0, // 212 CLS
+		0x12, 0x00}); // 214 JP 200
+	tracked.set_hash_tracking(true);
+	REQUIRE(tracked.get_hash_tracking());
+
+	// the same state without tracking hashes memory and screen in full
+	auto check = [&tracked]()
+	{
+		Chip8 plain = tracked;
+		plain.set_hash_tracking(false);
+		REQUIRE(plain.hash() == tracked.hash());
+	};
+
+	Chip8 start = tracked;
+	Chip8::Snapshot snapshot;
+	for (int i = 0; i < 5000; ++i)
+	{
+		tracked.step();
+		check();
+		if (i == 1000) tracked.save_state(snapshot);
+	}
+
+	tracked.set_memory(0x300, 0x12);
+	check();
+	tracked.load_state(snapshot);
+	check();
+	tracked.restore(start);
+	check();
+	REQUIRE(tracked.hash() == start.hash());
+
+	// the fused engine writes through the same paths
+	FusedEngine fused;
+	fused.run(tracked, 5000);
+	check();
+}
+
+TEST_CASE("Lockstep finds the first differing instruction", "[lockstep]")
+{
+	Chip8 chip8(1);
+	// 7001 7102 1200: count up in V0 and V1 forever
+	chip8.load_bytes(std::array<uint8_t, 6>{0x70, 0x01, 0x71, 0x02, 0x12, 0x00});
+
+	ReferenceEngine reference;
+
+	SECTION("identical engines agree")
+	{
+		ReferenceEngine other;
+		Lockstep lockstep(reference, other, 100);
+		LockstepResult result = lockstep.run(chip8, 10000);
+		REQUIRE(!result.diverged);
+		REQUIRE(result.steps == 10000);
+	}
+
+	SECTION("a broken engine is caught at the broken step")
+	{
+		// interval boundaries shouldn't matter
+		for (uint64_t interval : {1, 7, 100, 4096})
+		{
+			BrokenEngine broken;
+			Lockstep lockstep(reference, broken, interval);
+			LockstepResult result = lockstep.run(chip8, 10000);
+			REQUIRE(result.diverged);
+			REQUIRE(result.steps == 3 * 99 + 1);
+			REQUIRE(result.program_counter == 0x202);
+			REQUIRE(result.opcode == 0x7102);
+		}
+	}
+
+	SECTION("faults end the run")
+	{
+		chip8.load_bytes(std::array<uint8_t, 2>{0x22, 0x00}); // call itself until the stack overflows
+		ReferenceEngine other;
+		Lockstep lockstep(reference, other, 100);
+		LockstepResult result = lockstep.run(chip8, 10000);
+		REQUIRE(!result.diverged);
+		REQUIRE(result.faulted);
+	}
+}
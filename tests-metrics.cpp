@@ -0,0 +1,114 @@
+#include <catch/catch.hpp>
+#include <sstream>
+#include "metrics.hpp"
+
+TEST_CASE("Metrics are aggregated once per second", "[metrics]")
+{
+	constexpr uint64_t ms = 1000000;
+	Metrics metrics;
+	Metrics::Report report;
+
+	REQUIRE_FALSE(metrics.update(1000 * ms, report)); // starts the first period
+
+	// 60 frames of 16 steps, 2 ms emulating, 1 ms rendering and 0.5 ms presenting each
+	for (uint64_t frame = 1; frame <= 60; ++frame)
+	{
+		uint64_t time = 1000 * ms + frame * 1000 * ms / 60;
+		metrics.add_steps(16);
+		metrics.add_time(Metrics::emulation, 2 * ms);
+		metrics.add_time(Metrics::render, ms);
+		metrics.add_time(Metrics::present, ms / 2);
+		if (frame == 10)
+		{
+			// only the oldest input of a frame counts
+			metrics.input(time - 8 * ms);
+			metrics.input(time - 3 * ms);
+		}
+		if (frame == 20) metrics.input(time - 4 * ms);
+		metrics.presented(time);
+		REQUIRE(metrics.update(time, report) == (frame == 60));
+	}
+
+	REQUIRE(report.seconds == Approx(1));
+	REQUIRE(report.instructions_per_second == Approx(960));
+	REQUIRE(report.frames_per_second == Approx(60));
+	REQUIRE(report.phase_ms[Metrics::emulation] == Approx(2));
+	REQUIRE(report.phase_ms[Metrics::render] == Approx(1));
+	REQUIRE(report.phase_ms[Metrics::present] == Approx(0.5));
+	REQUIRE(report.input_latency_ms == Approx(6));
+	REQUIRE(report.audio_underruns == 0);
+
+	// counters start over for the next period
+	REQUIRE_FALSE(metrics.update(2500 * ms, report));
+	REQUIRE(metrics.update(3000 * ms, report));
+	REQUIRE(report.frames_per_second == 0);
+	REQUIRE(report.input_latency_ms == 0);
+}
+
+TEST_CASE("Input latency lasts until the screen changes", "[metrics]")
+{
+	constexpr uint64_t ms = 1000000;
+	Metrics metrics;
+	Metrics::Report report;
+	REQUIRE_FALSE(metrics.update(1000 * ms, report));
+
+	// answered two frames later
+	metrics.input(1010 * ms);
+	metrics.presented(1017 * ms, false);
+	metrics.presented(1033 * ms, true);
+
+	// answered by the next frame
+	metrics.input(1040 * ms);
+	metrics.presented(1050 * ms, true);
+
+	// never answered, the change a second later is unrelated
+	metrics.input(1100 * ms);
+	for (uint64_t time = 1117; time < 1700; time += 17) metrics.presented(time * ms, false);
+	metrics.presented(1717 * ms, true);
+
+	REQUIRE(metrics.update(2000 * ms, report));
+	REQUIRE(report.input_latency_ms == Approx(16.5));
+	REQUIRE(report.input_latency_max_ms == Approx(23));
+	REQUIRE(report.unanswered_inputs == 1);
+}
+
+TEST_CASE("Metrics count audio underruns", "[metrics]")
+{
+	constexpr uint64_t buffer = 85000000; // 4096 samples at 48 kHz
+	Metrics metrics;
+	Metrics::Report report;
+	metrics.update(1, report);
+
+	metrics.audio_callback(1000, buffer);
+	metrics.audio_callback(1000 + buffer, buffer);
+	metrics.audio_callback(1000 + 2 * buffer + buffer / 4, buffer); // a bit late is fine
+	metrics.audio_callback(1000 + 4 * buffer, buffer); // missed one
+	metrics.audio_paused();
+	metrics.audio_callback(1000 + 20 * buffer, buffer); // resuming after a pause is not an underrun
+	REQUIRE(metrics.update(2000000000, report));
+	REQUIRE(report.audio_underruns == 1);
+
+	metrics.audio_callback(1000 + 40 * buffer, buffer);
+	REQUIRE(metrics.update(4000000000, report));
+	REQUIRE(report.audio_underruns == 1);
+}
+
+TEST_CASE("Metrics are written as JSON", "[metrics]")
+{
+	Metrics::Report report;
+	report.seconds = 1;
+	report.instructions_per_second = 960;
+	report.frames_per_second = 60;
+	report.phase_ms = {2, 1, 0.5};
+	report.audio_underruns = 3;
+	report.input_latency_ms = 6;
+	report.input_latency_max_ms = 9;
+	report.unanswered_inputs = 1;
+	report.cpu_percent = 12.5;
+
+	std::ostringstream json;
+	Metrics::write_json(json, report);
+	REQUIRE(json.str() == "{\"seconds\": 1, \"instructions_per_second\": 960, \"frames_per_second\": 60, "
+		"\"emulation_ms\": 2, \"render_ms\": 1, \"present_ms\": 0.5, \"audio_underruns\": 3, "
+		"\"input_latency_ms\": 6, \"input_latency_max_ms\": 9, \"unanswered_inputs\": 1, \"cpu_percent\": 12.5}");
+}
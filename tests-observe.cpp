@@ -0,0 +1,136 @@
+#include <array>
+#include <catch/catch.hpp>
+#include <vector>
+#include "chip8.hpp"
+#include "observe.hpp"
+
+// draws random digits at random places forever
+static const std::array<uint8_t, 12> program{
+	0xc0, 0x3f, // 200 RND V0, 3F
+	0xc1, 0x1f, // 202 RND V1, 1F
+	0xc2, 0x0f, // 204 RND V2, 0F
+	0xf2, 0x29, // 206 LD F, V2
+	0xd0, 0x15, // 208 DRW V0, V1, 5
+	0x12, 0x00}; // 20A JP 200
+
+static std::vector<uint8_t> plane_of(const Chip8& chip8)
+{
+	std::vector<uint8_t> plane;
+	for (uint8_t y = 0; y < Chip8::screen_height; ++y)
+	{
+		for (uint8_t x = 0; x < Chip8::screen_width; ++x) plane.push_back(chip8.get_pixel(x, y));
+	}
+	return plane;
+}
+
+static std::vector<uint8_t> downsampled(const std::vector<uint8_t>& plane)
+{
+	std::vector<uint8_t> small;
+	for (unsigned int y = 0; y < Chip8::screen_height; y += 2)
+	{
+		for (unsigned int x = 0; x < Chip8::screen_width; x += 2)
+		{
+			unsigned int i = y * Chip8::screen_width + x;
+			small.push_back(plane[i] | plane[i + 1] | plane[i + Chip8::screen_width] | plane[i + Chip8::screen_width + 1]);
+		}
+	}
+	return small;
+}
+
+static void draw(Chip8& chip8, unsigned int sprites)
+{
+	for (unsigned int i = 0; i < sprites * 6; ++i) chip8.step();
+}
+
+TEST_CASE("Observation kernels match the framebuffer", "[observe]")
+{
+	Chip8 chip8(7);
+	chip8.load_bytes(program);
+	draw(chip8, 40);
+	std::vector<uint8_t> expected = plane_of(chip8);
+
+	std::array<uint8_t, packed_screen_size> packed;
+	pack_screen(chip8, packed.data());
+	for (size_t i = 0; i < screen_pixels; ++i) REQUIRE(((packed[i / 8] >> (i % 8)) & 1) == expected[i]);
+
+	std::vector<uint8_t> bytes(screen_pixels);
+	unpack_screen(packed.data(), bytes.data(), 255);
+	for (size_t i = 0; i < screen_pixels; ++i) REQUIRE(bytes[i] == expected[i] * 255);
+
+	std::vector<float> floats(screen_pixels);
+	unpack_screen(packed.data(), floats.data(), 0.5f);
+	for (size_t i = 0; i < screen_pixels; ++i) REQUIRE(floats[i] == expected[i] * 0.5f);
+
+	std::vector<uint8_t> small(downsampled_pixels);
+	unpack_screen(packed.data(), bytes.data());
+	downsample_screen(bytes.data(), small.data());
+	REQUIRE(small == downsampled(expected));
+}
+
+TEST_CASE("Frame stacks keep the last frames in order", "[observe]")
+{
+	Chip8 chip8(3);
+	chip8.load_bytes(program);
+	FrameStack stack(3);
+	REQUIRE(stack.get_depth() == 3);
+	REQUIRE(FrameStack::plane_size(false) == screen_pixels);
+	REQUIRE(FrameStack::plane_size(true) == downsampled_pixels);
+
+	std::vector<std::vector<uint8_t>> frames;
+	auto push = [&]()
+	{
+		draw(chip8, 3);
+		stack.push(chip8);
+		frames.push_back(plane_of(chip8));
+	};
+
+	std::vector<uint8_t> out(3 * screen_pixels);
+	const std::vector<uint8_t> blank(screen_pixels);
+	auto plane = [&](unsigned int i) { return std::vector<uint8_t>(out.begin() + i * screen_pixels, out.begin() + (i + 1) * screen_pixels); };
+
+	SECTION("missing frames are blank")
+	{
+		push();
+		stack.write(out.data());
+		REQUIRE(plane(0) == blank);
+		REQUIRE(plane(1) == blank);
+		REQUIRE(plane(2) == frames[0]);
+	}
+
+	SECTION("oldest first, also once the ring has wrapped")
+	{
+		for (int i = 0; i < 10; ++i) push();
+		stack.write(out.data());
+		REQUIRE(plane(0) == frames[7]);
+		REQUIRE(plane(1) == frames[8]);
+		REQUIRE(plane(2) == frames[9]);
+
+		stack.clear();
+		stack.write(out.data());
+		REQUIRE(plane(2) == blank);
+	}
+
+	SECTION("max pooling with the frame before")
+	{
+		for (int i = 0; i < 6; ++i) push();
+		stack.write(out.data(), true);
+		for (unsigned int p = 0; p < 3; ++p)
+		{
+			std::vector<uint8_t> pooled(screen_pixels);
+			for (size_t i = 0; i < screen_pixels; ++i) pooled[i] = frames[2 + p][i] | frames[3 + p][i];
+			REQUIRE(plane(p) == pooled);
+		}
+	}
+
+	SECTION("downsampled floats")
+	{
+		for (int i = 0; i < 4; ++i) push();
+		std::vector<float> floats(3 * downsampled_pixels);
+		stack.write(floats.data(), false, true, 2.0f);
+		for (unsigned int p = 0; p < 3; ++p)
+		{
+			std::vector<uint8_t> small = downsampled(frames[1 + p]);
+			for (size_t i = 0; i < downsampled_pixels; ++i) REQUIRE(floats[p * downsampled_pixels + i] == small[i] * 2.0f);
+		}
+	}
+}
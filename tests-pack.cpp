@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "pack.hpp"
+
+static const char* pack_file = "/tmp/tests-pack.c8pk";
+
+static PackRom make_rom(const std::string& name, std::vector<uint8_t> image)
+{
+	PackRom rom;
+	rom.name = name;
+	rom.image = image;
+	return rom;
+}
+
+TEST_CASE("ROM packs find and load ROMs", "[pack]")
+{
+	std::vector<PackRom> roms;
+	roms.push_back(make_rom("loop.ch8", {0x12, 0x00}));
+	roms.push_back(make_rom("add.ch8", {0x70, 0x05, 0x12, 0x02}));
+	roms.push_back(make_rom("copy.ch8", {0x12, 0x00})); // same contents as loop.ch8
+	roms[1].settings.steps_per_frame = 32;
+	roms[1].settings.profile = profile_vip;
+	roms[1].settings.keys[0xa] = 4;
+	REQUIRE(write_pack(pack_file, roms));
+
+	Pack pack;
+	REQUIRE(pack.open(pack_file));
+	REQUIRE(pack.size() == 2);
+	REQUIRE(pack.find("copy.ch8") == nullptr);
+
+	const PackEntry* add = pack.find("add.ch8");
+	REQUIRE(add != nullptr);
+	REQUIRE(pack.name(*add) == "add.ch8");
+	REQUIRE(add->hash == rom_hash(roms[1].image.data(), roms[1].image.size()));
+
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(add->hash));
+	REQUIRE(pack.find(std::string(hex)) == add);
+	REQUIRE(pack.find(add->hash) == add);
+	REQUIRE(pack.find(add->hash + 1) == nullptr);
+	REQUIRE(pack.find("nope") == nullptr);
+
+	PackSettings settings = pack.settings(*add);
+	REQUIRE(settings.steps_per_frame == 32);
+	REQUIRE(settings.profile == profile_vip);
+	REQUIRE(settings.keys[0xa] == 4);
+	REQUIRE(settings.keys[0xb] == 0);
+	REQUIRE(pack.settings(*pack.find("loop.ch8")).steps_per_frame == 0);
+
+	Chip8 chip8;
+	pack.load(*add, chip8);
+	chip8.step();
+	REQUIRE(chip8.get_register(0) == 5);
+	REQUIRE(chip8.get_program_counter() == 0x202);
+}
+
+TEST_CASE("Invalid ROM packs are rejected", "[pack]")
+{
+	Pack pack;
+	REQUIRE_FALSE(pack.open("/tmp/tests-pack-missing.c8pk"));
+
+	{
+		std::ofstream file(pack_file, std::ios::binary);
+		file << "C8PK not really a pack";
+	}
+	REQUIRE_FALSE(pack.open(pack_file));
+
+	std::vector<PackRom> roms;
+	roms.push_back(make_rom("big.ch8", std::vector<uint8_t>(Chip8::max_rom_size + 1)));
+	REQUIRE_FALSE(write_pack(pack_file, roms));
+}
+
+TEST_CASE("Pack settings files are parsed", "[pack]")
+{
+	std::vector<std::pair<std::string, PackSettings>> settings;
+	std::string error;
+
+	std::istringstream good("# comment\n\npong.ch8 steps=10 key.1=q key.C=4 # trailing\nvip.ch8 profile=vip\n");
+	REQUIRE(read_pack_settings(good, settings, error));
+	REQUIRE(settings.size() == 2);
+	REQUIRE(settings[0].first == "pong.ch8");
+	REQUIRE(settings[0].second.steps_per_frame == 10);
+	REQUIRE(settings[0].second.keys[0x1] == 20);
+	REQUIRE(settings[0].second.keys[0xc] == 33);
+	REQUIRE(settings[1].second.profile == profile_vip);
+
+	for (const char* line : {"a steps=0", "a profile=schip", "a key.G=q", "a key.1=F1", "a speed=3"})
+	{
+		std::istringstream bad(std::string("ok.ch8\n") + line);
+		REQUIRE_FALSE(read_pack_settings(bad, settings, error));
+		REQUIRE(error.find("line 2") == 0);
+	}
+}
+
+TEST_CASE("Loading a ROM checks the file", "[pack]")
+{
+	Chip8 chip8;
+	REQUIRE_THROWS_AS(chip8.load_rom("/tmp/tests-pack-missing.ch8"), std::runtime_error);
+
+	const char* rom_file = "/tmp/tests-pack-big.ch8";
+	{
+		std::ofstream file(rom_file, std::ios::binary);
+		file << std::string(Chip8::max_rom_size + 1, '\0');
+	}
+	REQUIRE_THROWS_AS(chip8.load_rom(rom_file), std::runtime_error);
+
+	std::vector<uint8_t> big(Chip8::max_rom_size + 1);
+	REQUIRE_THROWS_AS(chip8.load_bytes(big.data(), big.size()), std::length_error);
+	REQUIRE_NOTHROW(chip8.load_bytes(big.data(), Chip8::max_rom_size));
+}
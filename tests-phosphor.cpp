@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <random>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "phosphor.hpp"
+
+// draws random digits at random places forever
+static const std::array<uint8_t, 12> program{
+	0xc0, 0x3f, // 200 RND V0, 3F
+	0xc1, 0x1f, // 202 RND V1, 1F
+	0xc2, 0x0f, // 204 RND V2, 0F
+	0xf2, 0x29, // 206 LD F, V2
+	0xd0, 0x15, // 208 DRW V0, V1, 5
+	0x12, 0x00}; // 20A JP 200
+
+TEST_CASE("Phosphor intensities jump when lit and decay when not", "[phosphor]")
+{
+	// the SSE2 loop covers 16 pixels at a time, a small screen also takes the plain one
+	for (unsigned int width : {64u, 21u})
+	{
+		Chip8 chip8(3);
+		chip8.load_bytes(program);
+		const unsigned int height = Chip8::screen_height;
+		Phosphor phosphor(width, height, 200);
+		std::vector<unsigned int> expected(width * height);
+
+		for (int frame = 0; frame < 30; ++frame)
+		{
+			for (int i = 0; i < 12; ++i) chip8.step();
+			// the first rows of the screen, as one of the given width
+			phosphor.update(chip8.get_screen().data());
+			for (unsigned int i = 0; i < expected.size(); ++i)
+			{
+				expected[i] = chip8.get_screen()[i] ? 255 : expected[i] * 200 / 256;
+			}
+		}
+
+		for (unsigned int y = 0; y < height; ++y)
+		{
+			for (unsigned int x = 0; x < width; ++x)
+			{
+				unsigned int level = expected[y * width + x];
+				REQUIRE(phosphor.get_intensity(x, y) == level);
+				REQUIRE(phosphor.get_image()[y * width + x] == (0xff000000 | level << 16 | level << 8 | level));
+			}
+		}
+	}
+}
+
+TEST_CASE("Phosphor gives the same results with and without SSE2", "[phosphor]")
+{
+	// 37x19 is 703 pixels, so 15 are left over after the last 16 pixel block
+	const unsigned int width = 37;
+	const unsigned int height = 19;
+	std::minstd_rand random(1);
+	std::unique_ptr<bool[]> screen(new bool[width * height]);
+
+	for (unsigned int retain : {0u, 1u, 160u, 255u})
+	{
+		Phosphor fast(width, height, retain);
+		Phosphor plain(width, height, retain);
+		for (int frame = 0; frame < 40; ++frame)
+		{
+			// mostly dark, so pixels go through every level while they fade
+			for (unsigned int i = 0; i < width * height; ++i) screen[i] = random() % 8 == 0;
+			fast.update(screen.get());
+			plain.update_plain(screen.get());
+
+			for (unsigned int y = 0; y < height; ++y)
+			{
+				for (unsigned int x = 0; x < width; ++x)
+				{
+					REQUIRE(fast.get_intensity(x, y) == plain.get_intensity(x, y));
+					REQUIRE(fast.get_image()[y * width + x] == plain.get_image()[y * width + x]);
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("Phosphor hides sprites that flicker", "[phosphor]")
+{
+	// the same sprite XORed off and on again, the screen is blank at every other frame
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 6>{
+		0xf0, 0x29, // 200 LD F, V0
+		0xd0, 0x05, // 202 DRW V0, V0, 5
+		0x12, 0x02}); // 204 JP 202
+	chip8.step();
+
+	Phosphor phosphor;
+	unsigned int dimmest = 255;
+	for (int frame = 0; frame < 20; ++frame)
+	{
+		chip8.step();
+		chip8.step();
+		phosphor.update(chip8);
+		if (frame > 0) dimmest = std::min<unsigned int>(dimmest, phosphor.get_intensity(1, 0));
+	}
+	REQUIRE(dimmest == 255 * 160 / 256);
+	REQUIRE(phosphor.get_intensity(0, 0) == 0);
+
+	phosphor.clear();
+	REQUIRE(phosphor.get_intensity(1, 0) == 0);
+	REQUIRE(phosphor.get_image()[1] == 0xff000000);
+
+	// without retention it is a plain copy of the screen
+	Phosphor plain(Chip8::screen_width, Chip8::screen_height, 0);
+	plain.update(chip8);
+	chip8.step();
+	chip8.step();
+	plain.update(chip8);
+	REQUIRE(plain.get_intensity(1, 0) == (chip8.get_pixel(1, 0) ? 255 : 0));
+}
@@ -0,0 +1,64 @@
+#include <array>
+#include <catch/catch.hpp>
+#include <fstream>
+#include <sstream>
+#include "chip8.hpp"
+#include "profiler.hpp"
+
+// 2210 1200 ... 6001 2216 00EE 7001 7101 00EE: main calls 0x210, which calls 0x216
+static const std::array<uint8_t, 28> nested_calls{
+	0x22, 0x10, 0x12, 0x00, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0x60, 0x01, 0x22, 0x16, 0x00, 0xee, 0x70, 0x01, 0x71, 0x01, 0x00, 0xee};
+
+TEST_CASE("Profiler attributes steps to call paths", "[profiler]")
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(nested_calls);
+	Profiler profiler;
+	std::ostringstream folded;
+
+	SECTION("exact mode")
+	{
+		// each trip round the loop is 2 steps in main and 3 in each subroutine
+		profiler.run(chip8, 800);
+		REQUIRE(profiler.total() == 800);
+		profiler.write_folded(folded, "rom");
+		REQUIRE(folded.str() == "rom 200\nrom;sub_210 300\nrom;sub_210;sub_216 300\n");
+	}
+
+	SECTION("sampling")
+	{
+		// stop inside each function in turn: 0x202 is main, 0x212 is 0x210 and 0x218 is 0x216
+		for (uint16_t stop : {0x202, 0x212, 0x218})
+		{
+			while (chip8.get_program_counter() != stop) chip8.step();
+			profiler.sample(chip8, 10);
+		}
+		REQUIRE(profiler.total() == 30);
+		profiler.write_folded(folded, "rom");
+		REQUIRE(folded.str() == "rom 10\nrom;sub_210 10\nrom;sub_210;sub_216 10\n");
+	}
+
+	SECTION("symbols")
+	{
+		profiler.run(chip8, 5);
+		Profiler::symbols_t symbols{{0x210, "update"}};
+		profiler.write_folded(folded, "rom", symbols);
+		REQUIRE(folded.str() == "rom 1\nrom;update 2\nrom;update;sub_216 2\n");
+	}
+}
+
+TEST_CASE("Profiler reads symbol files", "[profiler]")
+{
+	const char* path = "/tmp/tests-profiler.sym";
+	{
+		std::ofstream file(path);
+		file << "# comment\n210 update\n\n0x216 draw_score # trailing\n";
+	}
+	Profiler::symbols_t symbols;
+	REQUIRE(Profiler::read_symbols(path, symbols));
+	REQUIRE(symbols.size() == 2);
+	REQUIRE(symbols[0x210] == "update");
+	REQUIRE(symbols[0x216] == "draw_score");
+	REQUIRE_FALSE(Profiler::read_symbols("/nonexistent/symbols", symbols));
+}
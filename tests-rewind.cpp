@@ -0,0 +1,109 @@
+#include <array>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "delta.hpp"
+#include "rewind.hpp"
+
+TEST_CASE("Deltas round trip", "[rewind]")
+{
+	std::array<uint8_t, 64> base {};
+	std::array<uint8_t, 64> current {};
+
+	SECTION("identical images")
+	{
+		std::vector<uint8_t> delta;
+		delta_encode(base.data(), current.data(), base.size(), delta);
+		REQUIRE(delta.size() <= 2);
+
+		delta_apply(delta, base.data(), base.size());
+		REQUIRE(base == current);
+	}
+
+	SECTION("scattered changes")
+	{
+		for (size_t i = 0; i < base.size(); ++i) base[i] = i * 7;
+		current = base;
+		current[0] = 0xff;
+		current[10] ^= 1;
+		current[12] ^= 2;
+		current[63] = 0;
+
+		std::vector<uint8_t> delta;
+		delta_encode(base.data(), current.data(), base.size(), delta);
+		REQUIRE(delta.size() < base.size());
+
+		delta_apply(delta, base.data(), base.size());
+		REQUIRE(base == current);
+	}
+}
+
+TEST_CASE("Rewinding restores earlier frames", "[rewind]")
+{
+	Chip8 chip8;
+
+	// 7001 1200: count up in V0 forever
+	chip8.load_bytes(std::array<uint8_t, 4>{0x70, 0x01, 0x12, 0x00});
+
+	Rewind rewind(100, 8);
+	for (int i = 0; i < 40; ++i)
+	{
+		chip8.step();
+		chip8.step();
+		rewind.push(chip8);
+	}
+	REQUIRE(rewind.size() == 40);
+
+	for (int i = 40; i > 0; --i)
+	{
+		REQUIRE(rewind.pop(chip8));
+		REQUIRE(chip8.get_register(0) == i);
+		REQUIRE(chip8.get_program_counter() == Chip8::program_mem_start);
+	}
+	REQUIRE(rewind.pop(chip8) == false);
+
+	SECTION("history can be extended after rewinding")
+	{
+		chip8.step();
+		rewind.push(chip8);
+		REQUIRE(rewind.pop(chip8));
+		REQUIRE(chip8.get_register(0) == 2);
+	}
+
+	SECTION("replaying a frame draws the same random numbers")
+	{
+		chip8.load_bytes(std::array<uint8_t, 4>{0xc0, 0xff, 0x12, 0x00}); // 200 RND V0, FF; 202 JP 200
+		rewind.push(chip8);
+		std::vector<uint8_t> drawn;
+		for (int i = 0; i < 8; ++i)
+		{
+			chip8.step();
+			chip8.step();
+			drawn.push_back(chip8.get_register(0));
+		}
+
+		REQUIRE(rewind.pop(chip8));
+		for (uint8_t value : drawn)
+		{
+			chip8.step();
+			chip8.step();
+			REQUIRE(chip8.get_register(0) == value);
+		}
+	}
+}
+
+TEST_CASE("Rewind history is bounded", "[rewind]")
+{
+	Chip8 chip8;
+	chip8.load_bytes(std::array<uint8_t, 4>{0x70, 0x01, 0x12, 0x00});
+
+	Rewind rewind(50, 10);
+	for (int i = 0; i < 500; ++i)
+	{
+		chip8.step();
+		rewind.push(chip8);
+	}
+	REQUIRE(rewind.size() <= 50);
+	REQUIRE(rewind.size() > 40);
+	REQUIRE(rewind.memory_used() < 50 * Rewind::image_size);
+}
@@ -0,0 +1,126 @@
+#include <array>
+#include <sstream>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "engine.hpp"
+#include "scheduler.hpp"
+
+static uint64_t fake_time = 0;
+
+static uint64_t fake_clock()
+{
+	return fake_time;
+}
+
+template<size_t SIZE>
+static Chip8 machine(const std::array<uint8_t, SIZE>& program)
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(program);
+	return chip8;
+}
+
+TEST_CASE("The scheduler parks machines that can't make progress", "[scheduler]")
+{
+	constexpr uint64_t frame = Scheduler::default_frame_time;
+	fake_time = 1000 * frame;
+	ReferenceEngine engine;
+	Scheduler scheduler(engine, frame, fake_clock);
+
+	// 7001 1200: counts forever
+	size_t busy = scheduler.add(machine(std::array<uint8_t, 6>{0x70, 0x01, 0x12, 0x00, 0x00, 0x00}));
+	// F20A 1202: waits for a key, then spins
+	size_t waiter = scheduler.add(machine(std::array<uint8_t, 6>{0xf2, 0x0a, 0x12, 0x02, 0x00, 0x00}));
+	// 1200: halted
+	size_t halted = scheduler.add(machine(std::array<uint8_t, 6>{0x12, 0x00, 0x00, 0x00, 0x00, 0x00}));
+
+	REQUIRE(scheduler.run() == fake_time + frame);
+	REQUIRE(scheduler.get_state(busy) == Scheduler::ready);
+	REQUIRE(scheduler.get_state(waiter) == Scheduler::waiting);
+	REQUIRE(scheduler.get_state(halted) == Scheduler::idle);
+	REQUIRE(scheduler.get(busy).get_register(0) == 8);
+
+	// nothing is due until the next frame
+	fake_time += frame / 2;
+	scheduler.run();
+	REQUIRE(scheduler.get(busy).get_register(0) == 8);
+	fake_time += frame / 2;
+	scheduler.run();
+	REQUIRE(scheduler.get(busy).get_register(0) == 16);
+
+	// input wakes a machine and its frame is due right away
+	scheduler.press(waiter, 5);
+	REQUIRE(scheduler.get_state(waiter) == Scheduler::ready);
+	REQUIRE(scheduler.get(waiter).get_register(2) == 5);
+	scheduler.release(halted, 1);
+	REQUIRE(scheduler.get_state(halted) == Scheduler::ready);
+	REQUIRE(scheduler.run() == fake_time + frame);
+	REQUIRE(scheduler.get(busy).get_register(0) == 16);
+	// the key doesn't change anything else, so it idles again
+	REQUIRE(scheduler.get_state(halted) == Scheduler::idle);
+
+	// nothing runs past the given time
+	fake_time += frame;
+	scheduler.run(fake_time);
+	REQUIRE(scheduler.get(busy).get_register(0) == 16);
+
+	// far behind, frames are dropped rather than caught up
+	fake_time += 10 * frame + frame / 2;
+	scheduler.run();
+	REQUIRE(scheduler.get(busy).get_register(0) == 24);
+
+	Scheduler::Report report;
+	scheduler.report(report);
+	REQUIRE(report.instances.size() == 3);
+	REQUIRE(report.instances[busy].frames == 3);
+	REQUIRE(report.instances[busy].dropped_frames == 10);
+	REQUIRE(report.instances[waiter].frames == 3);
+	REQUIRE(report.instances[halted].frames == 2);
+	REQUIRE(report.frames == 8);
+	REQUIRE(report.dropped_frames == 20);
+	REQUIRE(report.parked == 2);
+	REQUIRE(report.instances[waiter].state == Scheduler::idle);
+	REQUIRE(report.fairness < 1);
+	REQUIRE(report.lateness_max_ms == Approx(frame / 2 / 1e6));
+	REQUIRE(report.instances[busy].lateness_p99_ms >= report.instances[busy].lateness_max_ms);
+
+	std::ostringstream json;
+	Scheduler::write_json(json, report);
+	REQUIRE(json.str().find("\"parked\": 2") != std::string::npos);
+	REQUIRE(json.str().find("\"state\": \"idle\"") != std::string::npos);
+
+	scheduler.report(report);
+	REQUIRE(report.frames == 0);
+}
+
+TEST_CASE("Parked VIP machines catch up on the frames they missed", "[scheduler]")
+{
+	constexpr uint64_t frame = Scheduler::default_frame_time;
+	fake_time = 0;
+	ReferenceEngine engine;
+	Scheduler scheduler(engine, frame, fake_clock);
+
+	// 6014 F015 F10A 1206: set the delay timer to 20, wait for a key and spin
+	Chip8 chip8 = machine(std::array<uint8_t, 8>{0x60, 0x14, 0xf0, 0x15, 0xf1, 0x0a, 0x12, 0x06});
+	chip8.set_timing(Chip8::Timing::vip);
+	size_t i = scheduler.add(chip8);
+	scheduler.run();
+	REQUIRE(scheduler.get_state(i) == Scheduler::waiting);
+
+	// the same machine run frame by frame, as if it hadn't been parked: the
+	// first frame, four waiting for the key, and the one that sees it
+	Chip8 reference = chip8;
+	for (int f = 0; f < 6; ++f)
+	{
+		if (f == 5) reference.press(3);
+		for (uint64_t end = reference.next_frame_cycles(); reference.get_cycles() < end;) reference.step();
+	}
+
+	fake_time += 5 * frame;
+	scheduler.press(i, 3);
+	scheduler.run();
+	REQUIRE(scheduler.get_state(i) == Scheduler::ready);
+	Chip8 scheduled = scheduler.get(i);
+	scheduled.set_hash_tracking(false);
+	REQUIRE(scheduled.hash() == reference.hash());
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "speaker.hpp"
+
+// a machine with the pattern at 0x300 loaded and the pitch set
+static Chip8 sounding(const std::array<uint8_t, Chip8::audio_pattern_size>& pattern, uint8_t pitch)
+{
+	Chip8 chip8(1);
+	chip8.load_bytes(std::array<uint8_t, 8>{
+		0xa3, 0x00, // 200: LD I, 300
+		0xf0, 0x02, // 202: LD AUDIO, [I]
+		0x60, pitch, // 204: LD V0, pitch
+		0xf0, 0x3a}); // 206: LD PITCH, V0
+	for (uint8_t i = 0; i < pattern.size(); ++i) chip8.set_memory(0x300 + i, pattern[i]);
+	for (int i = 0; i < 4; ++i) chip8.step();
+	return chip8;
+}
+
+static unsigned int crossings(const std::vector<int16_t>& samples)
+{
+	unsigned int count = 0;
+	for (size_t i = 1; i < samples.size(); ++i) count += (samples[i - 1] < 0) != (samples[i] < 0);
+	return count;
+}
+
+TEST_CASE("Pitches follow the XO-CHIP formula", "[speaker]")
+{
+	REQUIRE(Speaker::bit_rate(Chip8::default_pitch) == 4000);
+	REQUIRE(Speaker::bit_rate(64 + 48) == Approx(8000));
+	REQUIRE(Speaker::bit_rate(64 - 48) == Approx(2000));
+}
+
+TEST_CASE("The speaker plays the default tone", "[speaker]")
+{
+	Speaker speaker(48000);
+	std::vector<int16_t> samples(48000);
+
+	// silent until told to play
+	Chip8 chip8(1);
+	speaker.update(chip8, false);
+	speaker.render(samples.data(), samples.size());
+	for (int16_t sample : samples) REQUIRE(sample == 0);
+
+	// a 500 Hz square wave crosses zero 1000 times a second
+	speaker.update(chip8, true);
+	speaker.render(samples.data(), samples.size());
+	REQUIRE(crossings(samples) == Approx(1000).margin(2));
+	REQUIRE(std::abs(samples.back()) <= Speaker::amplitude);
+}
+
+TEST_CASE("The speaker resamples patterns at their pitch", "[speaker]")
+{
+	Speaker speaker(48000);
+	std::vector<int16_t> samples(48000);
+
+	// alternating bits at 8000 bits per second make a 4 kHz tone
+	std::array<uint8_t, Chip8::audio_pattern_size> alternating;
+	alternating.fill(0xaa);
+	speaker.update(sounding(alternating, 64 + 48), true);
+	speaker.render(samples.data(), samples.size());
+	REQUIRE(crossings(samples) == Approx(8000).margin(10));
+
+	// each sample averages the bits it covers, so the level follows the share of set bits
+	std::array<uint8_t, Chip8::audio_pattern_size> sparse {};
+	sparse[0] = 0xff;
+	speaker.update(sounding(sparse, 255), true);
+	speaker.render(samples.data(), samples.size());
+	int64_t sum = 0;
+	for (int16_t sample : samples) sum += sample;
+	REQUIRE(sum / static_cast<double>(samples.size()) == Approx(Speaker::amplitude * (2 * 8.0 / 128 - 1)).epsilon(0.01));
+
+	// way above the device rate, a point sample per output sample would be all high or all low
+	alternating.fill(0xaa);
+	speaker.update(sounding(alternating, 255), true);
+	speaker.render(samples.data(), samples.size());
+	for (int16_t sample : samples) REQUIRE(std::abs(sample) < Speaker::amplitude * 3 / 5);
+}
+
+TEST_CASE("The speaker doesn't click on changes", "[speaker]")
+{
+	Speaker speaker(48000);
+	std::vector<int16_t> samples(Speaker::fade_samples * 2);
+
+	// starting and stopping ramp the volume
+	std::array<uint8_t, Chip8::audio_pattern_size> high;
+	high.fill(0xff);
+	Chip8 chip8 = sounding(high, 64);
+	speaker.update(chip8, true);
+	speaker.render(samples.data(), samples.size());
+	for (size_t i = 1; i < samples.size(); ++i) REQUIRE(samples[i] - samples[i - 1] <= static_cast<int>(Speaker::amplitude / Speaker::fade_samples) + 1);
+	REQUIRE(samples.back() == Speaker::amplitude);
+
+	speaker.update(chip8, false);
+	speaker.render(samples.data(), samples.size());
+	REQUIRE(samples.front() > Speaker::amplitude / 2);
+	REQUIRE(samples.back() == 0);
+
+	// a new pitch carries on from the same place in the pattern: the default tone is
+	// high for 48 samples then low for 48, change the pitch 36 samples into a high half
+	Speaker changing(48000);
+	Chip8 tone(1);
+	changing.update(tone, true);
+	std::vector<int16_t> wave(132);
+	changing.render(wave.data(), wave.size());
+	changing.update(sounding(tone.get_audio_pattern(), 64 + 48), true);
+	wave.resize(400);
+	changing.render(wave.data() + 132, wave.size() - 132);
+
+	// starting the pattern over would stretch that half to 36 + 24 samples
+	unsigned int run = 1;
+	unsigned int longest = 0;
+	for (size_t i = 1; i < wave.size(); ++i)
+	{
+		run = (wave[i] < 0) == (wave[i - 1] < 0) ? run + 1 : 1;
+		longest = std::max(longest, run);
+	}
+	REQUIRE(longest <= 48 + 1);
+	REQUIRE(wave[131] > 0);
+	REQUIRE(wave[132 + 8] < 0);
+}
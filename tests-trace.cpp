@@ -0,0 +1,103 @@
+#include <array>
+#include <cstdio>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "trace.hpp"
+
+TEST_CASE("Opcodes are disassemblable", "[trace]")
+{
+	REQUIRE(Chip8::disassemble(0x00e0) == "CLS");
+	REQUIRE(Chip8::disassemble(0x1bed) == "JP #BED");
+	REQUIRE(Chip8::disassemble(0x3a69) == "SE VA, #69");
+	REQUIRE(Chip8::disassemble(0x8cd7) == "SUBN VC, VD");
+	REQUIRE(Chip8::disassemble(0xd2eb) == "DRW V2, VE, B");
+	REQUIRE(Chip8::disassemble(0xfc65) == "LD VC, [I]");
+	REQUIRE(Chip8::disassemble(0x5243) == "DW #5243");
+}
+
+TEST_CASE("Faulting fetches are traced", "[trace]")
+{
+	Chip8 chip8(1);
+	Trace trace(4);
+	chip8.set_trace(&trace);
+
+	SECTION("invalid opcode")
+	{
+		chip8.load_bytes(std::array<uint8_t, 4>{0x60, 0x01, 0xf3, 0xff}); // 200 LD V0, 1; 202 invalid
+		for (int i = 0; i < 3; ++i) chip8.step();
+		REQUIRE(chip8.get_fault() == Chip8::Fault::invalid_opcode);
+
+		// stepping the faulted machine adds nothing
+		auto records = trace.get_records();
+		REQUIRE(records.size() == 2);
+		REQUIRE(records.back().program_counter == 0x202);
+		REQUIRE(records.back().opcode == 0xf3ff);
+		REQUIRE(records.back().reg == 3);
+	}
+
+	SECTION("program counter past memory")
+	{
+		chip8.load_bytes(std::array<uint8_t, 2>{0x1f, 0xff}); // 200 JP FFF
+		chip8.step();
+		chip8.step();
+		REQUIRE(chip8.get_fault() == Chip8::Fault::address_out_of_range);
+
+		auto records = trace.get_records();
+		REQUIRE(records.size() == 2);
+		REQUIRE(records.back().program_counter == 0xfff);
+		REQUIRE(records.back().opcode == 0);
+	}
+}
+
+TEST_CASE("Executed instructions are traced", "[trace]")
+{
+	Chip8 chip8;
+	Trace trace(4);
+
+	// A123 7005 1202: count up in V0 forever
+	chip8.load_bytes(std::array<uint8_t, 6>{0xa1, 0x23, 0x70, 0x05, 0x12, 0x02});
+	chip8.set_trace(&trace);
+
+	chip8.step();
+	chip8.step();
+	REQUIRE(trace.size() == 2);
+
+	auto records = trace.get_records();
+	REQUIRE(records[0].cycle == 0);
+	REQUIRE(records[0].program_counter == 0x200);
+	REQUIRE(records[0].opcode == 0xa123);
+	REQUIRE(records[0].address_register == 0x123);
+	REQUIRE(records[1].opcode == 0x7005);
+	REQUIRE(records[1].reg == 0);
+	REQUIRE(records[1].value == 5);
+
+	SECTION("only the latest records are kept")
+	{
+		for (int i = 0; i < 10; ++i) chip8.step();
+		records = trace.get_records();
+		REQUIRE(records.size() == 4);
+		REQUIRE(records.back().program_counter == 0x202);
+		REQUIRE(records.back().opcode == 0x7005);
+		REQUIRE(records.front().cycle == 8);
+		REQUIRE(records.back().cycle == 11);
+	}
+
+	SECTION("traces round trip through files")
+	{
+		for (int i = 0; i < 3; ++i) chip8.step();
+		REQUIRE(trace.dump("tests-trace.bin"));
+
+		std::vector<TraceRecord> read;
+		REQUIRE(Trace::read("tests-trace.bin", read));
+		std::remove("tests-trace.bin");
+
+		records = trace.get_records();
+		REQUIRE(read.size() == records.size());
+		for (size_t i = 0; i < read.size(); ++i)
+		{
+			REQUIRE(read[i].cycle == records[i].cycle);
+			REQUIRE(read[i].opcode == records[i].opcode);
+		}
+	}
+}
@@ -0,0 +1,104 @@
+#include <array>
+#include <vector>
+#include <catch/catch.hpp>
+#include "chip8.hpp"
+#include "wall.hpp"
+
+// draws the font digit of the key held down at 0,0, over and over
+static const std::array<uint8_t, 20> show_key = {
+	0x00, 0xe0, // 200: CLS
+	0x60, 0x00, // 202: LD V0, 0
+	0xe0, 0x9e, // 204: SKP V0
+	0x12, 0x0c, // 206: JP 20C
+	0xf0, 0x29, // 208: LD F, V0
+	0xd1, 0x15, // 20A: DRW V1, V1, 5
+	0x70, 0x01, // 20C: ADD V0, 1
+	0x30, 0x10, // 20E: SE V0, 16
+	0x12, 0x04, // 210: JP 204
+	0x12, 0x00, // 212: JP 200
+};
+
+static std::vector<Chip8> machines(size_t count)
+{
+	std::vector<Chip8> result;
+	for (size_t i = 0; i < count; ++i)
+	{
+		result.emplace_back(i);
+		result.back().load_bytes(show_key);
+	}
+	return result;
+}
+
+// whether the atlas shows the machine's screen in its tile
+static bool shows(const Wall& wall, size_t i, Chip8& chip8)
+{
+	unsigned int left = (i % wall.get_columns()) * Wall::tile_width;
+	unsigned int top = (i / wall.get_columns()) * Wall::tile_height;
+	uint32_t on = chip8.get_fault() == Chip8::Fault::none ? Wall::pixel_on : Wall::faulted_on;
+	for (uint8_t y = 0; y < Chip8::screen_height; ++y)
+	{
+		for (uint8_t x = 0; x < Chip8::screen_width; ++x)
+		{
+			uint32_t pixel = wall.get_atlas()[(top + y) * wall.atlas_width() + left + x];
+			if (pixel != (chip8.get_pixel(x, y) ? on : Wall::pixel_off)) return false;
+		}
+	}
+	return true;
+}
+
+TEST_CASE("The wall tiles machines into one atlas", "[wall]")
+{
+	Wall wall(machines(10), 16, 3);
+	REQUIRE(wall.size() == 10);
+	REQUIRE(wall.get_columns() == 4);
+	REQUIRE(wall.atlas_width() == 4 * Wall::tile_width);
+	REQUIRE(wall.atlas_height() == 3 * Wall::tile_height);
+
+	REQUIRE(wall.tile_at(0, 0) == 0);
+	REQUIRE(wall.tile_at(Wall::tile_width, Wall::tile_height) == 5);
+	REQUIRE(wall.tile_at(Wall::tile_width - 1, 2 * Wall::tile_height) == 8);
+	REQUIRE(wall.tile_at(3 * Wall::tile_width, 2 * Wall::tile_height) == -1); // no 12th machine
+	REQUIRE(wall.tile_at(-1, 0) == -1);
+	REQUIRE(wall.tile_at(wall.atlas_width(), 0) == -1);
+
+	// the borders stay
+	REQUIRE(wall.get_atlas()[Chip8::screen_width] == Wall::border);
+	REQUIRE(wall.get_atlas()[Chip8::screen_height * wall.atlas_width()] == Wall::border);
+}
+
+TEST_CASE("The wall runs every machine and draws what changed", "[wall]")
+{
+	std::vector<Chip8> reference = machines(7);
+	reference[6].load_bytes(std::array<uint8_t, 2>{0xff, 0xff});
+	Wall wall(reference, 16, 4);
+
+	// input goes to one machine only
+	wall.get(2).press(0xa);
+	reference[2].press(0xa);
+
+	bool drawn[2] = {false, false};
+	for (int frame = 0; frame < 20; ++frame)
+	{
+		wall.run_frame();
+		for (Chip8& chip8 : reference)
+		{
+			for (int i = 0; i < 16; ++i) chip8.step();
+		}
+		for (size_t i = 0; i < wall.size(); ++i)
+		{
+			REQUIRE(wall.get(i).hash() == reference[i].hash());
+			REQUIRE(shows(wall, i, reference[i]));
+		}
+		for (uint8_t x = 0; x < 8; ++x)
+		{
+			drawn[0] = drawn[0] || wall.get(1).get_pixel(x, 0);
+			drawn[1] = drawn[1] || wall.get(2).get_pixel(x, 0);
+		}
+	}
+
+	REQUIRE_FALSE(drawn[0]);
+	REQUIRE(drawn[1]);
+	// shown in red
+	REQUIRE(wall.faults() == 1);
+	REQUIRE(wall.get(6).get_fault() == Chip8::Fault::invalid_opcode);
+}
@@ -0,0 +1,65 @@
+#include <cstring>
+#include <fstream>
+#include "trace.hpp"
+
+// file header: magic, then the record count as a little endian uint64
+static constexpr char trace_magic[8] = {'C', 'H', 'I', 'P', '8', 'T', 'R', '1'};
+
+Trace::Trace(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity) size <<= 1;
+	records.resize(size);
+	mask = size - 1;
+}
+
+size_t Trace::size() const
+{
+	return count < records.size() ? count : records.size();
+}
+
+std::vector<TraceRecord> Trace::get_records() const
+{
+	std::vector<TraceRecord> ordered;
+	ordered.reserve(size());
+	for (uint64_t i = count - size(); i < count; ++i) ordered.push_back(records[i & mask]);
+	return ordered;
+}
+
+bool Trace::dump(const std::string& filename) const
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) return false;
+
+	uint64_t held = size();
+	file.write(trace_magic, sizeof(trace_magic));
+	file.write(reinterpret_cast<const char*>(&held), sizeof(held));
+
+	// the ring may wrap, so write it in up to two pieces
+	uint64_t first = count - held;
+	size_t start = first & mask;
+	size_t head = held < records.size() - start ? held : records.size() - start;
+	file.write(reinterpret_cast<const char*>(records.data() + start), head * sizeof(TraceRecord));
+	file.write(reinterpret_cast<const char*>(records.data()), (held - head) * sizeof(TraceRecord));
+
+	return static_cast<bool>(file);
+}
+
+bool Trace::read(const std::string& filename, std::vector<TraceRecord>& out)
+{
+	std::ifstream file(filename, std::ios::binary);
+
+	char magic[sizeof(trace_magic)];
+	uint64_t held;
+	if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, trace_magic, sizeof(magic)) != 0) return false;
+	if (!file.read(reinterpret_cast<char*>(&held), sizeof(held))) return false;
+
+	out.resize(held);
+	file.read(reinterpret_cast<char*>(out.data()), held * sizeof(TraceRecord));
+	if (static_cast<uint64_t>(file.gcount()) != held * sizeof(TraceRecord))
+	{
+		out.resize(file.gcount() / sizeof(TraceRecord));
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one executed instruction, or a fetch that faulted. records are written to trace files as is
+struct TraceRecord
+{
+	uint64_t cycle; // instructions executed since tracing started
+	uint16_t program_counter; // where the opcode was fetched from
+	uint16_t opcode;
+	uint16_t address_register; // I after execution
+	uint8_t reg; // the X register of the opcode
+	uint8_t value; // and its value after execution
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace records should pack into 16 bytes");
+
+/* Ring buffer of the most recently executed instructions. Recording only
+ * copies a few fields into preallocated memory, all formatting is left to
+ * the offline decoder (tracedump).
+ */
+class Trace
+{
+	std::vector<TraceRecord> records;
+	size_t mask;
+	uint64_t count = 0;
+public:
+	// capacity is rounded up to a power of 2
+	explicit Trace(size_t capacity = 0x10000);
+
+	void record(uint16_t program_counter, uint16_t opcode, uint16_t address_register, uint8_t reg, uint8_t value)
+	{
+		records[count & mask] = {count, program_counter, opcode, address_register, reg, value};
+		++count;
+	}
+
+	// number of records held, at most the capacity
+	size_t size() const;
+	// oldest first
+	std::vector<TraceRecord> get_records() const;
+
+	// write the held records, oldest first. returns false on I/O errors
+	bool dump(const std::string&) const;
+	// read a file written by dump
+	static bool read(const std::string&, std::vector<TraceRecord>&);
+};
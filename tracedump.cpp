@@ -0,0 +1,39 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "chip8.hpp"
+#include "trace.hpp"
+
+// print a trace written by the emulator as a disassembled listing
+int main(int argc, char** argv)
+{
+	if (argc <= 1)
+	{
+		std::cerr << "usage: " << argv[0] << " TRACE\n";
+		return EXIT_FAILURE;
+	}
+
+	std::vector<TraceRecord> records;
+	bool complete = Trace::read(argv[1], records);
+	if (!complete && records.empty())
+	{
+		std::cerr << argv[1] << ": not a trace file\n";
+		return EXIT_FAILURE;
+	}
+
+	for (const TraceRecord& record : records)
+	{
+		std::printf("%12llu  %03X: %04X  %-16s V%X=%02X I=%03X\n",
+			static_cast<unsigned long long>(record.cycle), record.program_counter, record.opcode,
+			Chip8::disassemble(record.opcode).c_str(), record.reg, record.value, record.address_register);
+	}
+
+	if (!complete)
+	{
+		std::cerr << argv[1] << ": truncated after " << records.size() << " records\n";
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cmath>
+#include "wall.hpp"
+
+Wall::Wall(const std::vector<Chip8>& _machines, uint64_t _steps_per_frame, unsigned int threads)
+	: machines(_machines), faulted(_machines.size()), steps_per_frame(_steps_per_frame),
+	pool(_machines.size(), threads, [this](size_t begin, size_t end, FusedEngine& engine) { run_slice(begin, end, engine); })
+{
+	// as square as possible
+	columns = std::max<unsigned int>(std::ceil(std::sqrt(machines.size())), 1);
+	rows = std::max<unsigned int>((machines.size() + columns - 1) / columns, 1);
+	atlas.assign(atlas_width() * atlas_height(), border);
+	for (size_t i = 0; i < machines.size(); ++i) draw_tile(i);
+}
+
+size_t Wall::faults() const
+{
+	size_t count = 0;
+	for (const Chip8& chip8 : machines) count += chip8.get_fault() != Chip8::Fault::none;
+	return count;
+}
+
+void Wall::draw_tile(size_t i)
+{
+	const Chip8& chip8 = machines[i];
+	faulted[i] = chip8.get_fault() != Chip8::Fault::none;
+	uint32_t on = faulted[i] ? faulted_on : pixel_on;
+
+	const auto& screen = chip8.get_screen();
+	uint32_t* tile = atlas.data() + (i / columns) * tile_height * atlas_width() + (i % columns) * tile_width;
+	for (unsigned int y = 0; y < Chip8::screen_height; ++y)
+	{
+		uint32_t* row = tile + y * atlas_width();
+		const bool* pixels = screen.data() + y * Chip8::screen_width;
+		for (unsigned int x = 0; x < Chip8::screen_width; ++x) row[x] = pixels[x] ? on : pixel_off;
+	}
+}
+
+void Wall::run_slice(size_t begin, size_t end, Engine& engine)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		Chip8& chip8 = machines[i];
+		engine.run_frame(chip8, steps_per_frame);
+
+		bool now_faulted = chip8.get_fault() != Chip8::Fault::none;
+		if (chip8.should_draw() || now_faulted != static_cast<bool>(faulted[i])) draw_tile(i);
+	}
+}
+
+void Wall::run_frame()
+{
+	pool.run();
+}
+
+int Wall::tile_at(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= static_cast<int>(atlas_width()) || y >= static_cast<int>(atlas_height())) return -1;
+	size_t i = (y / tile_height) * columns + x / tile_width;
+	return i < machines.size() ? static_cast<int>(i) : -1;
+}
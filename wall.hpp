@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+#include "fused.hpp"
+#include "workerpool.hpp"
+
+/* Many machines shown at once, for watching batch runs. Worker threads run
+ * the machines a frame at a time and draw each one's screen into its tile of
+ * one shared ARGB8888 image, the atlas, so the frontend uploads a single
+ * texture per display frame however many machines there are. Tiles are only
+ * redrawn when their screen changed, and a faulted machine's tile turns red.
+ *
+ * Everything but run_frame() belongs to the calling thread, and must not be
+ * used while run_frame() runs.
+ */
+class Wall
+{
+public:
+	// a line of border colour right and below each screen
+	constexpr static unsigned int tile_width = Chip8::screen_width + 1;
+	constexpr static unsigned int tile_height = Chip8::screen_height + 1;
+
+	constexpr static uint32_t pixel_on = 0xffffffff;
+	constexpr static uint32_t pixel_off = 0xff000000;
+	constexpr static uint32_t faulted_on = 0xffff4040;
+	constexpr static uint32_t border = 0xff404040;
+
+private:
+	std::vector<Chip8> machines;
+	std::vector<uint8_t> faulted; // as last drawn
+	uint64_t steps_per_frame;
+	unsigned int columns;
+	unsigned int rows;
+	std::vector<uint32_t> atlas;
+	// an engine per thread, it checks cached code against each machine's memory. last, so it stops first
+	WorkerPool<FusedEngine> pool;
+
+	void run_slice(size_t, size_t, Engine&);
+	void draw_tile(size_t);
+public:
+	// threads 0 for all cores. steps_per_frame is ignored for machines with VIP timing
+	Wall(const std::vector<Chip8>&, uint64_t steps_per_frame = 16, unsigned int threads = 0);
+	Wall(const Wall&) = delete;
+	Wall& operator=(const Wall&) = delete;
+
+	size_t size() const { return machines.size(); }
+	Chip8& get(size_t i) { return machines[i]; }
+	size_t faults() const;
+
+	// run every machine for one frame and bring the atlas up to date
+	void run_frame();
+
+	// the atlas, atlas_width() pixels per row
+	const uint32_t* get_atlas() const { return atlas.data(); }
+	unsigned int atlas_width() const { return columns * tile_width; }
+	unsigned int atlas_height() const { return rows * tile_height; }
+	unsigned int get_columns() const { return columns; }
+	// the machine shown at a point of the atlas, -1 for none
+	int tile_at(int x, int y) const;
+};
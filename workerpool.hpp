@@ -0,0 +1,110 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Threads that share work on a fixed number of items, e.g. machines, with
+ * the calling thread. run() starts a new generation: each thread runs the
+ * job on its own fixed slice of the items, the calling thread on the first
+ * one, and it returns once all slices are done.
+ *
+ * Every thread keeps a Local of its own for the job, e.g. an engine with a
+ * cache, so nothing the job writes to is shared between threads.
+ */
+template<typename Local>
+class WorkerPool
+{
+public:
+	// called with the items [begin, end) of a slice
+	typedef std::function<void(size_t, size_t, Local&)> job_t;
+
+private:
+	size_t items;
+	job_t job;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable start;
+	std::condition_variable finished;
+	uint64_t generation = 0;
+	unsigned int running = 0;
+	bool stopping = false;
+	Local local; // for the calling thread
+
+	void work(unsigned int slice)
+	{
+		Local own;
+		uint64_t seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				start.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+			}
+
+			size_t begin, end;
+			bounds(slice, begin, end);
+			job(begin, end, own);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--running == 0) finished.notify_one();
+		}
+	}
+
+	void bounds(unsigned int slice, size_t& begin, size_t& end) const
+	{
+		size_t slices = workers.size() + 1;
+		begin = items * slice / slices;
+		end = items * (slice + 1) / slices;
+	}
+
+public:
+	/* threads 0 for all cores, and never more than there are items. the
+	 * calling thread counts as one, so one less is started
+	 */
+	WorkerPool(size_t _items, unsigned int threads, job_t _job) : items(_items), job(std::move(_job))
+	{
+		if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+		threads = std::clamp<size_t>(threads, 1, std::max<size_t>(items, 1));
+		for (unsigned int slice = 1; slice < threads; ++slice) workers.emplace_back(&WorkerPool::work, this, slice);
+	}
+
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		start.notify_all();
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// including the calling thread
+	unsigned int threads() const { return workers.size() + 1; }
+
+	void run()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = workers.size();
+			++generation;
+		}
+		start.notify_all();
+
+		size_t begin, end;
+		bounds(0, begin, end);
+		job(begin, end, local);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [&]() { return running == 0; });
+	}
+};